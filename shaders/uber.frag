@@ -0,0 +1,143 @@
+// Fragment uber-shader. Every permutation contains exactly one coloring mode,
+// so the fragment path never branches on uniforms.
+//
+// - MAP_LIGHTING: samples the map texture and dims the half of the Earth facing
+//   away from the sun, whose longitude follows hourOffset and whose latitude is
+//   the axial tilt (summer solstice). With GLOBE, the texture is sampled at the
+//   latitude and longitude of the surface direction interpolated from the vertices.
+//   hourOffset comes from the View block of the view being drawn, declared like in
+//   the vertex shader.
+// - FLAT_COLOR: uniform color, used by paths, range rings, feed positions and vehicles.
+// - INSTANCED_MARKER: icon coverage from the marker atlas in the per-instance color,
+//   with a dark halo from the atlas's second channel if the instance's flags ask for it.
+// - SDF_TEXT: glyph coverage from the signed distance atlas, with a dark halo
+//   keeping labels readable over both land and sea.
+// OBJECT_STATE adds to FLAT_COLOR or INSTANCED_MARKER: the per-instance state bits
+// lighten hovered and selected objects towards white and darken dimmed ones, and
+// selected markers always get their halo.
+#version 330 core
+out vec4 fragColor;
+
+const int MaxWorldCopies = 3;
+layout(std140) uniform View {
+    mat4 globeRotation;
+    vec4 eyeHigh[MaxWorldCopies];
+    vec4 eyeLow[MaxWorldCopies];
+    vec2 viewportSize;
+    float viewScale;
+    float globeScale;
+    float hourOffset;
+};
+
+#ifdef MAP_LIGHTING
+#ifdef GLOBE
+in vec3 vDirection;
+#else
+in vec2 vTexCoord;
+#endif
+uniform sampler2D tex;
+
+const float PI = 3.14159265359;
+const float earthTiltDeg = 23.0;
+
+vec3 geoToCartesian(float lat, float lon) {
+    float latRad = radians(lat);
+    float lonRad = radians(lon);
+    return vec3(
+        cos(latRad) * cos(lonRad),
+        cos(latRad) * sin(lonRad),
+        sin(latRad)
+    );
+}
+#endif
+
+#ifdef FLAT_COLOR
+uniform vec3 color;
+#endif
+
+#if defined(INSTANCED_MARKER) || defined(SDF_TEXT)
+in vec3 vColor;
+#endif
+
+#ifdef INSTANCED_MARKER
+in vec2 vTexCoord;
+flat in int vFlags;
+uniform sampler2D tex;
+const int MarkerHalo = 1;
+#endif
+
+#ifdef SDF_TEXT
+in vec2 vTexCoord;
+uniform sampler2D tex;
+#endif
+
+#ifdef OBJECT_STATE
+flat in uint vState;
+const uint ObjectSelected = 1u;
+const uint ObjectHovered = 2u;
+const uint ObjectDimmed = 4u;
+
+// The color of the object in its state, selected without branching.
+vec3 stateColor(vec3 base) {
+    float towardsWhite = max(0.4 * float((vState & ObjectHovered) != 0u), 0.7 * float((vState & ObjectSelected) != 0u));
+    return mix(base, vec3(1.0), towardsWhite) * mix(1.0, 0.3, float((vState & ObjectDimmed) != 0u));
+}
+#endif
+
+void main() {
+#ifdef MAP_LIGHTING
+    float latitudeMinRad = radians(-85.0);
+    float latitudeMaxRad = radians(85.0);
+    float yMin = log(tan(latitudeMinRad) + 1.0 / cos(latitudeMinRad));
+    float yMax = log(tan(latitudeMaxRad) + 1.0 / cos(latitudeMaxRad));
+#ifdef GLOBE
+    // Convert the surface direction to texture coordinates; the map ends at +-85°
+    vec3 normal = normalize(vDirection);
+    float lon = degrees(atan(normal.y, normal.x));
+    float latRad = clamp(asin(normal.z), latitudeMinRad, latitudeMaxRad);
+    vec2 texCoord = vec2((lon + 180.0) / 360.0, (log(tan(latRad) + 1.0 / cos(latRad)) - yMin) / (yMax - yMin));
+#else
+    // Convert texture coordinates to geographic coordinates
+    vec2 texCoord = vTexCoord;
+    float lon = vTexCoord.x * 360.0 - 180.0;
+    float y = yMin + vTexCoord.y * (yMax - yMin);
+    float lat = degrees(atan(sinh(y)));
+
+    vec3 normal = geoToCartesian(lat, lon);
+#endif
+    vec3 texColor = texture(tex, texCoord).rgb;
+
+    // Sun position at summer solstice: fixed latitude +23°
+    float sunLon = 180.0 - hourOffset * 15.0;
+    float sunLat = earthTiltDeg;
+    vec3 sunDir = geoToCartesian(sunLat, sunLon);
+
+    // Day is full brightness, night is dimmed by 50%, selected without branching
+    float light = dot(normal, sunDir);
+    fragColor = vec4(texColor * mix(0.5, 1.0, step(0.0, light)), 1.0);
+#endif
+#ifdef FLAT_COLOR
+#ifdef OBJECT_STATE
+    fragColor = vec4(stateColor(color), 1.0);
+#else
+    fragColor = vec4(color, 1.0);
+#endif
+#endif
+#ifdef INSTANCED_MARKER
+    vec2 coverage = texture(tex, vTexCoord).rg;   // icon, halo
+    float halo = float(vFlags & MarkerHalo);
+    vec3 markerColor = vColor;
+#ifdef OBJECT_STATE
+    halo = max(halo, float((vState & ObjectSelected) != 0u));
+    markerColor = stateColor(vColor);
+#endif
+    fragColor = vec4(markerColor * mix(1.0, coverage.r, halo), mix(coverage.r, coverage.g, halo));
+#endif
+#ifdef SDF_TEXT
+    float sdf = texture(tex, vTexCoord).r;
+    float width = fwidth(sdf);
+    float fill = smoothstep(0.5 - width, 0.5 + width, sdf);
+    float halo = smoothstep(0.3 - width, 0.3 + width, sdf);
+    fragColor = vec4(vColor * fill, halo);
+#endif
+}
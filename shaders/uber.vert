@@ -0,0 +1,331 @@
+// Vertex uber-shader. ShaderLibrary inserts the #defines of the requested
+// features (MAP_LIGHTING, FLAT_COLOR, INSTANCED_MARKER, SDF_TEXT, GEO_POSITION,
+// SPHERE_POSITION, GREAT_CIRCLE, TIMELINE, SPLIT_POSITION, GLOBE, OBJECT_STATE,
+// RANGE_RING) after the version line.
+//
+// - position (location 0): map position of the vertex in normalized map coordinates,
+//   a per-instance attribute for INSTANCED_MARKER and SDF_TEXT. With GEO_POSITION it
+//   is (latitude, longitude) in degrees instead, projected like geoToNormalizedMap.
+//   With SPHERE_POSITION it is a vec3 unit vector on the globe, projected the same way.
+// - arcStart, arcEnd (locations 0 and 1, GREAT_CIRCLE): per-instance unit vectors of
+//   the endpoints of a great-circle arc; gl_VertexID selects the point on the arc,
+//   from 0 at arcStart to arcSegments at arcEnd.
+// - ringCenter, ringRadius (locations 0 and 1, RANGE_RING): per-instance unit vector of
+//   the center of a range ring and its great-circle radius in radians; gl_VertexID
+//   selects the point on the ring, from 0 to ringSegments all the way around, as
+//   RangeRing::pointAt defines it.
+// - positionLow (location 5, SPLIT_POSITION): with position (location 0), the high and
+//   low float parts of a double precision map position, see splitPosition.
+// - startHigh, startLow, endHigh, endLow (locations 5 to 8, GREAT_CIRCLE and
+//   SPLIT_POSITION): the map positions of the arc's endpoints, split the same way, with
+//   the end unwrapped to the side of the start.
+// - lifetime (location 4, TIMELINE): appear and disappear time. Vertices outside
+//   [appear, disappear) at timelineTime are moved outside the clip volume.
+// - texCoord (location 1, MAP_LIGHTING): texture coordinate passed on as vTexCoord.
+// - glyph (location 1, SDF_TEXT): pixel offset of the glyph quad from its anchor (xy)
+//   and the atlas cell (z); the quad corner comes from gl_VertexID.
+// - instanceColor (location 3, INSTANCED_MARKER, SDF_TEXT): color passed on as vColor.
+// - marker (location 2, INSTANCED_MARKER): icon cell in the atlas, size in pixels and
+//   style flags; the icon quad corner comes from gl_VertexID, and the quad is
+//   markerQuadScale times the icon size to make room for the halo.
+// - objectState (location 9, OBJECT_STATE): per-instance selected, hovered and dimmed
+//   bits, passed on as vState; selected and hovered markers are drawn larger.
+//
+// The camera and the size of the view being drawn come from the View uniform block,
+// one buffer per view (ViewUniforms); the fragment shader declares the same block.
+// Except for SDF_TEXT, whose glyphs are laid out on the screen by TextRenderer, map
+// positions are drawn through the camera: relative to the view center, scaled by
+// viewScale, in one of worldCopies copies of the map shifted by multiples of 2 in x.
+// The copy is copyOffset plus gl_InstanceID modulo worldCopies; instanced draws give
+// their per-instance attributes a divisor of worldCopies to keep them per object.
+// eyeHigh and eyeLow hold the view center moved into each copy, split like
+// SPLIT_POSITION positions, so subtracting high from high and low from low keeps the
+// position relative to the camera exact at any zoom.
+// GREAT_CIRCLE arcs are unwrapped relative to their start, so an arc crossing the
+// antimeridian continues into the neighboring copy instead of jumping across the map.
+// With SPLIT_POSITION, an arc is the straight line between its exact endpoints plus
+// its bend on the map, which is only computed in float for arcs long enough to have one.
+// RANGE_RING points are unwrapped relative to the ring's center, or for a ring around a
+// pole relative to a reference sweeping across the map (RangeRing::unwrapReference).
+//
+// GLOBE draws on the orthographic globe instead: the vertex becomes a unit vector, which
+// is rotated by globeRotation so that the view direction is the z axis and scaled by
+// globeScale. Its z coordinate, the dot product with the view direction, is the clip
+// distance, so the far side of the globe is removed and lines end at the horizon; every
+// variant writes gl_ClipDistance[0]. GLOBE works with GREAT_CIRCLE, RANGE_RING,
+// SPHERE_POSITION and GEO_POSITION, and with MAP_LIGHTING it draws the CubeSphere mesh:
+// - gridPoint (location 0): (u, v) of the vertex within its patch, in [0, 1].
+// - cubePatch (location 1): per-instance face of the cube, corner (u, v) on the face and size.
+// - edgeSegments (location 2): per-instance segments of the bottom, right, top and left
+//   edge; vertices on an edge are moved onto its chords at that count.
+// The surface direction is passed on as vDirection for the fragment stage.
+#version 330 core
+#if defined(MAP_LIGHTING) && defined(GLOBE)
+layout(location = 0) in vec2 gridPoint;
+layout(location = 1) in vec4 cubePatch;
+layout(location = 2) in vec4 edgeSegments;
+out vec3 vDirection;
+#elif defined(GREAT_CIRCLE)
+layout(location = 0) in vec3 arcStart;
+layout(location = 1) in vec3 arcEnd;
+uniform float arcSegments;
+#elif defined(RANGE_RING)
+layout(location = 0) in vec3 ringCenter;
+layout(location = 1) in float ringRadius;
+uniform float ringSegments;
+#elif defined(SPHERE_POSITION)
+layout(location = 0) in vec3 position;
+#else
+layout(location = 0) in vec2 position;
+#endif
+
+#ifdef SPLIT_POSITION
+#ifdef GREAT_CIRCLE
+layout(location = 5) in vec2 startHigh;
+layout(location = 6) in vec2 startLow;
+layout(location = 7) in vec2 endHigh;
+layout(location = 8) in vec2 endLow;
+#else
+layout(location = 5) in vec2 positionLow;
+#endif
+#endif
+
+const int MaxWorldCopies = 3;
+layout(std140) uniform View {
+    mat4 globeRotation;
+    vec4 eyeHigh[MaxWorldCopies];   // xy
+    vec4 eyeLow[MaxWorldCopies];    // xy
+    vec2 viewportSize;
+    float viewScale;
+    float globeScale;
+    float hourOffset;
+};
+
+#if !defined(GLOBE) && !defined(SDF_TEXT)
+uniform int copyOffset;
+uniform int worldCopies;
+#endif
+
+#ifdef TIMELINE
+layout(location = 4) in vec2 lifetime;
+uniform float timelineTime;
+#endif
+
+#if defined(MAP_LIGHTING) && !defined(GLOBE)
+layout(location = 1) in vec2 texCoord;
+out vec2 vTexCoord;
+#endif
+
+#ifdef SDF_TEXT
+layout(location = 1) in vec3 glyph;
+uniform vec2 glyphQuadSize;
+uniform vec2 atlasGrid;
+out vec2 vTexCoord;
+#endif
+
+#ifdef INSTANCED_MARKER
+layout(location = 2) in vec3 marker;
+uniform vec2 atlasGrid;
+uniform float markerQuadScale;
+out vec2 vTexCoord;
+flat out int vFlags;
+#endif
+
+#ifdef OBJECT_STATE
+layout(location = 9) in uint objectState;
+flat out uint vState;
+const uint ObjectSelected = 1u;
+const uint ObjectHovered = 2u;
+const float HighlightGrowth = 1.5;
+#endif
+
+#if defined(INSTANCED_MARKER) || defined(SDF_TEXT)
+layout(location = 3) in vec3 instanceColor;
+out vec3 vColor;
+#endif
+
+#if defined(GEO_POSITION) || defined(SPHERE_POSITION) || defined(GREAT_CIRCLE) || defined(RANGE_RING)
+// Mercator projection between latitudes -85 and 85 degrees, scaled to [-1, 1].
+vec2 geoToNormalizedMap(vec2 geo) {
+    float latitude = radians(clamp(geo.x, -85.0, 85.0));
+    float maxY = log(tan(radians(85.0)) + 1.0 / cos(radians(85.0)));
+    return vec2(geo.y / 180.0, log(tan(latitude) + 1.0 / cos(latitude)) / maxY);
+}
+
+// The same projection for a point on the globe given as a vector.
+vec2 sphereToNormalizedMap(vec3 point) {
+    vec3 unit = normalize(point);
+    return geoToNormalizedMap(degrees(vec2(asin(unit.z), atan(unit.y, unit.x))));
+}
+
+// The point on the globe at a latitude and longitude in degrees.
+vec3 geoToCartesian(vec2 geo) {
+    vec2 angles = radians(geo);
+    return vec3(cos(angles.x) * cos(angles.y), cos(angles.x) * sin(angles.y), sin(angles.x));
+}
+#endif
+
+#ifdef GREAT_CIRCLE
+// Spherical linear interpolation between the endpoints of the arc.
+vec3 arcPoint(float t) {
+    float omega = acos(clamp(dot(arcStart, arcEnd), -1.0, 1.0));
+    if (omega < 1e-4) return arcStart;
+    return (sin((1.0 - t) * omega) * arcStart + sin(t * omega) * arcEnd) / sin(omega);
+}
+#endif
+
+#if defined(GREAT_CIRCLE) || defined(RANGE_RING)
+// Moves a map position by whole map widths to within half a map of a reference.
+vec2 unwrapNear(vec2 point, vec2 reference) {
+    return vec2(point.x - 2.0 * round((point.x - reference.x) / 2.0), point.y);
+}
+#endif
+
+#ifdef RANGE_RING
+// 1 if the ring's center is on the northern hemisphere (or the equator), -1 if southern.
+float ringHemisphere() {
+    return ringCenter.z < 0.0 ? -1.0 : 1.0;
+}
+
+// The point of the ring at a fraction t of the circle, starting on the side facing
+// the pole of the center's hemisphere, like RangeRing::pointAt.
+vec3 ringPoint(float t) {
+    vec3 pole = vec3(0.0, 0.0, ringHemisphere());
+    vec3 towardsPole = pole - dot(pole, ringCenter) * ringCenter;
+    vec3 u = dot(towardsPole, towardsPole) > 1e-12 ? normalize(towardsPole) : vec3(1.0, 0.0, 0.0);
+    vec3 v = cross(ringCenter, u);
+    float angle = 6.28318530718 * t;
+    return cos(ringRadius) * ringCenter + sin(ringRadius) * (cos(angle) * u + sin(angle) * v);
+}
+
+// The map x that the point at t is unwrapped near, like RangeRing::unwrapReference:
+// the center, or for a ring around the pole a reference sweeping once across the map.
+float ringReference(float t) {
+    float centerX = atan(ringCenter.y, ringCenter.x) / 3.14159265359;
+    if (abs(ringCenter.z) <= cos(ringRadius)) return centerX;
+    return centerX - ringHemisphere() * (1.0 - 2.0 * t);
+}
+#endif
+
+#if defined(MAP_LIGHTING) && defined(GLOBE)
+const float PI = 3.14159265359;
+const vec3 faceNormal[6] = vec3[6](vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1));
+const vec3 faceU[6] = vec3[6](vec3(0, 1, 0), vec3(0, -1, 0), vec3(-1, 0, 0), vec3(1, 0, 0), vec3(0, 1, 0), vec3(0, 1, 0));
+const vec3 faceV[6] = vec3[6](vec3(0, 0, 1), vec3(0, 0, 1), vec3(0, 0, 1), vec3(0, 0, 1), vec3(-1, 0, 0), vec3(1, 0, 0));
+
+// The point of the sphere at a grid point of the patch, like CubeSphere::surfacePoint.
+vec3 surfacePoint(vec2 grid) {
+    int face = int(cubePatch.x);
+    vec2 cube = (cubePatch.yz + grid * cubePatch.w) * 2.0 - 1.0;
+    cube = mix(tan(cube * (PI / 4.0)), cube, step(1.0, abs(cube)));
+    return normalize(faceNormal[face] + cube.x * faceU[face] + cube.y * faceV[face]);
+}
+
+// The vertex on the surface, or on the chord of a patch edge that has fewer segments
+// than the patch, so that it meets the neighbor drawn at that edge's count.
+vec3 patchPoint() {
+    int axis = (gridPoint.y == 0.0 || gridPoint.y == 1.0) ? 0 : 1;
+    float segments = gridPoint.y == 0.0 ? edgeSegments.x : gridPoint.x == 1.0 ? edgeSegments.y
+                   : gridPoint.y == 1.0 ? edgeSegments.z : gridPoint.x == 0.0 ? edgeSegments.w : 0.0;
+    if (segments == 0.0) return surfacePoint(gridPoint);
+    float along = gridPoint[axis];
+    float first = floor(along * segments) / segments;
+    if (first == along) return surfacePoint(gridPoint);
+    vec2 start = gridPoint, end = gridPoint;
+    start[axis] = first;
+    end[axis] = first + 1.0 / segments;
+    return mix(surfacePoint(start), surfacePoint(end), (along - first) * segments);
+}
+#endif
+
+#if defined(GREAT_CIRCLE) && defined(SPLIT_POSITION)
+// Offset of an arc point from the straight line between the endpoints on the map.
+// Arcs shorter than about 600 m bend by less than a millimeter, so they stay straight
+// rather than picking up the float rounding of the projection.
+vec2 arcBend(float t, vec2 point) {
+    if (dot(arcStart, arcEnd) > 0.0 && length(cross(arcStart, arcEnd)) < 1e-4) return vec2(0.0);
+    vec2 start = sphereToNormalizedMap(arcStart);
+    return point - mix(start, unwrapNear(sphereToNormalizedMap(arcEnd), start), t);
+}
+#endif
+
+void main() {
+    gl_ClipDistance[0] = 1.0;
+#if defined(GREAT_CIRCLE)
+    float t = float(gl_VertexID) / arcSegments;
+#elif defined(RANGE_RING)
+    float t = float(gl_VertexID) / ringSegments;
+#endif
+#if defined(GLOBE)
+#if defined(MAP_LIGHTING)
+    vec3 onGlobe = patchPoint();
+    vDirection = onGlobe;
+#elif defined(GREAT_CIRCLE)
+    vec3 onGlobe = arcPoint(t);
+#elif defined(RANGE_RING)
+    vec3 onGlobe = ringPoint(t);
+#elif defined(SPHERE_POSITION)
+    vec3 onGlobe = normalize(position);
+#else
+    vec3 onGlobe = geoToCartesian(position);
+#endif
+    vec3 viewed = mat3(globeRotation) * onGlobe;
+    gl_Position = vec4(viewed.xy * globeScale, 0.0, 1.0);
+    gl_ClipDistance[0] = viewed.z;
+#else
+#if defined(GREAT_CIRCLE)
+    vec2 mapPosition = unwrapNear(sphereToNormalizedMap(arcPoint(t)), sphereToNormalizedMap(arcStart));
+#elif defined(RANGE_RING)
+    vec2 mapPosition = unwrapNear(sphereToNormalizedMap(ringPoint(t)), vec2(ringReference(t), 0.0));
+#elif defined(SPHERE_POSITION)
+    vec2 mapPosition = sphereToNormalizedMap(position);
+#elif defined(GEO_POSITION)
+    vec2 mapPosition = geoToNormalizedMap(position);
+#else
+    vec2 mapPosition = position;
+#endif
+#ifdef SDF_TEXT
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 pixel = glyph.xy + corner * glyphQuadSize;
+    gl_Position = vec4(mapPosition + pixel * 2.0 / viewportSize, 0.0, 1.0);
+    vec2 cell = vec2(mod(glyph.z, atlasGrid.x), floor(glyph.z / atlasGrid.x));
+    vTexCoord = (cell + vec2(corner.x, 1.0 - corner.y)) / atlasGrid;
+#else
+    int copy = copyOffset + gl_InstanceID % worldCopies;
+    vec2 eyeHighCopy = eyeHigh[copy].xy, eyeLowCopy = eyeLow[copy].xy;
+#if defined(GREAT_CIRCLE) && defined(SPLIT_POSITION)
+    vec2 start = (startHigh - eyeHighCopy) + (startLow - eyeLowCopy);
+    vec2 end = (endHigh - eyeHighCopy) + (endLow - eyeLowCopy);
+    vec2 relative = mix(start, end, t) + arcBend(t, mapPosition);
+#elif defined(SPLIT_POSITION)
+    vec2 relative = (position - eyeHighCopy) + (positionLow - eyeLowCopy);
+#else
+    vec2 relative = (mapPosition - eyeHighCopy) - eyeLowCopy;
+#endif
+    gl_Position = vec4(relative * viewScale, 0.0, 1.0);
+#endif
+#endif
+#ifdef INSTANCED_MARKER
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    float markerSize = marker.y;
+#ifdef OBJECT_STATE
+    markerSize *= mix(1.0, HighlightGrowth, float((objectState & (ObjectSelected | ObjectHovered)) != 0u));
+#endif
+    gl_Position.xy += (corner - 0.5) * (markerSize * markerQuadScale * 2.0) / viewportSize;
+    vec2 cell = vec2(mod(marker.x, atlasGrid.x), floor(marker.x / atlasGrid.x));
+    vTexCoord = (cell + vec2(corner.x, 1.0 - corner.y)) / atlasGrid;
+    vFlags = int(marker.z);
+#endif
+#ifdef TIMELINE
+    if (timelineTime < lifetime.x || timelineTime >= lifetime.y) gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+#endif
+#if defined(MAP_LIGHTING) && !defined(GLOBE)
+    vTexCoord = texCoord;
+#endif
+#if defined(INSTANCED_MARKER) || defined(SDF_TEXT)
+    vColor = instanceColor;
+#endif
+#ifdef OBJECT_STATE
+    vState = objectState;
+#endif
+}
@@ -0,0 +1,66 @@
+#include "AsyncLoader.h"
+
+
+/**
+ * Reports one finished loading step. May be called from any thread.
+ *
+ * @param step Short description of the step, printed with the overall progress.
+ */
+void AsyncLoader::completed(const char *step) {
+    int done = ++completedSteps;
+    std::cout << "Loaded " << step << " (" << done << "/" << expectedSteps.load() << ")" << std::endl;
+}
+
+
+/**
+ * Returns the fraction of the announced steps that have completed.
+ *
+ * @return A value in [0, 1]; 1 when nothing is being loaded.
+ */
+float AsyncLoader::Progress() const {
+    int expected = expectedSteps.load();
+    return expected == 0 ? 1.0f : static_cast<float>(completedSteps.load()) / static_cast<float>(expected);
+}
+
+
+/**
+ * Resumes the coroutines that asked to continue on the GL thread. Must be
+ * called from the thread owning the context, once per iteration of the frame
+ * loop. Coroutines queued while the batch runs are resumed by the next call.
+ *
+ * @return True if at least one coroutine was resumed.
+ */
+bool AsyncLoader::pump() {
+    std::vector<std::coroutine_handle<>> batch;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        batch.swap(glQueue);
+    }
+    for (auto handle: batch) handle.resume();
+    return !batch.empty();
+}
+
+
+/**
+ * Destroys the frames of the coroutines waiting for the GL thread, along with
+ * the GL objects they own, such as programs compiled so far. Must be called
+ * from the thread owning the context, before the context goes away.
+ */
+void AsyncLoader::cancelGLWork() {
+    std::vector<std::coroutine_handle<>> batch;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        batch.swap(glQueue);
+    }
+    for (auto handle: batch) handle.destroy();
+}
+
+
+/**
+ * Destructor for the `AsyncLoader` class. Destroys the frames of coroutines
+ * still waiting for the GL thread. The worker pool must already have been
+ * stopped, so that no worker can queue another one.
+ */
+AsyncLoader::~AsyncLoader() {
+    for (auto handle: glQueue) handle.destroy();
+}
@@ -0,0 +1,110 @@
+#ifndef ASYNCLOADER_H
+#define ASYNCLOADER_H
+
+#include "WorkerPool.h"
+#include <atomic>
+#include <coroutine>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+
+/**
+ * @struct LoadTask
+ * @brief Return type of fire-and-forget loading coroutines.
+ *
+ * A loading coroutine starts running on the calling thread as soon as it is
+ * called and frees its frame when it finishes. It moves between threads by
+ * awaiting `AsyncLoader::onWorker` and `AsyncLoader::onGLThread`.
+ */
+struct LoadTask {
+    struct promise_type {
+        LoadTask get_return_object() { return {}; }
+
+        std::suspend_never initial_suspend() noexcept { return {}; }
+
+        std::suspend_never final_suspend() noexcept { return {}; }
+
+        void return_void() { }
+
+        void unhandled_exception() {
+            try {
+                throw;
+            } catch (const std::exception &exception) {
+                std::cerr << "Loading failed: " << exception.what() << std::endl;
+            } catch (...) {
+                std::cerr << "Loading failed" << std::endl;
+            }
+        }
+    };
+};
+
+
+/**
+ * @class AsyncLoader
+ * @brief Schedules loading coroutines between worker threads and the GL thread.
+ *
+ * `co_await loader.onWorker()` continues the coroutine on the worker pool, where
+ * files are read and data is decoded; `co_await loader.onGLThread()` continues it
+ * on the thread owning the context the next time `pump` is called from the frame
+ * loop, where textures are uploaded and programs compiled. The frame loop thus
+ * never waits for a load, and frames keep being drawn, with placeholders, while
+ * the loads are in progress.
+ *
+ * Progress is counted in steps: a coroutine announces its steps with `expect`
+ * before its first suspension and reports each finished one with `completed`.
+ */
+class AsyncLoader final {
+    WorkerPool &pool;
+    std::mutex queueMutex;
+    std::vector<std::coroutine_handle<>> glQueue;
+    std::atomic<int> expectedSteps{0};
+    std::atomic<int> completedSteps{0};
+
+public:
+    struct WorkerAwaiter {
+        AsyncLoader &loader;
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) const { loader.pool.submit([handle] { handle.resume(); }); }
+
+        void await_resume() const noexcept { }
+    };
+
+    struct GLThreadAwaiter {
+        AsyncLoader &loader;
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) const {
+            std::lock_guard<std::mutex> lock(loader.queueMutex);
+            loader.glQueue.push_back(handle);
+        }
+
+        void await_resume() const noexcept { }
+    };
+
+    AsyncLoader(WorkerPool &pool) : pool(pool) { }
+
+    WorkerAwaiter onWorker() { return {*this}; }
+
+    GLThreadAwaiter onGLThread() { return {*this}; }
+
+    void expect(int steps) { expectedSteps += steps; }
+
+    void completed(const char *step);
+
+    float Progress() const;
+
+    bool Busy() const { return completedSteps.load() < expectedSteps.load(); }
+
+    bool pump();
+
+    void cancelGLWork();
+
+    ~AsyncLoader();
+};
+
+
+#endif //ASYNCLOADER_H
@@ -0,0 +1,187 @@
+#include "Camera.h"
+#include <algorithm>
+
+
+/**
+ * Wraps the center into [-1, 1) horizontally and keeps the view within the
+ * map vertically, where it does not repeat. On the globe only the center has
+ * to stay on the map, within the latitudes it covers.
+ */
+void Camera::clampCenter() {
+    center.x -= 2.0 * std::floor((center.x + 1.0) / 2.0);
+    double limit = globe ? 1.0 : 1.0 - 1.0 / zoom;
+    center.y = std::clamp(center.y, -limit, limit);
+}
+
+
+/**
+ * Returns the rotation that turns the globe from world space, where the z axis
+ * points to the North Pole, into view space: x points east and y north at the
+ * center of the view, and z towards the viewer.
+ */
+mat3 Camera::GlobeRotation() const {
+    vec3 view = geoToCartesian(mapCoordinatesToGeographic(center));
+    vec3 east = normalize(cross(vec3(0.0f, 0.0f, 1.0f), view));
+    vec3 north = cross(view, east);
+    return transpose(mat3(east, north, view));
+}
+
+
+/**
+ * Switches between the map and the globe. The globe keeps the center of the
+ * map facing the viewer, and the zoom is reduced to `MaxGlobeZoom` if needed.
+ *
+ * @param enabled True for the globe, false for the map.
+ */
+void Camera::setGlobe(bool enabled) {
+    globe = enabled;
+    if (globe) zoom = std::min(zoom, MaxGlobeZoom);
+    clampCenter();
+}
+
+
+/**
+ * Moves the view, e.g. by the distance the mouse was dragged. On the globe the
+ * center moves by the angle the offset spans at the surface, so the surface
+ * near the center follows the mouse.
+ *
+ * @param ndcOffset How far the map moves on the screen, in normalized device coordinates.
+ */
+void Camera::pan(const vec2 &ndcOffset) {
+    if (globe) {
+        dvec2 geo = mapCoordinatesToGeographic(center);
+        dvec2 angle = dvec2(ndcOffset) / static_cast<double>(GlobeScale()) * (180.0 / M_PI);
+        geo.x = std::clamp(geo.x - angle.y, -85.0, 85.0);
+        geo.y -= angle.x / std::cos(geo.x * M_PI / 180.0);
+        center = geoToNormalizedMap(geo);
+    } else {
+        center -= dvec2(ndcOffset) / zoom;
+    }
+    clampCenter();
+}
+
+
+/**
+ * Zooms in or out, keeping the map position under a screen point in place. On
+ * the globe this holds near the center of the view.
+ *
+ * @param ndc    The fixed screen point, in normalized device coordinates.
+ * @param factor Zoom factor to apply; the result is clamped to [MinZoom, MaxZoom],
+ *               or to [MinZoom, MaxGlobeZoom] on the globe.
+ */
+void Camera::zoomAt(const vec2 &ndc, double factor) {
+    double previous = zoom;
+    zoom = std::clamp(zoom * factor, MinZoom, globe ? MaxGlobeZoom : MaxZoom);
+    if (globe) {
+        pan(ndc * static_cast<float>(1.0 - zoom / previous));
+        return;
+    }
+    dvec2 fixed = center + dvec2(ndc) / previous;
+    center = fixed - dvec2(ndc) / zoom;
+    clampCenter();
+}
+
+
+/**
+ * Returns the map position shown at a screen point, wrapped into the original
+ * copy of the map.
+ *
+ * @param ndc The screen point, in normalized device coordinates.
+ * @return The position in normalized map coordinates, with x in [-1, 1).
+ */
+dvec2 Camera::ndcToMap(const vec2 &ndc) const {
+    dvec2 map = center + dvec2(ndc) / zoom;
+    map.x -= 2.0 * std::floor((map.x + 1.0) / 2.0);
+    return map;
+}
+
+
+/**
+ * Returns the geographic position shown at a screen point, on the map or on
+ * the globe.
+ *
+ * @param ndc The screen point, in normalized device coordinates.
+ * @param geo Receives the latitude and longitude in degrees.
+ * @return False if the point is beside the globe or beyond the latitudes of the map.
+ */
+bool Camera::ndcToGeographic(const vec2 &ndc, dvec2 &geo) const {
+    if (!globe) {
+        geo = mapCoordinatesToGeographic(ndcToMap(ndc));
+        return true;
+    }
+    vec2 onDisk = ndc / GlobeScale();
+    float distance = dot(onDisk, onDisk);
+    if (distance > 1.0f) return false;
+    vec3 viewed(onDisk, std::sqrt(1.0f - distance));
+    geo = dvec2(cartesianToGeographic(transpose(GlobeRotation()) * viewed));
+    return std::abs(geo.x) <= 85.0;
+}
+
+
+/**
+ * Projects a map position onto the screen, like the shaders do.
+ *
+ * @param map The position, in normalized map coordinates.
+ * @param ndc Receives the screen position, in normalized device coordinates.
+ * @return False if the position is off the screen or on the far side of the globe.
+ */
+bool Camera::mapToNdc(const dvec2 &map, vec2 &ndc) const {
+    if (globe) {
+        vec3 viewed = GlobeRotation() * geoToCartesian(mapCoordinatesToGeographic(map));
+        if (viewed.z < 0.0f) return false;
+        ndc = vec2(viewed) * GlobeScale();
+    } else {
+        dvec2 visibleMin = VisibleMin();
+        double x = map.x - 2.0 * std::floor((map.x - visibleMin.x) / 2.0);   // copy of the map in view
+        ndc = vec2((dvec2(x, map.y) - center) * zoom);
+    }
+    return std::abs(ndc.x) <= 1.0f && std::abs(ndc.y) <= 1.0f;
+}
+
+
+/**
+ * Finds the copies of the map that overlap the view. Copy `k` covers x in
+ * [2k - 1, 2k + 1]. The globe is a single copy.
+ *
+ * @param margin How far the drawn geometry may reach beyond its copy, in
+ *               normalized map units, at most `HalfWorld`; 0 for geometry within the map.
+ * @param first  Receives the first overlapping copy.
+ * @param count  Receives the number of overlapping copies, from 1 to `MaxWorldCopies`.
+ */
+void Camera::worldCopies(float margin, int &first, int &count) const {
+    if (globe) {
+        first = 0;
+        count = 1;
+        return;
+    }
+    dvec2 visibleMin = VisibleMin(), visibleMax = VisibleMax();
+    first = static_cast<int>(std::ceil((visibleMin.x - 1.0 - margin) / 2.0));
+    int last = static_cast<int>(std::floor((visibleMax.x + 1.0 + margin) / 2.0));
+    if (2.0 * first + 1.0 + margin <= visibleMin.x) ++first;
+    if (2.0 * last - 1.0 - margin >= visibleMax.x) --last;
+    count = std::clamp(last - first + 1, 1, MaxWorldCopies);
+}
+
+
+/**
+ * Sets the world copies to draw on a program that positions its vertices on
+ * the map. The view transformation itself, with the view center moved into
+ * each copy that geometry reaching `HalfWorld` beyond its copy can overlap,
+ * is in the `View` uniform block of the view being drawn (see `ViewUniforms`);
+ * this picks the copies the geometry overlaps out of those. On the globe
+ * there is a single copy, and the block holds the rotation and the radius.
+ *
+ * @param prog   A program of any variant except `SDF_TEXT`, already in use; a
+ *               `GLOBE` variant on the globe.
+ * @param margin How far the drawn geometry may reach beyond its copy, see `worldCopies`.
+ * @return The number of copies; the draw call multiplies its instance count by it.
+ */
+int Camera::setUniforms(GPUProgram *prog, float margin) const {
+    if (globe) return 1;
+    int base, baseCount, first, count;
+    worldCopies(HalfWorld, base, baseCount);
+    worldCopies(margin, first, count);
+    prog->setUniform(std::clamp(first - base, 0, baseCount - count), "copyOffset");
+    prog->setUniform(count, "worldCopies");
+    return count;
+}
@@ -0,0 +1,96 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "framework.h"
+#include "Path.h"
+
+
+/**
+ * @class Camera
+ * @brief The part of the map shown on the screen: the Mercator map with endless horizontal panning, or the globe.
+ *
+ * The view is given by the normalized map position at the center of the screen
+ * and a zoom factor; at zoom 1 the whole map height fills the screen. The map
+ * repeats every 2 units in x, so the center may be panned without limit: it is
+ * kept in [-1, 1) and the map, the land, the network and the vehicles are drawn
+ * as world copies shifted by multiples of 2. The copies are instances of the
+ * same draw call, selected in the vertex shader from `gl_InstanceID`, and only
+ * the copies that overlap the view are drawn, so the geometry is never
+ * duplicated and wrapping costs at most one extra instance per object.
+ *
+ * The center and the zoom are doubles, so the view can zoom in to street
+ * level. The shaders receive the center of every drawn copy as a high/low pair
+ * of floats (see `splitPosition`) in the uniform block of the view (see
+ * `ViewUniforms`) and subtract it from the vertex positions before scaling.
+ * Panning only changes these uniforms, never a vertex buffer.
+ *
+ * In globe mode the Earth is drawn as an orthographic view of the unit sphere,
+ * turned so that the geographic position of the center faces the viewer, with
+ * a radius of `GlobeRadius` times the zoom. The same unit vectors that the
+ * shaders project onto the map are then only rotated and scaled; points on the
+ * far side get a negative clip distance (their dot product with the view
+ * direction), so the hardware removes them and cuts lines at the horizon.
+ * The globe is drawn in float, so it zooms in to `MaxGlobeZoom` only.
+ *
+ * The camera is a plain value: the main thread changes it on input and hands a
+ * copy to the render thread with each scene snapshot. Every view on the screen
+ * has its own camera.
+ */
+class Camera final {
+public:
+    static constexpr double MinZoom = 1.0;
+    static constexpr double MaxZoom = 262144.0;   // about 0.25 m per pixel
+    static constexpr float HalfWorld = 1.0f;      // largest overhang of an unwrapped great-circle arc
+    static constexpr int MaxWorldCopies = 3;      // copies overlapping the view with a HalfWorld margin
+    static constexpr double MaxGlobeZoom = 4096.0; // a float unit vector stays within 0.1 pixel
+    static constexpr float GlobeRadius = 0.9f;    // in NDC at zoom 1
+
+private:
+    dvec2 center = dvec2(0.0, 0.0);
+    double zoom = MinZoom;
+    bool globe = false;
+
+    void clampCenter();
+
+public:
+    Camera() = default;
+
+    bool operator==(const Camera &other) const {
+        return center == other.center && zoom == other.zoom && globe == other.globe;
+    }
+
+    bool operator!=(const Camera &other) const { return !(*this == other); }
+
+    dvec2 Center() const { return center; }
+
+    double Zoom() const { return zoom; }
+
+    dvec2 VisibleMin() const { return center - dvec2(1.0 / zoom, 1.0 / zoom); }
+
+    dvec2 VisibleMax() const { return center + dvec2(1.0 / zoom, 1.0 / zoom); }
+
+    bool IsGlobe() const { return globe; }
+
+    float GlobeScale() const { return GlobeRadius * static_cast<float>(zoom); }
+
+    mat3 GlobeRotation() const;
+
+    void setGlobe(bool enabled);
+
+    void pan(const vec2 &ndcOffset);
+
+    void zoomAt(const vec2 &ndc, double factor);
+
+    dvec2 ndcToMap(const vec2 &ndc) const;
+
+    bool ndcToGeographic(const vec2 &ndc, dvec2 &geo) const;
+
+    bool mapToNdc(const dvec2 &map, vec2 &ndc) const;
+
+    void worldCopies(float margin, int &first, int &count) const;
+
+    int setUniforms(GPUProgram *prog, float margin = 0.0f) const;
+};
+
+
+#endif //CAMERA_H
@@ -0,0 +1,66 @@
+#include "CoastlineLayer.h"
+
+
+/**
+ * Creates the vertex array and its buffers; they are filled by `setMesh`.
+ */
+CoastlineLayer::CoastlineLayer() {
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ibo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), nullptr);
+    glBindVertexArray(0);
+}
+
+
+/**
+ * Uploads the vertices and indices of a mesh, replacing the previous one.
+ *
+ * @param mesh The triangulated land polygons.
+ */
+void CoastlineLayer::setMesh(const CoastlineMesh &mesh) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(mesh.Vertices().size() * sizeof(vec2)),
+                 mesh.Vertices().data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(mesh.Indices().size() * sizeof(uint32_t)),
+                 mesh.Indices().data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    indexCount = static_cast<GLsizei>(mesh.Indices().size());
+}
+
+
+/**
+ * Draws the land with a single indexed draw call, blended over what is already drawn.
+ *
+ * @param prog    A `GEO_POSITION | FLAT_COLOR` program, already in use.
+ * @param camera  The view to draw; every visible copy of the map is one instance.
+ * @param color   The color of the land.
+ * @param opacity How much the land covers the map below, from 0 to 1.
+ */
+void CoastlineLayer::DrawLand(GPUProgram *prog, const Camera &camera, vec3 color, float opacity) const {
+    if (indexCount == 0) return;
+    prog->setUniform(color, "color");
+    int copies = camera.setUniforms(prog);
+    glEnable(GL_BLEND);
+    glBlendColor(0.0f, 0.0f, 0.0f, opacity);
+    glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+    glBindVertexArray(vao);
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr, copies);
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+}
+
+
+/**
+ * Destructor for the `CoastlineLayer` class. Releases the buffers and the vertex array.
+ */
+CoastlineLayer::~CoastlineLayer() {
+    glDeleteBuffers(1, &ibo);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+}
@@ -0,0 +1,37 @@
+#ifndef COASTLINELAYER_H
+#define COASTLINELAYER_H
+
+#include "framework.h"
+#include "CoastlineMesh.h"
+#include "Camera.h"
+
+
+/**
+ * @class CoastlineLayer
+ * @brief Draws the triangulated land polygons over the map texture in one indexed draw call.
+ *
+ * The vertices stay in degrees and are projected by the `GEO_POSITION` shader
+ * variant. The land is blended over the map with a constant opacity, so the
+ * day-night shading of the map still shows through. Nothing is drawn until
+ * `setMesh` has uploaded a mesh.
+ */
+class CoastlineLayer final {
+    unsigned int vao = 0;
+    unsigned int vbo = 0;
+    unsigned int ibo = 0;
+    GLsizei indexCount = 0;
+
+public:
+    CoastlineLayer();
+
+    void setMesh(const CoastlineMesh &mesh);
+
+    size_t TriangleCount() const { return static_cast<size_t>(indexCount) / 3; }
+
+    void DrawLand(GPUProgram *prog, const Camera &camera, vec3 color, float opacity) const;
+
+    ~CoastlineLayer();
+};
+
+
+#endif //COASTLINELAYER_H
@@ -0,0 +1,270 @@
+#include "CoastlineMesh.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+
+#pragma pack(push, 1)
+/**
+ * Header of the binary cache, followed by the vertices as (latitude, longitude)
+ * float pairs and the indices as 32-bit integers.
+ */
+struct CoastlineCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceSize;     // size of the polygon file the cache was built from
+    int64_t sourceTime;      // its modification time, in file clock ticks
+    uint32_t vertexCount;
+    uint32_t indexCount;
+};
+#pragma pack(pop)
+
+
+/**
+ * Twice the signed area of the triangle (a, b, c); positive if counterclockwise.
+ */
+static inline float cross(const vec2 &a, const vec2 &b, const vec2 &c) {
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+
+/**
+ * Keeps the part of a polygon on one side of the vertical line x = `limit`
+ * (Sutherland-Hodgman). Concave polygons may come out with zero-width bridges
+ * along the line, which the triangulation turns into zero-area triangles.
+ *
+ * @param polygon The polygon, as (x, y) points.
+ * @param limit   The x coordinate of the line.
+ * @param below   True to keep x <= limit, false to keep x >= limit.
+ */
+static std::vector<vec2> clipAt(const std::vector<vec2> &polygon, float limit, bool below) {
+    std::vector<vec2> result;
+    auto inside = [limit, below](const vec2 &p) { return below ? p.x <= limit : p.x >= limit; };
+    for (size_t i = 0; i < polygon.size(); ++i) {
+        const vec2 &current = polygon[i];
+        const vec2 &previous = polygon[(i + polygon.size() - 1) % polygon.size()];
+        if (inside(current) != inside(previous)) {
+            float t = (limit - previous.x) / (current.x - previous.x);
+            result.push_back(vec2(limit, previous.y + t * (current.y - previous.y)));
+        }
+        if (inside(current)) result.push_back(current);
+    }
+    return result;
+}
+
+
+/**
+ * Builds the mesh, from the cache if it matches the polygon file, otherwise by
+ * splitting and triangulating the rings of the polygon file, and then caches it.
+ * A missing polygon file leaves the mesh empty.
+ *
+ * @param source    The polygon file.
+ * @param cacheFile Path of the binary cache.
+ */
+CoastlineMesh::CoastlineMesh(const fs::path &source, const fs::path &cacheFile) {
+    std::error_code error;
+    uint64_t sourceSize = fs::file_size(source, error);
+    if (error) {
+        std::cerr << "Cannot read land polygons " << source << std::endl;
+        return;
+    }
+    int64_t sourceTime = fs::last_write_time(source, error).time_since_epoch().count();
+    if (load(cacheFile, sourceSize, sourceTime)) {
+        cached = true;
+        return;
+    }
+    std::vector<std::string> names;
+    std::vector<std::vector<vec2>> rings;
+    if (!readPolygons(source, names, rings)) return;
+    for (std::vector<vec2> &ring: rings)
+        for (std::vector<vec2> &piece: splitAtAntimeridian(std::move(ring))) triangulate(std::move(piece));
+    save(cacheFile, sourceSize, sourceTime);
+}
+
+
+/**
+ * Reads the rings of a polygon file, as (longitude, latitude) points.
+ *
+ * @param source The polygon file.
+ * @param names  Receives the name of each ring.
+ * @param rings  Receives the rings; rings with fewer than three vertices are dropped.
+ * @return False if the file cannot be opened.
+ */
+bool CoastlineMesh::readPolygons(const fs::path &source, std::vector<std::string> &names,
+                                 std::vector<std::vector<vec2>> &rings) {
+    std::ifstream file(source);
+    if (!file) {
+        std::cerr << "Cannot read polygons " << source << std::endl;
+        return false;
+    }
+    auto finish = [&names, &rings]() {
+        if (!rings.empty() && rings.back().size() < 3) {
+            rings.pop_back();
+            names.pop_back();
+        }
+    };
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream words(line);
+        std::string first;
+        if (!(words >> first) || first[0] == '#') continue;
+        if (first == "polygon") {
+            finish();
+            std::string name;
+            std::getline(words >> std::ws, name);
+            names.push_back(name);
+            rings.emplace_back();
+            continue;
+        }
+        float longitude;
+        if (!rings.empty() && (words >> longitude)) rings.back().push_back(vec2(longitude, std::stof(first)));
+    }
+    finish();
+    return true;
+}
+
+
+/**
+ * Unwraps a ring, closes it over the pole if it goes around the globe, and clips
+ * it into the longitude windows it spans, each shifted back into [-180, 180].
+ *
+ * @param ring The ring, as (longitude, latitude) points.
+ * @return The pieces of the ring; none if it has fewer than three vertices.
+ */
+std::vector<std::vector<vec2>> CoastlineMesh::splitAtAntimeridian(std::vector<vec2> ring) {
+    std::vector<std::vector<vec2>> pieces;
+    if (!ring.empty() && ring.front() == ring.back()) ring.pop_back();
+    if (ring.size() < 3) return pieces;
+    for (size_t i = 1; i < ring.size(); ++i)
+        ring[i].x -= 360.0f * std::round((ring[i].x - ring[i - 1].x) / 360.0f);
+
+    float closing = ring.front().x - ring.back().x;
+    float winding = ring.back().x - ring.front().x + closing - 360.0f * std::round(closing / 360.0f);
+    if (fabsf(winding) > 180.0f) {
+        float sumLatitude = 0.0f;
+        for (const vec2 &point: ring) sumLatitude += point.y;
+        float pole = sumLatitude < 0.0f ? -90.0f : 90.0f;
+        vec2 start = ring.front();
+        ring.push_back(vec2(start.x + winding, start.y));
+        ring.push_back(vec2(start.x + winding, pole));
+        ring.push_back(vec2(start.x, pole));
+    }
+
+    float minX = ring[0].x, maxX = ring[0].x;
+    for (const vec2 &point: ring) {
+        minX = std::min(minX, point.x);
+        maxX = std::max(maxX, point.x);
+    }
+    auto firstWindow = static_cast<int>(std::floor((minX + 180.0f) / 360.0f));
+    auto lastWindow = static_cast<int>(std::floor((maxX + 180.0f) / 360.0f));
+    for (int window = firstWindow; window <= lastWindow; ++window) {
+        float offset = 360.0f * static_cast<float>(window);
+        std::vector<vec2> piece = clipAt(clipAt(ring, offset - 180.0f, false), offset + 180.0f, true);
+        for (vec2 &point: piece) point.x -= offset;
+        if (piece.size() >= 3) pieces.push_back(std::move(piece));
+    }
+    return pieces;
+}
+
+
+/**
+ * Triangulates a simple polygon by ear clipping and appends the triangles.
+ *
+ * A vertex is an ear if it is convex and no other vertex lies in the triangle
+ * it forms with its neighbors; cutting it off leaves a simple polygon again.
+ * Clipping can leave degenerate spots where no strict ear exists, in which case
+ * the current vertex is cut off anyway so the loop always terminates.
+ *
+ * @param polygon The polygon, as (longitude, latitude) points.
+ */
+void CoastlineMesh::triangulate(std::vector<vec2> polygon) {
+    polygon.erase(std::unique(polygon.begin(), polygon.end()), polygon.end());
+    while (polygon.size() > 1 && polygon.front() == polygon.back()) polygon.pop_back();
+    size_t count = polygon.size();
+    if (count < 3) return;
+
+    float area = 0.0f;
+    for (size_t i = 0; i < count; ++i) area += cross(vec2(0.0f), polygon[i], polygon[(i + 1) % count]);
+    if (area < 0.0f) std::reverse(polygon.begin(), polygon.end());
+
+    auto base = static_cast<uint32_t>(vertices.size());
+    for (const vec2 &point: polygon) vertices.push_back(vec2(point.y, point.x));
+
+    std::vector<uint32_t> previous(count), next(count);
+    for (size_t i = 0; i < count; ++i) {
+        previous[i] = static_cast<uint32_t>((i + count - 1) % count);
+        next[i] = static_cast<uint32_t>((i + 1) % count);
+    }
+    auto isEar = [&](uint32_t vertex) {
+        const vec2 &a = polygon[previous[vertex]], &b = polygon[vertex], &c = polygon[next[vertex]];
+        if (cross(a, b, c) <= 0.0f) return false;
+        for (uint32_t other = next[next[vertex]]; other != previous[vertex]; other = next[other]) {
+            const vec2 &p = polygon[other];
+            if (p == a || p == b || p == c) continue;
+            if (cross(a, b, p) >= 0.0f && cross(b, c, p) >= 0.0f && cross(c, a, p) >= 0.0f) return false;
+        }
+        return true;
+    };
+
+    uint32_t vertex = 0;
+    size_t remaining = count, attempts = 0;
+    while (remaining > 3) {
+        if (isEar(vertex) || attempts > remaining) {
+            indices.insert(indices.end(), {base + previous[vertex], base + vertex, base + next[vertex]});
+            next[previous[vertex]] = next[vertex];
+            previous[next[vertex]] = previous[vertex];
+            vertex = previous[vertex];
+            --remaining;
+            attempts = 0;
+        } else {
+            vertex = next[vertex];
+            ++attempts;
+        }
+    }
+    indices.insert(indices.end(), {base + previous[vertex], base + vertex, base + next[vertex]});
+}
+
+
+/**
+ * Loads the mesh from the cache file if it was built from the same polygon file.
+ *
+ * @return False if the cache is missing, stale or damaged.
+ */
+bool CoastlineMesh::load(const fs::path &cacheFile, uint64_t sourceSize, int64_t sourceTime) {
+    std::ifstream file(cacheFile, std::ios::binary);
+    CoastlineCacheHeader header{};
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != CacheMagic ||
+        header.version != CacheVersion || header.sourceSize != sourceSize || header.sourceTime != sourceTime)
+        return false;
+    vertices.resize(header.vertexCount);
+    indices.resize(header.indexCount);
+    file.read(reinterpret_cast<char *>(vertices.data()), static_cast<std::streamsize>(vertices.size() * sizeof(vec2)));
+    file.read(reinterpret_cast<char *>(indices.data()), static_cast<std::streamsize>(indices.size() * sizeof(uint32_t)));
+    bool valid = static_cast<bool>(file) && std::all_of(indices.begin(), indices.end(), [this](uint32_t index) {
+        return index < vertices.size();
+    });
+    if (!valid) {
+        vertices.clear();
+        indices.clear();
+    }
+    return valid;
+}
+
+
+/**
+ * Writes the mesh into the cache file. A failure is reported but otherwise
+ * ignored; the mesh is then triangulated again on the next start.
+ */
+void CoastlineMesh::save(const fs::path &cacheFile, uint64_t sourceSize, int64_t sourceTime) const {
+    std::error_code error;
+    fs::create_directories(cacheFile.parent_path(), error);
+    CoastlineCacheHeader header{CacheMagic, CacheVersion, sourceSize, sourceTime,
+                                static_cast<uint32_t>(vertices.size()), static_cast<uint32_t>(indices.size())};
+    std::ofstream file(cacheFile, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(vertices.data()),
+               static_cast<std::streamsize>(vertices.size() * sizeof(vec2)));
+    file.write(reinterpret_cast<const char *>(indices.data()),
+               static_cast<std::streamsize>(indices.size() * sizeof(uint32_t)));
+    if (!file) std::cerr << "Cannot write land mesh cache " << cacheFile << std::endl;
+}
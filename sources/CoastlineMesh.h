@@ -0,0 +1,64 @@
+#ifndef COASTLINEMESH_H
+#define COASTLINEMESH_H
+
+#include "framework.h"
+#include <cstdint>
+
+
+/**
+ * @class CoastlineMesh
+ * @brief Triangulated land polygons read from a simple polygon file.
+ *
+ * The polygon file is text: a line `polygon <name>` starts a ring, followed by
+ * one `<latitude> <longitude>` line per vertex; `#` starts a comment. Rings are
+ * simple polygons without holes, closed implicitly, in either direction.
+ *
+ * Each ring is unwrapped so that consecutive longitudes differ by less than
+ * 180 degrees. A ring that then goes once around the globe encloses a pole and
+ * is closed over it. The ring is clipped into the [-180, 180] longitude windows
+ * it spans, each piece is shifted into the map, and triangulated by ear
+ * clipping. No triangle crosses the antimeridian, so the mesh can be drawn on
+ * the Mercator map as is.
+ *
+ * Ear clipping is quadratic in the number of vertices of a ring, so the result
+ * is cached in a binary file holding the vertices and indices as they are
+ * uploaded. The cache records the size and modification time of the polygon
+ * file and is rebuilt whenever they change. Loading it is a single read.
+ *
+ * Like `GlyphAtlas`, it does not touch OpenGL and can be built on a worker.
+ * Reading the polygon file and splitting rings at the antimeridian are also
+ * available on their own, for other users of polygon files such as `RegionIndex`.
+ */
+class CoastlineMesh final {
+public:
+    static constexpr uint32_t CacheMagic = 0x31444e4c;   // "LND1"
+    static constexpr uint32_t CacheVersion = 1;
+
+private:
+    std::vector<vec2> vertices;     // (latitude, longitude) in degrees
+    std::vector<uint32_t> indices;  // triangles
+    bool cached = false;
+
+    void triangulate(std::vector<vec2> polygon);
+
+    bool load(const fs::path &cacheFile, uint64_t sourceSize, int64_t sourceTime);
+
+    void save(const fs::path &cacheFile, uint64_t sourceSize, int64_t sourceTime) const;
+
+public:
+    CoastlineMesh(const fs::path &source, const fs::path &cacheFile);
+
+    static bool readPolygons(const fs::path &source, std::vector<std::string> &names,
+                             std::vector<std::vector<vec2>> &rings);
+
+    static std::vector<std::vector<vec2>> splitAtAntimeridian(std::vector<vec2> ring);
+
+    const std::vector<vec2> &Vertices() const { return vertices; }
+
+    const std::vector<uint32_t> &Indices() const { return indices; }
+
+    bool FromCache() const { return cached; }
+};
+
+
+#endif //COASTLINEMESH_H
@@ -0,0 +1,370 @@
+#include "ControlServer.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+
+/**
+ * Longest text line accepted; a client sending more without a line break is
+ * disconnected.
+ */
+static const size_t MaxLineLength = 4096;
+
+
+/**
+ * Starts listening on a Unix domain socket, replacing a stale socket file left
+ * behind by a previous run. Check `IsOpen` for success.
+ *
+ * @param socketPath File system path of the socket.
+ */
+ControlServer::ControlServer(const std::string &socketPath) : socketPath(socketPath) {
+#if defined(__unix__) || defined(__APPLE__)
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Control socket path is too long: " << socketPath << std::endl;
+        return;
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    unlink(socketPath.c_str());
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+        listen(listenFd, 16) < 0) {
+        std::cerr << "Cannot listen on control socket " << socketPath << std::endl;
+        if (listenFd >= 0) close(listenFd);
+        listenFd = -1;
+        return;
+    }
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+    std::cout << "Control socket listening on " << socketPath << std::endl;
+#else
+    std::cerr << "The control socket needs Unix domain sockets and is disabled on this platform" << std::endl;
+#endif
+}
+
+
+/**
+ * Accepts every pending connection.
+ */
+void ControlServer::accept() {
+#if defined(__unix__) || defined(__APPLE__)
+    for (;;) {
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) return;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        clients.push_back(new Client{fd});
+    }
+#endif
+}
+
+
+/**
+ * Takes the next complete command off the client's input.
+ *
+ * @param client The client whose input is parsed.
+ * @param queued Receives the command; its `error` is set if it is malformed.
+ * @return False if the input does not hold a complete command yet.
+ */
+bool ControlServer::parse(Client &client, QueuedCommand &queued) {
+    std::string &error = queued.error;
+    error.clear();
+    queued.command.file.clear();
+    for (float &argument: queued.command.arguments) argument = 0.0f;
+
+    if (!client.input.empty() && client.input[0] == '\0') {
+        if (client.input.size() < sizeof(BinaryControlCommand)) return false;
+        BinaryControlCommand record;
+        std::memcpy(&record, client.input.data(), sizeof(record));
+        client.input.erase(0, sizeof(record));
+
+        queued.binary = true;
+        queued.command.opcode = static_cast<ControlCommand::Opcode>(record.opcode);
+        std::memcpy(queued.command.arguments, record.arguments, sizeof(record.arguments));
+        if (record.opcode < ControlCommand::AddStation || record.opcode > ControlCommand::QueryCoverage)
+            error = "unknown opcode";
+        else if (record.opcode == ControlCommand::Capture || record.opcode == ControlCommand::Replay ||
+                 record.opcode == ControlCommand::Export)
+            error = "capture, replay and export are text commands";
+        return true;
+    }
+
+    for (;;) {
+        size_t lineEnd = client.input.find('\n');
+        if (lineEnd == std::string::npos) {
+            if (client.input.size() > MaxLineLength) client.broken = true;
+            return false;
+        }
+        std::string line = client.input.substr(0, lineEnd);
+        client.input.erase(0, lineEnd + 1);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        std::istringstream words(line);
+        std::string name;
+        if (!(words >> name) || name[0] == '#') {
+            if (!client.input.empty() && client.input[0] == '\0') return parse(client, queued);
+            continue;
+        }
+
+        queued.binary = false;
+        int argumentCount = 0;
+        if (name == "station") {
+            queued.command.opcode = ControlCommand::AddStation;
+            argumentCount = 2;
+        } else if (name == "path") {
+            queued.command.opcode = ControlCommand::AddPath;
+            argumentCount = 2;
+        } else if (name == "hour") {
+            queued.command.opcode = ControlCommand::SetHour;
+            if (!(words >> queued.command.arguments[0])) error = "hour needs a number";
+            words >> queued.command.arguments[1];
+            return true;
+        } else if (name == "distance") {
+            queued.command.opcode = ControlCommand::QueryDistance;
+            argumentCount = 2;
+        } else if (name == "capture") {
+            queued.command.opcode = ControlCommand::Capture;
+            if (!(words >> queued.command.file)) error = "capture needs a file name";
+            return true;
+        } else if (name == "export") {
+            queued.command.opcode = ControlCommand::Export;
+            if (!(words >> queued.command.file)) error = "export needs a file name";
+            words >> queued.command.arguments[0];
+            return true;
+        } else if (name == "begin") {
+            queued.command.opcode = ControlCommand::Begin;
+        } else if (name == "end") {
+            queued.command.opcode = ControlCommand::End;
+        } else if (name == "fleet") {
+            queued.command.opcode = ControlCommand::AddFleet;
+            argumentCount = 2;
+        } else if (name == "replay") {
+            queued.command.opcode = ControlCommand::Replay;
+            if (!(words >> queued.command.file)) error = "replay needs a file name";
+            if (!(words >> queued.command.arguments[0])) queued.command.arguments[0] = 1.0f;
+            return true;
+        } else if (name == "region") {
+            queued.command.opcode = ControlCommand::QueryRegion;
+            argumentCount = 1;
+        } else if (name == "views") {
+            queued.command.opcode = ControlCommand::SetViews;
+            argumentCount = 1;
+        } else if (name == "marker") {
+            queued.command.opcode = ControlCommand::SetMarker;
+            argumentCount = 3;
+        } else if (name == "color") {
+            queued.command.opcode = ControlCommand::SetMarkerColor;
+            std::string hex;
+            if (!(words >> queued.command.arguments[0] >> hex) || hex.size() != 6 ||
+                hex.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+                error = "color needs a station and an rrggbb color";
+            else
+                queued.command.arguments[1] = static_cast<float>(std::stoul(hex, nullptr, 16));
+            words >> queued.command.arguments[2];
+            return true;
+        } else if (name == "state") {
+            queued.command.opcode = ControlCommand::SetStationState;
+            argumentCount = 2;
+        } else if (name == "pathstate") {
+            queued.command.opcode = ControlCommand::SetPathState;
+            argumentCount = 2;
+        } else if (name == "ring") {
+            queued.command.opcode = ControlCommand::AddRing;
+            argumentCount = 2;
+        } else if (name == "covered") {
+            queued.command.opcode = ControlCommand::QueryCoverage;
+            argumentCount = 2;
+        } else if (name == "speed") {
+            queued.command.opcode = ControlCommand::ReplaySpeed;
+            argumentCount = 1;
+        } else if (name == "scrub") {
+            queued.command.opcode = ControlCommand::Scrub;
+            argumentCount = 1;
+        } else if (name == "retire") {
+            queued.command.opcode = ControlCommand::RetireStation;
+            argumentCount = 2;
+        } else {
+            error = "unknown command " + name;
+            return true;
+        }
+        for (int i = 0; i < argumentCount; ++i)
+            if (!(words >> queued.command.arguments[i]))
+                error = name + " needs " + std::to_string(argumentCount) + " numbers";
+        return true;
+    }
+}
+
+
+/**
+ * Executes one command and queues its reply in the client's reply order.
+ *
+ * @return 1 if the executor ran, 0 if the command was malformed.
+ */
+size_t ControlServer::execute(Client &client, const QueuedCommand &queued, const Executor &executor) {
+    Ticket ticket = nextTicket++;
+    if (!queued.error.empty()) {
+        client.replies.push_back({ticket, queued.binary, true, ControlReply::error(queued.error)});
+        return 0;
+    }
+    ControlReply reply = executor(queued.command, ticket);
+    client.replies.push_back({ticket, queued.binary, !reply.deferred, reply});
+    return 1;
+}
+
+
+/**
+ * Encodes the replies that are ready, in order up to the first one still
+ * deferred, and writes as much as the socket accepts without blocking.
+ */
+void ControlServer::flush(Client &client) {
+#if defined(__unix__) || defined(__APPLE__)
+    while (!client.replies.empty() && client.replies.front().ready) {
+        const PendingReply &pending = client.replies.front();
+        const ControlReply &reply = pending.reply;
+        if (pending.binary) {
+            BinaryControlReply record{0, static_cast<uint8_t>(reply.ok ? 0 : 1), 0, reply.index, reply.value, 0};
+            client.output.append(reinterpret_cast<const char *>(&record), sizeof(record));
+        } else if (reply.ok) {
+            client.output += "ok";
+            if (reply.index >= 0) client.output += " " + std::to_string(reply.index);
+            if (reply.hasValue) {
+                char value[32];
+                std::snprintf(value, sizeof(value), " %.3f", reply.value);
+                client.output += value;
+            }
+            client.output += "\n";
+        } else {
+            client.output += "error " + reply.message + "\n";
+        }
+        client.replies.pop_front();
+    }
+
+    while (!client.output.empty()) {
+        ssize_t sent = send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) client.broken = true;
+            return;
+        }
+        client.output.erase(0, static_cast<size_t>(sent));
+    }
+#endif
+}
+
+
+/**
+ * Accepts connections, reads the available input of every client, executes the
+ * complete commands and batches in arrival order, and writes back the replies.
+ * Called once per simulation step on the main thread; never blocks.
+ *
+ * @param executor Applies one command to the application and returns its reply.
+ * @return The number of commands executed.
+ */
+size_t ControlServer::poll(const Executor &executor) {
+    if (!IsOpen()) return 0;
+    size_t executed = 0;
+#if defined(__unix__) || defined(__APPLE__)
+    accept();
+
+    char buffer[65536];
+    for (Client *client: clients) {
+        for (;;) {
+            ssize_t received = recv(client->fd, buffer, sizeof(buffer), 0);
+            if (received > 0) {
+                client->input.append(buffer, static_cast<size_t>(received));
+                continue;
+            }
+            if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) client->closed = true;
+            break;
+        }
+
+        QueuedCommand queued;
+        while (!client->broken && parse(*client, queued)) {
+            if (!queued.error.empty() && !client->inBatch) {
+                execute(*client, queued, executor);
+            } else if (queued.error.empty() && queued.command.opcode == ControlCommand::Begin) {
+                bool nested = client->inBatch;
+                client->inBatch = true;
+                client->replies.push_back({nextTicket++, queued.binary, true,
+                                           nested ? ControlReply::error("already in a batch") : ControlReply()});
+            } else if (queued.error.empty() && queued.command.opcode == ControlCommand::End) {
+                if (!client->inBatch) {
+                    client->replies.push_back({nextTicket++, queued.binary, true, ControlReply::error("no batch")});
+                    continue;
+                }
+                for (const auto &batched: client->batch) executed += execute(*client, batched, executor);
+                client->batch.clear();
+                client->inBatch = false;
+                client->replies.push_back({nextTicket++, queued.binary, true, ControlReply()});
+            } else if (client->inBatch) {
+                client->batch.push_back(queued);
+            } else {
+                executed += execute(*client, queued, executor);
+            }
+        }
+        if (!client->broken) flush(*client);
+    }
+
+    for (auto it = clients.begin(); it != clients.end();) {
+        Client *client = *it;
+        if (client->broken || (client->closed && client->replies.empty() && client->output.empty())) {
+            close(client->fd);
+            delete client;
+            it = clients.erase(it);
+        } else {
+            ++it;
+        }
+    }
+#endif
+    return executed;
+}
+
+
+/**
+ * Completes a deferred reply. The reply is written with the next `poll`, after
+ * the replies preceding it. Tickets of clients that disconnected are ignored.
+ *
+ * @param ticket The ticket the executor received with the deferred command.
+ * @param reply  The final reply.
+ */
+void ControlServer::complete(Ticket ticket, const ControlReply &reply) {
+    for (Client *client: clients) {
+        for (auto &pending: client->replies) {
+            if (pending.ticket == ticket) {
+                pending.reply = reply;
+                pending.ready = true;
+                return;
+            }
+        }
+    }
+}
+
+
+/**
+ * Destructor for the `ControlServer` class. Closes every connection and removes
+ * the socket file.
+ */
+ControlServer::~ControlServer() {
+#if defined(__unix__) || defined(__APPLE__)
+    for (Client *client: clients) {
+        close(client->fd);
+        delete client;
+    }
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+#endif
+}
@@ -0,0 +1,169 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+/**
+ * A command received on the control socket.
+ *
+ * Text commands are lines of the form `station <lat> <lon>`, `path <from> <to>`,
+ * `hour <offset> [view]`, `distance <from> <to>`, `capture <file.png>`, `begin`, `end`,
+ * `fleet <vehicles> <speed>`, `scrub <hours>`, `retire <station> <hours>`,
+ * `replay <file.trk> [speed]`, `speed <factor>`, `region <station>`, `views <count>`,
+ * `export <file.svg|file.pdf> [view]`, `marker <station> <icon> <size>`,
+ * `color <station> <rrggbb> [flags]`, `state <station> <flags>`, `pathstate <path> <flags>`,
+ * `ring <station> <km>` and `covered <lat> <lon>`.
+ * Binary commands are 16-byte `BinaryControlCommand` records and are told apart
+ * from text by their leading zero byte; both kinds can be mixed on one connection.
+ */
+struct ControlCommand {
+    enum Opcode : uint8_t {
+        AddStation = 1,   // arguments: latitude, longitude in degrees
+        AddPath = 2,      // arguments: indices of the two stations
+        SetHour = 3,      // arguments: hour offset, view (1-based, 0 for all views)
+        QueryDistance = 4, // arguments: indices of the two stations
+        Capture = 5,      // file: PNG to write the next frame to (text only)
+        Begin = 6,        // starts a batch
+        End = 7,          // ends a batch
+        AddFleet = 8,     // arguments: number of vehicles, speed in km/s
+        Scrub = 9,        // arguments: timeline time in hours
+        RetireStation = 10, // arguments: index of the station, disappear time in hours
+        Replay = 11,      // file: trajectory file to replay (text only); arguments: speed
+        ReplaySpeed = 12, // arguments: speed of the replay relative to real time
+        QueryRegion = 13, // arguments: index of the station
+        SetViews = 14,    // arguments: number of views, 1, 4 or 9
+        Export = 15,      // file: SVG or PDF to write (text only); arguments: view (1-based, 0 for the first)
+        SetMarker = 16,   // arguments: index of the station, icon, size in pixels
+        SetMarkerColor = 17, // arguments: index of the station, color as the integer 0xRRGGBB, style flags
+        SetStationState = 18, // arguments: index of the station, selected (1) and dimmed (4) flags
+        SetPathState = 19, // arguments: index of the path, selected (1) and dimmed (4) flags
+        AddRing = 20,     // arguments: index of the station at the center, radius in km
+        QueryCoverage = 21, // arguments: latitude, longitude in degrees
+    };
+
+    Opcode opcode;
+    float arguments[3];
+    std::string file;
+};
+
+
+/**
+ * The reply to one command. Commands that cannot be answered within the current
+ * step, such as frame captures, return a deferred reply and are answered later
+ * through `ControlServer::complete`.
+ */
+struct ControlReply {
+    bool ok = true;
+    bool deferred = false;
+    int index = -1;        // index of a created station or path, or of a region; -1 if none
+    float value = 0.0f;    // e.g. a distance in kilometers
+    bool hasValue = false;
+    std::string message;   // error description
+
+    static ControlReply error(const std::string &message) {
+        ControlReply reply;
+        reply.ok = false;
+        reply.message = message;
+        return reply;
+    }
+};
+
+
+#pragma pack(push, 1)
+struct BinaryControlCommand {
+    uint8_t marker;      // always 0
+    uint8_t opcode;      // ControlCommand::Opcode
+    uint16_t reserved;
+    float arguments[3];
+};
+
+struct BinaryControlReply {
+    uint8_t marker;      // always 0
+    uint8_t status;      // 0: ok, 1: error
+    uint16_t reserved;
+    int32_t index;
+    float value;
+    uint32_t reserved2;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(BinaryControlCommand) == 16 && sizeof(BinaryControlReply) == 16,
+              "binary control records are 16 bytes");
+
+
+/**
+ * @class ControlServer
+ * @brief Unix domain socket accepting batched scripting commands from automation clients.
+ *
+ * The server never blocks: `poll` is called once per simulation step on the main
+ * thread, accepts connections, reads whatever arrived, executes every complete
+ * command and writes back what the sockets accept. All commands executed by one
+ * call take effect in the same step, and commands between `begin` and `end` are
+ * held back until `end` has arrived, so a batch is never split across frames.
+ *
+ * Replies are pipelined: a client can send thousands of commands without waiting
+ * and reads one reply per command, in command order. A deferred reply holds back
+ * the replies after it until it is completed.
+ */
+class ControlServer final {
+public:
+    using Ticket = uint64_t;
+    using Executor = std::function<ControlReply(const ControlCommand &command, Ticket ticket)>;
+
+private:
+    struct PendingReply {
+        Ticket ticket;
+        bool binary;
+        bool ready;
+        ControlReply reply;
+    };
+
+    struct QueuedCommand {
+        ControlCommand command;
+        bool binary;
+        std::string error;   // set for malformed commands, which are answered with it
+    };
+
+    struct Client {
+        int fd;
+        std::string input;
+        std::string output;
+        std::deque<PendingReply> replies;
+        std::vector<QueuedCommand> batch;
+        bool inBatch = false;
+        bool closed = false;   // no more input; replies are still written
+        bool broken = false;   // dropped without writing the remaining replies
+    };
+
+    std::string socketPath;
+    int listenFd = -1;
+    std::vector<Client *> clients;
+    Ticket nextTicket = 1;
+
+    void accept();
+
+    bool parse(Client &client, QueuedCommand &queued);
+
+    size_t execute(Client &client, const QueuedCommand &queued, const Executor &executor);
+
+    void flush(Client &client);
+
+public:
+    explicit ControlServer(const std::string &socketPath);
+
+    bool IsOpen() const { return listenFd >= 0; }
+
+    size_t poll(const Executor &executor);
+
+    void complete(Ticket ticket, const ControlReply &reply);
+
+    ~ControlServer();
+};
+
+
+#endif //CONTROLSERVER_H
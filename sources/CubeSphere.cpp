@@ -0,0 +1,210 @@
+#include "CubeSphere.h"
+#include <algorithm>
+#include <cmath>
+
+
+/**
+ * Normal and the two axes of each face of the cube, matching the vertex shader.
+ */
+static const vec3 FaceNormals[6] = {vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0),
+                                    vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1)};
+static const vec3 FaceU[6] = {vec3(0, 1, 0), vec3(0, -1, 0), vec3(-1, 0, 0),
+                              vec3(1, 0, 0), vec3(0, 1, 0), vec3(0, 1, 0)};
+static const vec3 FaceV[6] = {vec3(0, 0, 1), vec3(0, 0, 1), vec3(0, 0, 1),
+                              vec3(0, 0, 1), vec3(-1, 0, 0), vec3(1, 0, 0)};
+
+
+/**
+ * Creates the shared vertex grid, the index buffer of every level and the
+ * vertex array. The grid points are stored as (u, v) in [0, 1] within a patch.
+ *
+ * @param viewportHeight Height of the target in pixels, which the error is measured in.
+ */
+CubeSphere::CubeSphere(int viewportHeight) : viewportHeight(viewportHeight) {
+    const int gridSize = 1 << MaxLevel;
+    std::vector<vec2> grid;
+    for (int y = 0; y <= gridSize; ++y)
+        for (int x = 0; x <= gridSize; ++x)
+            grid.push_back(vec2(static_cast<float>(x), static_cast<float>(y)) / static_cast<float>(gridSize));
+
+    std::vector<uint32_t> indices;
+    for (int level = 0; level <= MaxLevel; ++level) {
+        indexOffsets[level] = indices.size() * sizeof(uint32_t);
+        int step = 1 << (MaxLevel - level);
+        auto vertex = [gridSize](int x, int y) { return static_cast<uint32_t>(y * (gridSize + 1) + x); };
+        for (int y = 0; y < gridSize; y += step)
+            for (int x = 0; x < gridSize; x += step)
+                indices.insert(indices.end(), {vertex(x, y), vertex(x + step, y), vertex(x + step, y + step),
+                                               vertex(x, y), vertex(x + step, y + step), vertex(x, y + step)});
+        indexCounts[level] = static_cast<GLsizei>(indices.size() - indexOffsets[level] / sizeof(uint32_t));
+    }
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vertexVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexVbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(grid.size() * sizeof(vec2)), grid.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glGenBuffers(1, &ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(uint32_t)), indices.data(),
+                 GL_STATIC_DRAW);
+
+    glGenBuffers(1, &instanceVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, 6 * PatchesPerSide * PatchesPerSide * sizeof(PatchInstance), nullptr,
+                 GL_DYNAMIC_DRAW);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(PatchInstance),
+                          reinterpret_cast<void *>(offsetof(PatchInstance, patch)));
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(PatchInstance),
+                          reinterpret_cast<void *>(offsetof(PatchInstance, edgeSegments)));
+    glVertexAttribDivisor(2, 1);
+    glBindVertexArray(0);
+}
+
+
+/**
+ * Returns the point of the sphere at a position on a face of the cube, like
+ * the vertex shader. Coordinates on the border of the face skip the tangent,
+ * so the faces sharing an edge compute its points from the same cube coordinates.
+ *
+ * @param face The face, 0 to 5.
+ * @param uv   The position on the face, in [0, 1].
+ * @return The unit vector.
+ */
+vec3 CubeSphere::surfacePoint(int face, const vec2 &uv) {
+    vec2 cube = uv * 2.0f - 1.0f;
+    for (int axis = 0; axis < 2; ++axis)
+        if (std::abs(cube[axis]) < 1.0f) cube[axis] = std::tan(cube[axis] * static_cast<float>(M_PI / 4.0));
+    return normalize(FaceNormals[face] + cube.x * FaceU[face] + cube.y * FaceV[face]);
+}
+
+
+/**
+ * Changes the height of the target the error is measured in, e.g. when the
+ * window is split into several views. The patches are chosen again on the next draw.
+ *
+ * @param height Height of the view in pixels.
+ */
+void CubeSphere::setViewportHeight(int height) {
+    viewportHeight = height;
+    chosen = false;
+}
+
+
+/**
+ * Finds the level of an edge: the fewest segments, as a power of two, whose
+ * chords deviate from the sphere by at most `MaxErrorPixels` on the screen.
+ * The deviation is radial, so it shrinks towards the center of the view, where
+ * the surface faces the viewer.
+ *
+ * @param start         One endpoint of the edge.
+ * @param end           The other endpoint.
+ * @param view          The direction towards the viewer.
+ * @param pixelsPerUnit Pixels per unit length on the screen, the radius of the globe in pixels.
+ * @return The level, from 0 (one segment) to `MaxLevel`.
+ */
+int CubeSphere::edgeLevel(const vec3 &start, const vec3 &end, const vec3 &view, float pixelsPerUnit) const {
+    float inPlane = 0.0f;
+    for (const vec3 &point: {start, end, normalize(start + end)}) {
+        float facing = dot(point, view);
+        inPlane = std::max(inPlane, facing < 0.0f ? 1.0f : std::sqrt(std::max(0.0f, 1.0f - facing * facing)));
+    }
+    float angle = std::acos(std::clamp(dot(start, end), -1.0f, 1.0f));
+    for (int level = 0; level < MaxLevel; ++level) {
+        float halfSegment = 0.5f * angle / static_cast<float>(1 << level);
+        if (pixelsPerUnit * inPlane * (1.0f - std::cos(halfSegment)) <= MaxErrorPixels) return level;
+    }
+    return MaxLevel;
+}
+
+
+/**
+ * Culls the patches and chooses the levels of their edges for a view, and
+ * uploads them sorted by level.
+ */
+void CubeSphere::choosePatches(const Camera &camera) {
+    mat3 rotation = camera.GlobeRotation();
+    vec3 view = transpose(rotation)[2];
+    float scale = camera.GlobeScale();
+    float pixelsPerUnit = scale * 0.5f * static_cast<float>(viewportHeight);
+    const float size = 1.0f / PatchesPerSide;
+
+    std::vector<PatchInstance> byLevel[MaxLevel + 1];
+    for (int face = 0; face < 6; ++face) {
+        for (int j = 0; j < PatchesPerSide; ++j) {
+            for (int i = 0; i < PatchesPerSide; ++i) {
+                vec2 origin = vec2(static_cast<float>(i), static_cast<float>(j)) * size;
+                vec3 corners[4] = {surfacePoint(face, origin), surfacePoint(face, origin + vec2(size, 0.0f)),
+                                   surfacePoint(face, origin + vec2(size, size)),
+                                   surfacePoint(face, origin + vec2(0.0f, size))};
+                vec3 center = surfacePoint(face, origin + vec2(0.5f * size));
+                float radius = 0.0f;
+                for (const vec3 &corner: corners) radius = std::max(radius, std::acos(std::min(dot(center, corner), 1.0f)));
+                if (dot(center, view) < -std::sin(radius)) continue;   // entirely on the far side
+                vec2 onScreen = vec2(rotation * center) * scale;
+                float reach = 1.0f + scale * 2.0f * std::sin(0.5f * radius);
+                if (std::abs(onScreen.x) > reach || std::abs(onScreen.y) > reach) continue;
+
+                int bottom = edgeLevel(corners[0], corners[1], view, pixelsPerUnit);
+                int right = edgeLevel(corners[1], corners[2], view, pixelsPerUnit);
+                int top = edgeLevel(corners[3], corners[2], view, pixelsPerUnit);
+                int left = edgeLevel(corners[0], corners[3], view, pixelsPerUnit);
+                int level = std::max({bottom, right, top, left});
+                byLevel[level].push_back({vec4(static_cast<float>(face), origin.x, origin.y, size),
+                                          vec4(static_cast<float>(1 << bottom), static_cast<float>(1 << right),
+                                               static_cast<float>(1 << top), static_cast<float>(1 << left))});
+            }
+        }
+    }
+
+    instances.clear();
+    for (int level = 0; level <= MaxLevel; ++level) {
+        levelCounts[level] = static_cast<int>(byLevel[level].size());
+        instances.insert(instances.end(), byLevel[level].begin(), byLevel[level].end());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    if (!instances.empty())
+        glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(instances.size() * sizeof(PatchInstance)),
+                        instances.data());
+    chosenFor = camera;
+    chosen = true;
+}
+
+
+/**
+ * Draws the visible part of the globe, choosing the patches again first if the
+ * view changed. One instanced draw call per level that has patches.
+ *
+ * @param prog   A `MAP_LIGHTING | GLOBE` program, already in use, with the map texture bound.
+ * @param camera The view to draw, in globe mode.
+ */
+void CubeSphere::Draw(GPUProgram *prog, const Camera &camera) {
+    if (!chosen || camera != chosenFor) choosePatches(camera);
+    camera.setUniforms(prog);
+    glBindVertexArray(vao);
+    GLuint first = 0;
+    for (int level = 0; level <= MaxLevel; ++level) {
+        if (levelCounts[level] > 0)
+            glDrawElementsInstancedBaseInstance(GL_TRIANGLES, indexCounts[level], GL_UNSIGNED_INT,
+                                                reinterpret_cast<void *>(indexOffsets[level]), levelCounts[level],
+                                                first);
+        first += static_cast<GLuint>(levelCounts[level]);
+    }
+    glBindVertexArray(0);
+}
+
+
+/**
+ * Destructor for the `CubeSphere` class. Releases the buffers and the vertex array.
+ */
+CubeSphere::~CubeSphere() {
+    glDeleteBuffers(1, &vertexVbo);
+    glDeleteBuffers(1, &ibo);
+    glDeleteBuffers(1, &instanceVbo);
+    glDeleteVertexArrays(1, &vao);
+}
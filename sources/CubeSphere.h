@@ -0,0 +1,77 @@
+#ifndef CUBESPHERE_H
+#define CUBESPHERE_H
+
+#include "framework.h"
+#include "Camera.h"
+#include <vector>
+
+
+/**
+ * @class CubeSphere
+ * @brief The surface of the globe as a cube projected onto the unit sphere, tessellated by screen-space error.
+ *
+ * Each face of the cube is split into `PatchesPerSide` x `PatchesPerSide`
+ * patches, and the cube coordinates are warped with a tangent so that the grid
+ * cells cover roughly equal angles. Every patch is drawn from the same grid of
+ * `(1 << MaxLevel) + 1` squared vertices, through one of `MaxLevel + 1` index
+ * buffers that each use every `1 << (MaxLevel - level)`-th grid line; the
+ * `MAP_LIGHTING | GLOBE` shader variant turns grid points into unit vectors.
+ *
+ * Whenever the view changes, the patches are chosen again on the CPU: patches
+ * on the far side of the globe or off the screen are dropped, and each edge of
+ * a remaining patch gets the fewest segments for which the chords between
+ * its segment points stay within `MaxErrorPixels` of the sphere on the screen.
+ * The edge is measured from its two endpoints, so the two patches sharing it
+ * agree on its segments; a patch is drawn at the level of its finest edge, and
+ * the vertex shader moves the points of an edge with fewer segments onto the
+ * chords of that edge, so neighboring levels meet without cracks. The patches
+ * are sorted by level into one instance buffer, and each level is one instanced
+ * draw call.
+ *
+ * The map texture is sampled by the latitude and longitude of every fragment, so
+ * the mesh has no texture coordinates and no seam at the antimeridian.
+ */
+class CubeSphere final {
+public:
+    static constexpr int PatchesPerSide = 4;
+    static constexpr int MaxLevel = 5;
+    static constexpr float MaxErrorPixels = 0.5f;
+
+private:
+    struct PatchInstance {
+        vec4 patch;          // face, lower left corner (u, v) on the face, size
+        vec4 edgeSegments;   // segments of the bottom, right, top and left edge
+    };
+
+    unsigned int vao = 0;
+    unsigned int vertexVbo = 0;
+    unsigned int ibo = 0;
+    unsigned int instanceVbo = 0;
+    GLsizei indexCounts[MaxLevel + 1] = {};
+    size_t indexOffsets[MaxLevel + 1] = {};
+    std::vector<PatchInstance> instances;
+    int levelCounts[MaxLevel + 1] = {};
+    int viewportHeight;
+    Camera chosenFor;
+    bool chosen = false;
+
+    int edgeLevel(const vec3 &start, const vec3 &end, const vec3 &view, float pixelsPerUnit) const;
+
+    void choosePatches(const Camera &camera);
+
+public:
+    explicit CubeSphere(int viewportHeight);
+
+    static vec3 surfacePoint(int face, const vec2 &uv);
+
+    void setViewportHeight(int height);
+
+    size_t PatchCount() const { return instances.size(); }
+
+    void Draw(GPUProgram *prog, const Camera &camera);
+
+    ~CubeSphere();
+};
+
+
+#endif //CUBESPHERE_H
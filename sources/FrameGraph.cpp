@@ -0,0 +1,427 @@
+#include "FrameGraph.h"
+#include <iostream>
+
+
+/**
+ * Creates an offscreen render target consisting of a framebuffer object with a
+ * single RGBA8 color texture attachment of the given size.
+ *
+ * @param width  Width of the color attachment in pixels.
+ * @param height Height of the color attachment in pixels.
+ */
+RenderTarget::RenderTarget(int width, int height) : width(width), height(height) {
+    glGenTextures(1, &colorTexture);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "Render target " << width << "x" << height << " is incomplete" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+
+/**
+ * Binds the render target as the current draw framebuffer and sets the viewport
+ * to cover the whole color attachment.
+ */
+void RenderTarget::Bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+}
+
+
+/**
+ * Binds the color attachment of the render target to the given texture unit so
+ * that a later pass can sample it.
+ *
+ * @param textureUnit Index of the texture unit to bind to.
+ */
+void RenderTarget::BindTexture(int textureUnit) const {
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+}
+
+
+/**
+ * Copies the color attachment into an area of another framebuffer, stretching
+ * it to the area's size with linear filtering.
+ *
+ * @param dstFbo    Destination framebuffer object, 0 for the default framebuffer.
+ * @param dstX      Left edge of the destination area in pixels.
+ * @param dstY      Bottom edge of the destination area in pixels.
+ * @param dstWidth  Width of the destination area in pixels.
+ * @param dstHeight Height of the destination area in pixels.
+ */
+void RenderTarget::BlitTo(unsigned int dstFbo, int dstX, int dstY, int dstWidth, int dstHeight) const {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, dstFbo);
+    glBlitFramebuffer(0, 0, width, height, dstX, dstY, dstX + dstWidth, dstY + dstHeight, GL_COLOR_BUFFER_BIT,
+                      (dstWidth == width && dstHeight == height) ? GL_NEAREST : GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, dstFbo);
+}
+
+
+/**
+ * Destructor for the `RenderTarget` class. Releases the framebuffer object and
+ * its color texture.
+ */
+RenderTarget::~RenderTarget() {
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &colorTexture);
+}
+
+
+/**
+ * Hands out a free render target of the requested size, creating a new one only
+ * when no released target of that size is available.
+ *
+ * @param width  Requested width in pixels.
+ * @param height Requested height in pixels.
+ *
+ * @return A render target that stays reserved until it is released.
+ */
+RenderTarget *RenderTargetPool::acquire(int width, int height) {
+    for (auto &entry: entries) {
+        if (!entry.inUse && entry.target->Width() == width && entry.target->Height() == height) {
+            entry.inUse = true;
+            entry.lastUsedFrame = frame;
+            return entry.target;
+        }
+    }
+    entries.push_back({new RenderTarget(width, height), true, frame});
+    return entries.back().target;
+}
+
+
+/**
+ * Returns a render target to the pool so that later passes can reuse it.
+ *
+ * @param target A target previously obtained from `acquire`.
+ */
+void RenderTargetPool::release(RenderTarget *target) {
+    for (auto &entry: entries) {
+        if (entry.target == target) {
+            entry.inUse = false;
+            entry.lastUsedFrame = frame;
+            return;
+        }
+    }
+}
+
+
+/**
+ * Closes the current frame and destroys targets that have not been used for
+ * more than `maxIdleFrames` frames, so a size change does not leak the old ones.
+ *
+ * @param maxIdleFrames Number of frames an unused target is kept around.
+ */
+void RenderTargetPool::endFrame(int maxIdleFrames) {
+    for (size_t i = 0; i < entries.size();) {
+        if (!entries[i].inUse && frame - entries[i].lastUsedFrame > maxIdleFrames) {
+            delete entries[i].target;
+            entries[i] = entries.back();
+            entries.pop_back();
+        } else {
+            ++i;
+        }
+    }
+    ++frame;
+}
+
+
+/**
+ * Destructor for the `RenderTargetPool` class. Destroys every pooled target.
+ */
+RenderTargetPool::~RenderTargetPool() {
+    for (auto &entry: entries) delete entry.target;
+}
+
+
+/**
+ * Constructs an empty frame graph that presents into a backbuffer of the given size.
+ *
+ * @param backbufferWidth  Width of the default framebuffer in pixels.
+ * @param backbufferHeight Height of the default framebuffer in pixels.
+ */
+FrameGraph::FrameGraph(int backbufferWidth, int backbufferHeight)
+    : backbufferWidth(backbufferWidth), backbufferHeight(backbufferHeight) {
+    resources.push_back({"backbuffer", ResourceKind::Backbuffer, backbufferWidth, backbufferHeight});
+    backbufferResource = 0;
+}
+
+
+/**
+ * Declares a CPU-side input of the frame. Passes reading the signal are
+ * re-executed after each call to `touch`.
+ *
+ * @param name Name of the signal, used in diagnostics.
+ *
+ * @return Handle of the new resource.
+ */
+FrameGraph::Resource FrameGraph::createSignal(const std::string &name) {
+    resources.push_back({name, ResourceKind::Signal});
+    compiled = false;
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+
+/**
+ * Declares a render target. Persistent targets are owned by the graph and keep
+ * their content between frames, which is what allows clean passes to be skipped.
+ * Transient targets are taken from the pool for the span of the frame in which
+ * they are needed and may alias the memory of other transient targets.
+ *
+ * @param name       Name of the target, used in diagnostics.
+ * @param width      Width of the target in pixels.
+ * @param height     Height of the target in pixels.
+ * @param persistent Whether the content must survive until the next frame.
+ *
+ * @return Handle of the new resource.
+ */
+FrameGraph::Resource FrameGraph::createTarget(const std::string &name, int width, int height, bool persistent) {
+    resources.push_back({name, persistent ? ResourceKind::Persistent : ResourceKind::Transient, width, height});
+    compiled = false;
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+
+/**
+ * Adds a pass to the graph. The order of `addPass` calls does not matter; the
+ * execution order is derived from the declared reads and writes.
+ *
+ * @param name    Name of the pass, used in diagnostics.
+ * @param reads   Signals and targets the pass depends on.
+ * @param writes  The target (or the backbuffer) the pass renders into.
+ * @param execute Callback that issues the draw calls of the pass. The output
+ *                is already bound when it is invoked.
+ */
+void FrameGraph::addPass(const std::string &name, const std::vector<Resource> &reads, Resource writes,
+                         PassFunction execute) {
+    if (resources[writes].kind == ResourceKind::Signal || resources[writes].producer >= 0) {
+        std::cerr << "Pass " << name << " cannot write " << resources[writes].name << std::endl;
+        return;
+    }
+    resources[writes].producer = static_cast<int>(passes.size());
+    passes.push_back({name, reads, writes, std::move(execute), std::vector<unsigned long>(reads.size(), ~0ul)});
+    compiled = false;
+}
+
+
+/**
+ * Marks a signal as changed, so that every pass depending on it, directly or
+ * through the targets of other passes, runs in the next frame.
+ *
+ * @param signal Handle returned by `createSignal`.
+ */
+void FrameGraph::touch(Resource signal) {
+    resources[signal].version++;
+}
+
+
+/**
+ * Changes the size of a render target. Persistent targets lose their content,
+ * so their producer runs again in the next frame.
+ *
+ * @param target Handle of the target to resize.
+ * @param width  New width in pixels.
+ * @param height New height in pixels.
+ */
+void FrameGraph::resizeTarget(Resource target, int width, int height) {
+    ResourceNode &node = resources[target];
+    if (node.width == width && node.height == height) return;
+    node.width = width;
+    node.height = height;
+    if (node.kind == ResourceKind::Backbuffer) {
+        backbufferWidth = width;
+        backbufferHeight = height;
+    }
+    destroyTarget(node);
+}
+
+
+/**
+ * Returns the GPU object currently backing a target. Transient targets only
+ * have one while the passes between their producer and last consumer run.
+ *
+ * @param resource Handle of a target resource.
+ *
+ * @return The render target, or nullptr for signals and the backbuffer.
+ */
+RenderTarget *FrameGraph::target(Resource resource) const {
+    return resources[resource].target;
+}
+
+
+/**
+ * Copies the content of one target into another resource (a target or the
+ * backbuffer), scaling it when the sizes differ. Intended to be called from
+ * pass callbacks, e.g. to start an overlay pass from the layer below it.
+ *
+ * @param source      Target to copy from.
+ * @param destination Target or backbuffer to copy into.
+ */
+void FrameGraph::blit(Resource source, Resource destination) const {
+    const RenderTarget *src = resources[source].target;
+    if (src == nullptr) return;
+    const ResourceNode &dst = resources[destination];
+    if (dst.kind == ResourceKind::Backbuffer)
+        src->BlitTo(0, 0, 0, backbufferWidth, backbufferHeight);
+    else if (dst.target != nullptr)
+        src->BlitTo(dst.target->Fbo(), 0, 0, dst.target->Width(), dst.target->Height());
+}
+
+
+/**
+ * Copies the content of one target into an area of another resource, e.g. to
+ * place one of several views side by side in the backbuffer.
+ *
+ * @param source      Target to copy from.
+ * @param destination Target or backbuffer to copy into.
+ * @param area        Left and bottom edge, width and height of the area in pixels.
+ */
+void FrameGraph::blit(Resource source, Resource destination, const ivec4 &area) const {
+    const RenderTarget *src = resources[source].target;
+    if (src == nullptr) return;
+    const ResourceNode &dst = resources[destination];
+    if (dst.kind == ResourceKind::Backbuffer)
+        src->BlitTo(0, area.x, area.y, area.z, area.w);
+    else if (dst.target != nullptr)
+        src->BlitTo(dst.target->Fbo(), area.x, area.y, area.z, area.w);
+}
+
+
+/**
+ * Sorts the passes topologically (a pass runs after the producers of every
+ * target it reads) and reports dependency cycles.
+ */
+void FrameGraph::compile() {
+    std::vector<int> pending(passes.size(), 0);
+    std::vector<std::vector<int>> consumers(passes.size());
+    for (size_t i = 0; i < passes.size(); ++i) {
+        for (Resource r: passes[i].reads) {
+            int producer = resources[r].producer;
+            if (producer >= 0) {
+                pending[i]++;
+                consumers[producer].push_back(static_cast<int>(i));
+            }
+        }
+    }
+
+    order.clear();
+    for (size_t i = 0; i < passes.size(); ++i)
+        if (pending[i] == 0) order.push_back(static_cast<int>(i));
+    for (size_t head = 0; head < order.size(); ++head)
+        for (int consumer: consumers[order[head]])
+            if (--pending[consumer] == 0) order.push_back(consumer);
+
+    if (order.size() != passes.size())
+        std::cerr << "Frame graph has a dependency cycle, " << passes.size() - order.size()
+                  << " passes will not run" << std::endl;
+    compiled = true;
+}
+
+
+/**
+ * Releases the GPU storage of a persistent target and marks it as empty.
+ *
+ * @param node The resource whose target should be destroyed.
+ */
+void FrameGraph::destroyTarget(ResourceNode &node) {
+    if (node.kind == ResourceKind::Persistent) delete node.target;
+    node.target = nullptr;
+    node.valid = false;
+}
+
+
+/**
+ * Runs one frame of the graph.
+ *
+ * The method first propagates dirtiness forward along the execution order,
+ * then decides backwards which passes actually have to run (a transient
+ * producer is only needed if one of its running consumers samples it), and
+ * finally executes those passes, acquiring transient targets just before
+ * their producer and releasing them after their last running consumer.
+ */
+void FrameGraph::execute() {
+    if (!compiled) compile();
+
+    for (int p: order) {
+        PassNode &pass = passes[p];
+        const ResourceNode &output = resources[pass.writes];
+        pass.dirty = output.kind == ResourceKind::Persistent && !output.valid;
+        for (size_t i = 0; i < pass.reads.size() && !pass.dirty; ++i) {
+            const ResourceNode &input = resources[pass.reads[i]];
+            if (input.kind == ResourceKind::Signal)
+                pass.dirty = input.version != pass.seenVersions[i];
+            else if (input.producer >= 0)
+                pass.dirty = passes[input.producer].dirty;
+        }
+    }
+
+    std::vector<int> lastUse(resources.size(), -1);
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        PassNode &pass = passes[*it];
+        switch (resources[pass.writes].kind) {
+            case ResourceKind::Backbuffer: pass.run = true; break;
+            case ResourceKind::Persistent: pass.run = pass.dirty; break;
+            default: pass.run = lastUse[pass.writes] >= 0; break;
+        }
+        if (!pass.run) continue;
+        for (Resource r: pass.reads)
+            if (resources[r].kind == ResourceKind::Transient && lastUse[r] < 0) lastUse[r] = *it;
+    }
+
+    executedPasses = 0;
+    for (int p: order) {
+        PassNode &pass = passes[p];
+        if (!pass.run) continue;
+
+        ResourceNode &output = resources[pass.writes];
+        if (output.kind == ResourceKind::Transient) {
+            output.target = pool.acquire(output.width, output.height);
+        } else if (output.kind == ResourceKind::Persistent && output.target == nullptr) {
+            output.target = new RenderTarget(output.width, output.height);
+        }
+
+        if (output.target != nullptr) {
+            output.target->Bind();
+        } else {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, backbufferWidth, backbufferHeight);
+        }
+        pass.execute(*this);
+        executedPasses++;
+
+        output.valid = true;
+        output.version++;
+        for (size_t i = 0; i < pass.reads.size(); ++i) {
+            ResourceNode &input = resources[pass.reads[i]];
+            pass.seenVersions[i] = input.version;
+            if (input.kind == ResourceKind::Transient && lastUse[pass.reads[i]] == p) {
+                pool.release(input.target);
+                input.target = nullptr;
+            }
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, backbufferWidth, backbufferHeight);
+    pool.endFrame();
+}
+
+
+/**
+ * Destructor for the `FrameGraph` class. Destroys the persistent targets; the
+ * transient ones are released together with the pool.
+ */
+FrameGraph::~FrameGraph() {
+    for (auto &node: resources) destroyTarget(node);
+}
@@ -0,0 +1,163 @@
+#ifndef FRAMEGRAPH_H
+#define FRAMEGRAPH_H
+
+#include "framework.h"
+#include <functional>
+#include <string>
+
+
+/**
+ * @class RenderTarget
+ * @brief An offscreen color target: a framebuffer object with one RGBA8 texture.
+ *
+ * Render targets are owned either by the FrameGraph (persistent targets, which
+ * keep their content between frames) or by the RenderTargetPool (transient
+ * targets, which are only valid between the pass that writes them and the last
+ * pass that reads them).
+ */
+class RenderTarget final {
+    unsigned int fbo = 0;
+    unsigned int colorTexture = 0;
+    int width;
+    int height;
+
+public:
+    RenderTarget(int width, int height);
+
+    int Width() const { return width; }
+
+    int Height() const { return height; }
+
+    unsigned int Fbo() const { return fbo; }
+
+    void Bind() const;
+
+    void BindTexture(int textureUnit) const;
+
+    void BlitTo(unsigned int dstFbo, int dstX, int dstY, int dstWidth, int dstHeight) const;
+
+    ~RenderTarget();
+};
+
+
+/**
+ * @class RenderTargetPool
+ * @brief Recycles transient render targets of matching size.
+ *
+ * A target released by one pass can be handed to a later pass of the same
+ * frame, so transient targets whose lifetimes do not overlap alias the same
+ * GPU memory. Targets that stay unused for several frames are destroyed.
+ */
+class RenderTargetPool final {
+    struct Entry {
+        RenderTarget *target;
+        bool inUse;
+        int lastUsedFrame;
+    };
+
+    std::vector<Entry> entries;
+    int frame = 0;
+
+public:
+    RenderTarget *acquire(int width, int height);
+
+    void release(RenderTarget *target);
+
+    void endFrame(int maxIdleFrames = 3);
+
+    size_t size() const { return entries.size(); }
+
+    ~RenderTargetPool();
+};
+
+
+/**
+ * @class FrameGraph
+ * @brief Schedules render passes from their declared inputs and outputs.
+ *
+ * A frame is described by resources and passes. Resources are either signals
+ * (versioned CPU-side inputs such as the hour offset, bumped with `touch`),
+ * render targets (persistent or transient), or the backbuffer. Every pass reads
+ * a list of resources and writes exactly one target.
+ *
+ * On `execute` the passes run in dependency order. A pass is dirty when one of
+ * its signals was touched since it last ran, when the producer of one of the
+ * targets it reads is dirty, or when its persistent output holds no content yet.
+ * Clean passes writing persistent targets are skipped and their previous output
+ * is reused; transient producers only run when a running pass consumes them;
+ * passes writing the backbuffer always run, since its content is undefined
+ * after a buffer swap.
+ */
+class FrameGraph final {
+public:
+    using Resource = int;
+    using PassFunction = std::function<void(FrameGraph &)>;
+
+private:
+    enum class ResourceKind { Signal, Persistent, Transient, Backbuffer };
+
+    struct ResourceNode {
+        std::string name;
+        ResourceKind kind;
+        int width = 0;
+        int height = 0;
+        unsigned long version = 0;
+        bool valid = false;
+        int producer = -1;
+        RenderTarget *target = nullptr;
+    };
+
+    struct PassNode {
+        std::string name;
+        std::vector<Resource> reads;
+        Resource writes;
+        PassFunction execute;
+        std::vector<unsigned long> seenVersions;
+        bool dirty = false;
+        bool run = false;
+    };
+
+    std::vector<ResourceNode> resources;
+    std::vector<PassNode> passes;
+    std::vector<int> order;
+    bool compiled = false;
+    RenderTargetPool pool;
+    Resource backbufferResource;
+    int backbufferWidth;
+    int backbufferHeight;
+    int executedPasses = 0;
+
+    void compile();
+
+    void destroyTarget(ResourceNode &node);
+
+public:
+    FrameGraph(int backbufferWidth, int backbufferHeight);
+
+    Resource createSignal(const std::string &name);
+
+    Resource createTarget(const std::string &name, int width, int height, bool persistent);
+
+    Resource backbuffer() const { return backbufferResource; }
+
+    void addPass(const std::string &name, const std::vector<Resource> &reads, Resource writes, PassFunction execute);
+
+    void touch(Resource signal);
+
+    void resizeTarget(Resource target, int width, int height);
+
+    RenderTarget *target(Resource resource) const;
+
+    void blit(Resource source, Resource destination) const;
+
+    void blit(Resource source, Resource destination, const ivec4 &area) const;
+
+    void execute();
+
+    int ExecutedPasses() const { return executedPasses; }
+
+    ~FrameGraph();
+};
+
+
+#endif //FRAMEGRAPH_H
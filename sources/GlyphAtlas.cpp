@@ -0,0 +1,180 @@
+#include "GlyphAtlas.h"
+#include <iostream>
+
+
+/**
+ * The built-in label font: 5x7 bitmaps of the characters ' ' to 'Z'. Each glyph
+ * is given as seven rows from top to bottom, the most significant of the five
+ * low bits being the leftmost column.
+ */
+static const unsigned char font5x7[GlyphAtlas::LastChar - GlyphAtlas::FirstChar + 1][GlyphAtlas::GlyphRows] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+    {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}, // '!'
+    {0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00}, // '"'
+    {0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A}, // '#'
+    {0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04}, // '$'
+    {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // '%'
+    {0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D}, // '&'
+    {0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00}, // '''
+    {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, // '('
+    {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, // ')'
+    {0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00}, // '*'
+    {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00}, // '+'
+    {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}, // ','
+    {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}, // '-'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, // '.'
+    {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // '/'
+    {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // '0'
+    {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // '1'
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // '2'
+    {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // '3'
+    {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // '4'
+    {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // '5'
+    {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // '6'
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // '7'
+    {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // '8'
+    {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // '9'
+    {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, // ':'
+    {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08}, // ';'
+    {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}, // '<'
+    {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}, // '='
+    {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}, // '>'
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}, // '?'
+    {0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E}, // '@'
+    {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}, // 'A'
+    {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, // 'B'
+    {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // 'C'
+    {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, // 'D'
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, // 'E'
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, // 'F'
+    {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, // 'G'
+    {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // 'H'
+    {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 'I'
+    {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, // 'J'
+    {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // 'K'
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, // 'L'
+    {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // 'M'
+    {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // 'N'
+    {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // 'O'
+    {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, // 'P'
+    {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, // 'Q'
+    {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, // 'R'
+    {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // 'S'
+    {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // 'T'
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // 'U'
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, // 'V'
+    {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, // 'W'
+    {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, // 'X'
+    {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}, // 'Y'
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, // 'Z'
+};
+
+
+/**
+ * Constructs the atlas, loading it from the cache file when that holds an atlas
+ * of the expected size, and generating and caching it otherwise.
+ *
+ * @param cacheFile Path of the PNG file used as a cache between runs.
+ */
+GlyphAtlas::GlyphAtlas(const fs::path &cacheFile) {
+    if (load(cacheFile)) return;
+    generate();
+    save(cacheFile);
+}
+
+
+/**
+ * Maps a character to its atlas cell. Lowercase letters use the uppercase glyphs
+ * and characters outside the font are drawn as '?'.
+ *
+ * @param character The character to look up.
+ *
+ * @return Index of the cell, counted row by row from the top left of the atlas.
+ */
+int GlyphAtlas::cellOf(char character) {
+    if (character >= 'a' && character <= 'z') character = static_cast<char>(character - 'a' + 'A');
+    if (character < FirstChar || character > LastChar) character = '?';
+    return character - FirstChar;
+}
+
+
+/**
+ * Rasterizes every glyph at `UnitTexels` texels per font unit and converts the
+ * coverage mask into a signed distance field.
+ *
+ * For every texel the distance to the nearest texel of the opposite coverage is
+ * searched within `Spread` texels. The distance is measured between texel
+ * centers and reduced by half a texel, so that the 0.5 level falls on the edge
+ * between the inside and outside texels.
+ */
+void GlyphAtlas::generate() {
+    texels.assign(static_cast<size_t>(Width) * Height, 0);
+
+    std::vector<unsigned char> mask(CellWidth * CellHeight);
+    for (int glyph = 0; glyph <= LastChar - FirstChar; ++glyph) {
+        for (int y = 0; y < CellHeight; ++y) {
+            for (int x = 0; x < CellWidth; ++x) {
+                int unitX = (x - Padding) / UnitTexels;
+                int unitY = (y - Padding) / UnitTexels;
+                bool inside = x >= Padding && y >= Padding && unitX < GlyphColumns && unitY < GlyphRows &&
+                              (font5x7[glyph][unitY] >> (GlyphColumns - 1 - unitX)) & 1;
+                mask[y * CellWidth + x] = inside ? 1 : 0;
+            }
+        }
+
+        int cellX = (glyph % AtlasColumns) * CellWidth;
+        int cellY = (glyph / AtlasColumns) * CellHeight;
+        for (int y = 0; y < CellHeight; ++y) {
+            for (int x = 0; x < CellWidth; ++x) {
+                unsigned char inside = mask[y * CellWidth + x];
+                int nearest = (Spread + 1) * (Spread + 1);
+                for (int dy = -Spread; dy <= Spread; ++dy) {
+                    for (int dx = -Spread; dx <= Spread; ++dx) {
+                        int sx = x + dx, sy = y + dy;
+                        bool sampleInside = sx >= 0 && sy >= 0 && sx < CellWidth && sy < CellHeight &&
+                                            mask[sy * CellWidth + sx];
+                        if (sampleInside != static_cast<bool>(inside))
+                            nearest = min(nearest, dx * dx + dy * dy);
+                    }
+                }
+                float distance = sqrtf(static_cast<float>(nearest)) - 0.5f;
+                float signedDistance = inside ? distance : -distance;
+                float value = clamp(0.5f + 0.5f * signedDistance / Spread, 0.0f, 1.0f);
+                texels[(cellY + y) * Width + cellX + x] = static_cast<unsigned char>(value * 255.0f + 0.5f);
+            }
+        }
+    }
+}
+
+
+/**
+ * Loads the atlas from the cache file.
+ *
+ * @param cacheFile Path of the cached PNG.
+ *
+ * @return False if the file is missing or does not match the current layout.
+ */
+bool GlyphAtlas::load(const fs::path &cacheFile) {
+    unsigned char *pixels = nullptr;
+    unsigned int width, height;
+    if (lodepng_decode_file(&pixels, &width, &height, cacheFile.string().c_str(), LCT_GREY, 8) != 0)
+        return false;
+    bool matches = width == static_cast<unsigned int>(Width) && height == static_cast<unsigned int>(Height);
+    if (matches) texels.assign(pixels, pixels + static_cast<size_t>(Width) * Height);
+    free(pixels);
+    return matches;
+}
+
+
+/**
+ * Writes the atlas into the cache file as an 8-bit grayscale PNG. A failure is
+ * reported but not fatal; the atlas is simply generated again on the next start.
+ *
+ * @param cacheFile Path of the cached PNG.
+ */
+void GlyphAtlas::save(const fs::path &cacheFile) const {
+    std::error_code error;
+    fs::create_directories(cacheFile.parent_path(), error);
+    if (lodepng_encode_file(cacheFile.string().c_str(), texels.data(), Width, Height, LCT_GREY, 8) != 0)
+        std::cerr << "Cannot write glyph atlas cache " << cacheFile << std::endl;
+}
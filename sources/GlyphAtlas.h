@@ -0,0 +1,53 @@
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include "framework.h"
+
+
+/**
+ * @class GlyphAtlas
+ * @brief Signed-distance-field atlas of the built-in 5x7 label font.
+ *
+ * Every printable glyph from ' ' to 'Z' gets a cell of `CellWidth` x `CellHeight`
+ * texels in a single-channel image. A texel stores 0.5 on the glyph outline and
+ * moves towards 1 inside and 0 outside, reaching the extremes `Spread` texels away
+ * from the outline, so the text stays sharp at any scale after bilinear filtering.
+ *
+ * Generating the field is done once on the CPU; the result is cached as a PNG
+ * file and loaded from there on later starts.
+ */
+class GlyphAtlas final {
+public:
+    static constexpr int FirstChar = 32;
+    static constexpr int LastChar = 90;
+    static constexpr int GlyphColumns = 5;  // font units
+    static constexpr int GlyphRows = 7;     // font units
+    static constexpr int UnitTexels = 4;    // texels per font unit in the atlas
+    static constexpr int Padding = 6;       // texels around the glyph in its cell
+    static constexpr int Spread = 6;        // texels from the outline to 0 or 1
+    static constexpr int CellWidth = GlyphColumns * UnitTexels + 2 * Padding;
+    static constexpr int CellHeight = GlyphRows * UnitTexels + 2 * Padding;
+    static constexpr int AtlasColumns = 8;
+    static constexpr int AtlasRows = (LastChar - FirstChar + AtlasColumns) / AtlasColumns;
+    static constexpr int Width = AtlasColumns * CellWidth;
+    static constexpr int Height = AtlasRows * CellHeight;
+
+private:
+    std::vector<unsigned char> texels;
+
+    void generate();
+
+    bool load(const fs::path &cacheFile);
+
+    void save(const fs::path &cacheFile) const;
+
+public:
+    GlyphAtlas(const fs::path &cacheFile);
+
+    static int cellOf(char character);
+
+    const std::vector<unsigned char> &Texels() const { return texels; }
+};
+
+
+#endif //GLYPHATLAS_H
@@ -0,0 +1,111 @@
+#include "IconAtlas.h"
+#include <algorithm>
+#include <cmath>
+
+
+/**
+ * Signed distance of a point to a closed polygon: negative inside, positive
+ * outside. Inside is decided by counting the edges crossed by a ray to +x.
+ */
+static float polygonDistance(const std::vector<vec2> &corners, const vec2 &point) {
+    float nearest = 1e30f;
+    bool inside = false;
+    for (size_t i = 0, j = corners.size() - 1; i < corners.size(); j = i++) {
+        vec2 a = corners[j], b = corners[i];
+        vec2 edge = b - a, offset = point - a;
+        float t = std::clamp(dot(offset, edge) / dot(edge, edge), 0.0f, 1.0f);
+        nearest = std::min(nearest, length(offset - edge * t));
+        if ((a.y > point.y) != (b.y > point.y) && point.x < a.x + (point.y - a.y) / (b.y - a.y) * edge.x)
+            inside = !inside;
+    }
+    return inside ? -nearest : nearest;
+}
+
+
+/**
+ * Corners of a star or a regular polygon with its first corner at the top.
+ *
+ * @param count  Number of corners.
+ * @param outer  Radius of the even corners.
+ * @param inner  Radius of the odd corners; equal to `outer` for a regular polygon.
+ */
+static std::vector<vec2> radialCorners(int count, float outer, float inner) {
+    std::vector<vec2> corners;
+    for (int i = 0; i < count; ++i) {
+        float angle = static_cast<float>(M_PI) / 2.0f + 2.0f * static_cast<float>(M_PI) * i / count;
+        float radius = i % 2 == 0 ? outer : inner;
+        corners.emplace_back(radius * std::cos(angle), radius * std::sin(angle));
+    }
+    return corners;
+}
+
+
+/**
+ * Signed distance of a point to the outline of an icon, in icon units: the icon
+ * spans [-1, 1] in both directions, y pointing up.
+ *
+ * @param icon  A `MarkerIcon`.
+ * @param point The point.
+ */
+float IconAtlas::distance(int icon, const vec2 &point) {
+    switch (icon) {
+        case IconCircle: return length(point) - 1.0f;
+        case IconRing: return std::abs(length(point) - 0.7f) - 0.3f;
+        default: return polygonDistance(outline(icon), point);
+    }
+}
+
+
+/**
+ * Outline of an icon as a closed polygon in icon units, like `distance` uses:
+ * the icon spans [-1, 1] in both directions, y pointing up. Circles are
+ * sampled with `OutlineSegments` corners, and the ring is a single polygon
+ * running around its outer edge and back around its hole, joined at the top.
+ * Unknown icons are squares.
+ *
+ * @param icon A `MarkerIcon`.
+ */
+const std::vector<vec2> &IconAtlas::outline(int icon) {
+    static const std::vector<std::vector<vec2>> outlines = [] {
+        std::vector<vec2> ring = radialCorners(OutlineSegments, 1.0f, 1.0f);
+        std::vector<vec2> hole = radialCorners(OutlineSegments, 0.4f, 0.4f);
+        ring.push_back(ring.front());
+        ring.push_back(hole.front());
+        ring.insert(ring.end(), hole.rbegin(), hole.rend());
+        return std::vector<std::vector<vec2>>{
+                {vec2(-1.0f, -1.0f), vec2(1.0f, -1.0f), vec2(1.0f, 1.0f), vec2(-1.0f, 1.0f)},
+                radialCorners(OutlineSegments, 1.0f, 1.0f),
+                radialCorners(4, 1.0f, 1.0f),
+                {vec2(-1.0f, -0.8f), vec2(1.0f, -0.8f), vec2(0.0f, 0.95f)},
+                radialCorners(10, 1.0f, 0.45f),
+                {vec2(-0.3f, -1.0f), vec2(0.3f, -1.0f), vec2(0.3f, -0.3f), vec2(1.0f, -0.3f), vec2(1.0f, 0.3f),
+                 vec2(0.3f, 0.3f), vec2(0.3f, 1.0f), vec2(-0.3f, 1.0f), vec2(-0.3f, 0.3f), vec2(-1.0f, 0.3f),
+                 vec2(-1.0f, -0.3f), vec2(-0.3f, -0.3f)},
+                ring,
+                radialCorners(6, 1.0f, 1.0f)};
+    }();
+    return outlines[icon >= 0 && icon < IconCount ? icon : IconSquare];
+}
+
+
+/**
+ * Generates the atlas. A texel is covered by the part of its pixel-wide
+ * neighborhood inside the outline, approximated from the distance of its center.
+ */
+IconAtlas::IconAtlas() : texels(static_cast<size_t>(Width) * Height * 2, 0) {
+    const float texelsPerUnit = IconSize / 2.0f;
+    for (int icon = 0; icon < IconCount; ++icon) {
+        int cellX = icon % Columns * CellSize, cellY = icon / Columns * CellSize;
+        for (int y = 0; y < CellSize; ++y) {
+            for (int x = 0; x < CellSize; ++x) {
+                vec2 point((x + 0.5f - CellSize / 2.0f) / texelsPerUnit, (CellSize / 2.0f - y - 0.5f) / texelsPerUnit);
+                float texelDistance = distance(icon, point) * texelsPerUnit;
+                float fill = std::clamp(0.5f - texelDistance, 0.0f, 1.0f);
+                float halo = std::clamp(0.5f + HaloTexels - texelDistance, 0.0f, 1.0f);
+                size_t texel = (static_cast<size_t>(cellY + y) * Width + cellX + x) * 2;
+                texels[texel] = static_cast<unsigned char>(std::lround(fill * 255.0f));
+                texels[texel + 1] = static_cast<unsigned char>(std::lround(halo * 255.0f));
+            }
+        }
+    }
+}
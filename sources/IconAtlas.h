@@ -0,0 +1,68 @@
+#ifndef ICONATLAS_H
+#define ICONATLAS_H
+
+#include "framework.h"
+
+
+/**
+ * The icons of station markers, by their cell in the `IconAtlas`.
+ */
+enum MarkerIcon : int {
+    IconSquare = 0,
+    IconCircle = 1,
+    IconDiamond = 2,
+    IconTriangle = 3,
+    IconStar = 4,
+    IconCross = 5,
+    IconRing = 6,
+    IconHexagon = 7,
+};
+
+/**
+ * Style flags of a marker.
+ */
+constexpr unsigned int MarkerHalo = 1u << 0;   // dark outline, to stand out over a busy map
+
+
+/**
+ * @class IconAtlas
+ * @brief Two-channel atlas of the marker icons: their coverage and that of their halo.
+ *
+ * Every icon gets a cell of `CellSize` texels, in which the icon itself spans
+ * the middle `IconSize` texels; the padding holds the halo. The first channel
+ * is the coverage of the icon, the second the coverage of the icon grown by
+ * `HaloTexels`, both computed from the exact distance of the texel center to
+ * the outline, so edges are antialiased and mipmaps stay clean down to small
+ * marker sizes. Rows are stored from the top.
+ *
+ * The icons are simple polygons and circles, generated in well under a
+ * millisecond, so the atlas is not cached. Their outlines are also available
+ * as polygons, for the vector export.
+ */
+class IconAtlas final {
+public:
+    static constexpr int IconCount = 8;
+    static constexpr int CellSize = 32;
+    static constexpr int IconSize = 24;
+    static constexpr float HaloTexels = 2.5f;
+    static constexpr int Columns = 4;
+    static constexpr int Rows = (IconCount + Columns - 1) / Columns;
+    static constexpr int Width = Columns * CellSize;
+    static constexpr int Height = Rows * CellSize;
+    static constexpr int OutlineSegments = 32;   // corners of a circle in `outline`
+
+private:
+    std::vector<unsigned char> texels;
+
+    static float distance(int icon, const vec2 &point);
+
+public:
+    IconAtlas();
+
+    const std::vector<unsigned char> &Texels() const { return texels; }
+
+    static const std::vector<vec2> &outline(int icon);
+};
+
+
+#endif //ICONATLAS_H
@@ -0,0 +1,102 @@
+#include "IncrementalScheduler.h"
+#include <iostream>
+
+
+/**
+ * Queues a work item. Its first step runs at the next call of `run`.
+ *
+ * @param name     Name of the item, printed when it finishes or is cancelled.
+ * @param priority Items with higher priority get the budget first.
+ * @param step     Does a bounded part of the work; returns true when done.
+ * @return The id used to cancel the item.
+ */
+IncrementalScheduler::WorkId IncrementalScheduler::submit(const std::string &name, int priority, Step step) {
+    items.push_back({nextId, name, priority, std::move(step), false});
+    return nextId++;
+}
+
+
+/**
+ * Cancels a work item; its step is not called again. Unknown or finished ids
+ * are ignored, so a stale id can be cancelled safely.
+ *
+ * @param id The id returned by `submit`.
+ * @return True if a pending item was cancelled.
+ */
+bool IncrementalScheduler::cancel(WorkId id) {
+    for (auto &item: items) {
+        if (item.id == id && !item.cancelled) {
+            item.cancelled = true;
+            std::cout << "Cancelled " << item.name << std::endl;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * Cancels every pending work item.
+ */
+void IncrementalScheduler::cancelAll() {
+    for (auto &item: items) {
+        if (!item.cancelled) {
+            item.cancelled = true;
+            std::cout << "Cancelled " << item.name << std::endl;
+        }
+    }
+}
+
+
+/**
+ * Removes the cancelled items. Only called between steps, so that the item
+ * whose step is running is never destroyed under it.
+ */
+void IncrementalScheduler::purgeCancelled() {
+    items.remove_if([](const Item &item) { return item.cancelled; });
+}
+
+
+/**
+ * Runs steps of the pending items until the budget is used up or nothing is left.
+ *
+ * At least one step runs per call, so work progresses even when a frame has no
+ * budget to spare. Items submitted by a step are considered right away.
+ *
+ * @param budgetSeconds Time available in this frame, in seconds.
+ * @return True if any step ran, i.e. partial results may have changed.
+ */
+bool IncrementalScheduler::run(float budgetSeconds) {
+    Slice slice(Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<float>(budgetSeconds)));
+    bool ran = false;
+    for (;;) {
+        purgeCancelled();
+        if (items.empty()) break;
+
+        auto current = items.begin();
+        for (auto it = items.begin(); it != items.end(); ++it)
+            if (it->priority > current->priority) current = it;
+
+        ran = true;
+        if (current->step(slice) && !current->cancelled) {
+            std::cout << "Finished " << current->name << std::endl;
+            items.erase(current);
+        }
+        if (slice.expired()) break;
+    }
+    return ran;
+}
+
+
+/**
+ * Returns the number of items that are neither finished nor cancelled.
+ *
+ * @return Number of pending work items.
+ */
+size_t IncrementalScheduler::Pending() const {
+    size_t pending = 0;
+    for (const auto &item: items)
+        if (!item.cancelled) pending++;
+    return pending;
+}
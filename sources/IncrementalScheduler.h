@@ -0,0 +1,67 @@
+#ifndef INCREMENTALSCHEDULER_H
+#define INCREMENTALSCHEDULER_H
+
+#include <chrono>
+#include <functional>
+#include <list>
+#include <string>
+
+
+/**
+ * @class IncrementalScheduler
+ * @brief Runs resumable work items within a per-step time budget of the frame loop.
+ *
+ * A work item is a step function that does a bounded amount of work, publishes
+ * what it produced so far, and returns true once the item is finished. `run` is
+ * called once per iteration of the frame loop (from `onTimeElapsed`) and keeps
+ * calling the step of the highest priority item, ties in submission order, until
+ * the budget of the frame is used up. A step can consult the `Slice` it is given
+ * to split its own work at the deadline.
+ *
+ * Items can be cancelled at any time, also from inside a step; what they
+ * published before stays.
+ */
+class IncrementalScheduler final {
+public:
+    using Clock = std::chrono::steady_clock;
+    using WorkId = unsigned int;
+
+    class Slice {
+        Clock::time_point deadline;
+
+    public:
+        explicit Slice(Clock::time_point deadline) : deadline(deadline) { }
+
+        bool expired() const { return Clock::now() >= deadline; }
+    };
+
+    using Step = std::function<bool(const Slice &)>;
+
+private:
+    struct Item {
+        WorkId id;
+        std::string name;
+        int priority;
+        Step step;
+        bool cancelled;
+    };
+
+    std::list<Item> items;
+    WorkId nextId = 1;
+
+    void purgeCancelled();
+
+public:
+    WorkId submit(const std::string &name, int priority, Step step);
+
+    bool cancel(WorkId id);
+
+    void cancelAll();
+
+    bool run(float budgetSeconds);
+
+    size_t Pending() const;
+};
+
+
+#endif //INCREMENTALSCHEDULER_H
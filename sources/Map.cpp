@@ -1,6 +1,33 @@
 #include "Map.h"
 
 
+/**
+ * The 64x64 map image, run-length encoded for `decodeImage`.
+ */
+const std::vector<unsigned char> Map::EncodedImage = {
+    252, 252, 252, 252, 252, 252, 252, 252, 252, 0, 9, 80,
+    1, 148, 13, 72, 13, 140, 25, 60, 21, 132, 41, 12, 1, 28,
+    25, 128, 61, 0, 17, 4, 29, 124, 81, 8, 37, 116, 89, 0, 69,
+    16, 5, 48, 97, 0, 77, 0, 25, 8, 1, 8, 253, 253, 253, 253,
+    101, 10, 237, 14, 237, 14, 241, 10, 141, 2, 93, 14, 121, 2,
+    5, 6, 93, 14, 49, 6, 57, 26, 89, 18, 41, 10, 57, 26, 89, 18,
+    41, 14, 1, 2, 45, 26, 89, 26, 33, 18, 57, 14, 93, 26, 33, 18,
+    57, 10, 93, 18, 5, 2, 33, 18, 41, 2, 5, 2, 5, 6, 89, 22, 29, 2,
+    1, 22, 37, 2, 1, 6, 1, 2, 97, 22, 29, 38, 45, 2, 97, 10, 1, 2, 37,
+    42, 17, 2, 13, 2, 5, 2, 89, 10, 49, 46, 25, 10, 101, 2, 5, 6, 37,
+    50, 9, 30, 89, 10, 9, 2, 37, 50, 5, 38, 81, 26, 45, 22, 17, 54, 77,
+    30, 41, 22, 17, 58, 1, 2, 61, 38, 65, 2, 9, 58, 69, 46, 37, 6, 1, 10,
+    9, 62, 65, 38, 5, 2, 33, 102, 57, 54, 33, 102, 57, 30, 1, 14, 33, 2,
+    9, 86, 9, 2, 21, 6, 13, 26, 5, 6, 53, 94, 29, 26, 1, 22, 29, 0, 29, 98,
+    5, 14, 9, 46, 1, 2, 5, 6, 5, 2, 0, 13, 0, 13, 118, 1, 2, 1, 42, 1, 4, 5,
+    6, 5, 2, 4, 33, 78, 1, 6, 1, 6, 1, 10, 5, 34, 1, 20, 2, 9, 2, 12, 25, 14,
+    5, 30, 1, 54, 13, 6, 9, 2, 1, 32, 13, 8, 37, 2, 13, 2, 1, 70, 49, 28, 13,
+    16, 53, 2, 1, 46, 1, 2, 1, 2, 53, 28, 17, 16, 57, 14, 1, 18, 1, 14, 1, 2,
+    57, 24, 13, 20, 57, 0, 2, 1, 2, 17, 0, 17, 2, 61, 0, 5, 16, 1, 28, 25, 0,
+    41, 2, 117, 56, 25, 0, 33, 2, 1, 2, 117, 52, 201, 48, 77, 0, 121, 40, 1, 0,
+    205, 8, 1, 0, 1, 12, 213, 4, 13, 12, 253, 253, 253, 141
+};
+
 
 /**
  * Decodes a run-length encoded image and generates a vector of pixel colors.
@@ -18,7 +45,7 @@
  * @return A vector of vec3 objects representing the RGB color values of each
  *         pixel in the decoded 64x64 image.
  */
-std::vector<vec3> Map::decodeImage(const std::vector<unsigned char> &encodedData) const {
+std::vector<vec3> Map::decodeImage(const std::vector<unsigned char> &encodedData) {
     std::vector<vec3> pixels(4096);
     size_t pixelIndex = 0;
     vec3 colorPalette[4] = {
@@ -47,26 +74,16 @@ std::vector<vec3> Map::decodeImage(const std::vector<unsigned char> &encodedData
 
 
 /**
- * Constructs a Map object, initializes and sets up the texture,
- * vertex data, and OpenGL buffers for rendering.
- *
- * The constructor decodes the provided run-length encoded image data into
- * pixel colors, creates a texture with the decoded data, and configures
- * OpenGL settings for rendering. It also initializes vertex and texture
- * coordinate buffers and their respective vertex attributes.
+ * Constructs a Map object, sets up a placeholder texture, the vertex data, and
+ * the OpenGL buffers for rendering.
  *
- * @param encodedData A vector containing run-length encoded image data,
- *                    where each byte represents a run length and a
- *                    corresponding color index.
+ * The placeholder is a single ocean-colored texel, so the map can be drawn
+ * before its image has been decoded. The constructor also initializes vertex
+ * and texture coordinate buffers and their respective vertex attributes.
  */
-Map::Map(const std::vector<unsigned char> &encodedData) {
-    std::vector<vec3> pixels = decodeImage(encodedData);
-    texture = new Texture(64, 64, pixels);
-
-    texture->Bind(0);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, 0);
+Map::Map() {
+    std::vector<vec3> placeholder = {vec3(0.0f, 0.0f, 1.0f)};
+    texture = new Texture(1, 1, placeholder);
 
     std::vector<vec2> vertices = {
         vec2(-1.0f, -1.0f), vec2(1.0f, -1.0f), vec2(1.0f, 1.0f), vec2(-1.0f, 1.0f)
@@ -98,6 +115,23 @@ Map::Map(const std::vector<unsigned char> &encodedData) {
 }
 
 
+/**
+ * Replaces the map texture with a decoded 64x64 image. Must be called on the
+ * thread owning the OpenGL context.
+ *
+ * @param pixels The 4096 RGB colors returned by `decodeImage`.
+ */
+void Map::setImage(std::vector<vec3> &pixels) {
+    delete texture;
+    texture = new Texture(64, 64, pixels);
+
+    texture->Bind(0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+
 /**
  * Renders the map using the provided GPUProgram instance.
  *
@@ -105,21 +139,39 @@ Map::Map(const std::vector<unsigned char> &encodedData) {
  * and draws the map geometry as a triangle fan on the GPU. The map will only
  * be rendered if its vertex data is populated.
  *
- * @param prog A pointer to the GPUProgram currently in use for rendering,
- *             which supplies the required shaders and allows uniform settings.
+ * The quad is drawn once for every copy of the map that the camera sees.
+ *
+ * @param prog   A pointer to the GPUProgram currently in use for rendering,
+ *               which supplies the required shaders and allows uniform settings.
+ * @param camera The view to draw.
  */
-void Map::DrawMap(GPUProgram *prog) const {
+void Map::DrawMap(GPUProgram *prog, const Camera &camera) const {
     if (vtx.size() > 0) {
-        prog->setUniform(true, "isTextured");
         texture->Bind(0);
         prog->setUniform(0, "tex");
+        int copies = camera.setUniforms(prog);
         glBindVertexArray(mapVao);
-        glDrawArrays(GL_TRIANGLE_FAN, 0, static_cast<int>(vtx.size()));
+        glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, static_cast<int>(vtx.size()), copies);
         glBindVertexArray(0);
     }
 }
 
 
+/**
+ * Renders the map texture on the globe. The texture is sampled by latitude and
+ * longitude in the fragment shader, so any mesh of the sphere can carry it.
+ *
+ * @param prog   A `MAP_LIGHTING | GLOBE` program, already in use.
+ * @param camera The view to draw, in globe mode.
+ * @param sphere The mesh of the globe.
+ */
+void Map::DrawGlobe(GPUProgram *prog, const Camera &camera, CubeSphere &sphere) const {
+    texture->Bind(0);
+    prog->setUniform(0, "tex");
+    sphere.Draw(prog, camera);
+}
+
+
 /**
  * Destructor for the `Map` class.
  *
@@ -2,8 +2,9 @@
 #define MAP_H
 
 #include "framework.h"
-#include "Station.h"
 #include "Path.h"
+#include "Camera.h"
+#include "CubeSphere.h"
 #include <iostream>
 
 
@@ -19,6 +20,11 @@
  * The class manages OpenGL resources such as vertex array objects (VAOs),
  * vertex buffer objects (VBOs), and textures, ensuring proper initialization
  * and cleanup.
+ *
+ * Decoding the image is independent of OpenGL, so it can run on a worker thread;
+ * until `setImage` uploads the result, the map shows a single-color placeholder.
+ *
+ * The same texture covers the globe, drawn by `DrawGlobe` on a `CubeSphere`.
  */
 class Map final : public Geometry<vec2> {
     Texture *texture;
@@ -26,13 +32,18 @@ class Map final : public Geometry<vec2> {
     unsigned int vboTex;
     unsigned int mapVao;
 
-private:
-    std::vector<vec3> decodeImage(const std::vector<unsigned char> &encodedData) const;
-
 public:
-    Map(const std::vector<unsigned char> &encodedData);
+    static const std::vector<unsigned char> EncodedImage;
+
+    Map();
+
+    static std::vector<vec3> decodeImage(const std::vector<unsigned char> &encodedData);
+
+    void setImage(std::vector<vec3> &pixels);
+
+    void DrawMap(GPUProgram *prog, const Camera &camera) const;
 
-    void DrawMap(GPUProgram *prog) const;
+    void DrawGlobe(GPUProgram *prog, const Camera &camera, CubeSphere &sphere) const;
 
     ~Map() override;
 };
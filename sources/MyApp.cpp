@@ -1,178 +1,374 @@
 #include <iostream>
 
 #include "Map.h"
+#include "Camera.h"
+#include "CubeSphere.h"
+#include "FrameGraph.h"
+#include "ShaderLibrary.h"
+#include "ShaderWatcher.h"
+#include "TextRenderer.h"
+#include "AsyncLoader.h"
+#include "IncrementalScheduler.h"
+#include "SnapshotExchange.h"
+#include "SharedColumn.h"
+#include "PositionStream.h"
+#include "ControlServer.h"
+#include "VehicleLayer.h"
+#include "NetworkTimeline.h"
+#include "TrajectoryReplay.h"
+#include "CoastlineLayer.h"
+#include "RegionIndex.h"
+#include "ViewUniforms.h"
+#include "RenderScale.h"
+#include "VectorExporter.h"
+#include "StationPicker.h"
+#include "RangeRingLayer.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <random>
 #include <vector>
 
 
 /**
- * The GLSL vertex shader source code used to define the vertex processing stage
- * in the rendering pipeline. This shader primarily handles the transformation of
- * vertex positions into clip space and passes texture coordinates to the fragment
- * shader for further processing.
- *
- * The shader performs the following operations:
- * - Position Transformation: Converts the input vertex position from object space
- *   to clip space using a predefined layout (location 0) for vertex attributes.
- *   The position is represented as a 2D `vec2`, with z and w components set to 0.0
- *   and 1.0, respectively, for compatibility with 3D rendering pipelines.
- * - Texture Coordinate Passing: Accepts 2D texture coordinates as input (layout location 1)
- *   and passes them to the fragment shader via the `vTexCoord` varying. This enables
- *   texturing in subsequent stages of the rendering pipeline.
- *
- * Inputs:
- * - position: A 2D vector (vec2) representing the vertex's position in object space,
- *   associated with layout location 0.
- * - texCoord: A 2D vector (vec2) representing the texture coordinate of the vertex,
- *   associated with layout location 1.
- *
- * Outputs:
- * - vTexCoord: A 2D vector (vec2) passed to the fragment shader, containing the
- *   interpolated texture coordinates for each fragment.
+ * Location of the uber-shader sources. The build points it at the `shaders`
+ * directory of the source tree, so edits there are picked up by the hot reload
+ * without reinstalling anything.
  */
-const char *vertexShaderSource = R"(
-#version 330 core
-layout(location = 0) in vec2 position;
-layout(location = 1) in vec2 texCoord;
+#ifndef SHADER_DIR
+#define SHADER_DIR "shaders"
+#endif
 
-out vec2 vTexCoord;
 
-void main() {
-    gl_Position = vec4(position, 0.0, 1.0);
-    vTexCoord = texCoord;
-}
-)";
+/**
+ * Location of the data files, such as the land polygons.
+ */
+#ifndef DATA_DIR
+#define DATA_DIR "data"
+#endif
 
 
 /**
- * The GLSL fragment shader source code used to render a textured or colored fragment,
- * simulating lighting effects based on solar illumination on a geographical coordinate
- * system. If a texture is applied using `tex`, the shader uses texture coordinates
- * to approximate geographic coordinates and compute lighting for day and night cycles.
- * Without a texture, the fragment color is set to a uniform color.
- *
- * The shader supports the following functionalities:
- * - Texturing: If `isTextured` is true, the shader samples a color from the provided
- *   texture (`tex`) using the texture coordinates (`vTexCoord`).
- * - Lighting: Computes solar illumination by calculating an angle between the
- *   fragment's surface normal and the sun direction, determined by its geographic
- *   position and a configurable offset (`hourOffset`). Simulates day and night
- *   conditions by dimming fragments in shadow.
- * - Geographic calculations: The shader internally calculates conversions between
- *   geographic coordinates (latitude and longitude) and Cartesian coordinates for
- *   lighting computations based on assumptions of Earth's tilt and solar position.
- *
- * Constants:
- * - PI: The mathematical constant for π (3.14159265359), used for radian conversions.
- * - earthTiltDeg: Earth's axial tilt in degrees (23.0°), used to represent the sun's
- *   latitude at summer solstice.
- *
- * Inputs:
- * - vTexCoord: 2D texture coordinates input from the vertex shader.
- *
- * Outputs:
- * - fragColor: The resulting RGBA color of the fragment.
+ * Time per simulation step that `IncrementalScheduler` work may take on the main
+ * thread, in seconds. Leaves the rest of a 60 Hz step to event handling.
+ */
+const float IncrementalBudget = 0.008f;
+
+/**
+ * Number of stations created by one random network generation ('g' key).
+ */
+const int GeneratedStations = 2000;
+
+/**
+ * Number of vehicles and their average speed in km/s for one fleet ('v' key).
+ */
+const int FleetVehicles = 250000;
+const float FleetSpeed = 300.0f;
+
+/**
+ * Hours the timeline moves per ',' / '.' key press, and per '<' / '>' press.
+ */
+const float ScrubStep = 1.0f;
+const float ScrubJump = 24.0f;
+
+/**
+ * Generated stations appear within this many hours of the timeline time, and
+ * stay for a random time between the two durations.
+ */
+const float GeneratedAppearSpan = 48.0f;
+const float GeneratedMinLifetime = 24.0f;
+const float GeneratedMaxLifetime = 96.0f;
+
+/**
+ * Width and height of the window in pixels. The window is split into a square
+ * grid of views with up to `MaxViewColumns` columns ('w' key, `views` command).
+ */
+const int WindowSize = 600;
+const int MaxViewColumns = 3;
+
+/**
+ * Time a frame may take on the render thread, in seconds. The map layer is rendered
+ * at a lower resolution while frames that draw it take longer (see `RenderScale`).
+ */
+const float FrameBudget = 1.0f / 60.0f;
+
+/**
+ * Largest size of a station marker in pixels (`marker` command).
+ */
+const float MaxMarkerSize = 64.0f;
+
+/**
+ * Pixels around a station marker in which the cursor still hovers over it.
+ */
+const float HoverSlack = 3.0f;
+
+/**
+ * Growth of a selected or hovered station marker, as drawn by the `uber` shader.
+ */
+const float HighlightGrowth = 1.5f;
+
+/**
+ * Radius of the range ring added around the hovered station ('r' key), and the
+ * largest radius of a ring (`ring` command), in kilometers. A ring must stay
+ * below `RangeRing::MaxRadius`.
+ */
+const float DefaultRingRadius = 500.0f;
+const float MaxRingRadius = 9500.0f;
+
+
+/**
+ * A path of the network: the indices of the two stations it connects, its
+ * great-circle length in kilometers, and its appear and disappear time on the
+ * timeline in hours.
+ */
+struct PathLink {
+    int from;
+    int to;
+    float distance;
+    vec2 lifetime;
+};
+
+
+/**
+ * A station or path whose disappear time changed after it was published, and
+ * the version of the first snapshot that carries the change.
+ */
+struct NetworkChange {
+    bool path;
+    int index;
+    uint64_t version;
+};
+
+
+/**
+ * A station whose marker changed after it was published, and the version of the
+ * first snapshot that carries the change.
+ */
+struct StyleChange {
+    int station;
+    uint64_t version;
+};
+
+
+/**
+ * The new selected, hovered and dimmed flags of a station or path, and the
+ * version of the first snapshot that carries them.
+ */
+struct StateChange {
+    bool path;
+    int index;
+    unsigned char state;
+    uint64_t version;
+};
+
+
+/**
+ * Drops the changes at the front of a log that the render thread has applied,
+ * those first published in a snapshot no newer than the acknowledged one. The
+ * log then only holds the changes of the last few frames, however long the
+ * session runs.
  *
- * Uniforms:
- * - tex: Sampler used to fetch texels from the texture when `isTextured` is true.
- * - isTextured: Boolean indicating whether the shader operates in texturing mode.
- * - color: Uniform RGB color used when `isTextured` is false.
- * - hourOffset: Offset in hours, representing the sun's longitudinal location based on
- *   the given time zone (used for lighting calculations).
+ * @param log          A log of changes in the order they were made.
+ * @param acknowledged Version of the newest snapshot the render thread applied.
  */
-const char *fragmentShaderSource = R"(
-#version 330 core
-in vec2 vTexCoord;
-out vec4 fragColor;
-
-uniform sampler2D tex;
-uniform bool isTextured;
-uniform vec3 color;
-uniform float hourOffset;
-
-const float PI = 3.14159265359;
-const float earthTiltDeg = 23.0;
-
-vec3 geoToCartesian(float lat, float lon) {
-    float latRad = radians(lat);
-    float lonRad = radians(lon);
-    return vec3(
-        cos(latRad) * cos(lonRad),
-        cos(latRad) * sin(lonRad),
-        sin(latRad)
-    );
+template<typename Change>
+static void trimApplied(std::vector<Change> &log, uint64_t acknowledged) {
+    auto pending = std::find_if(log.begin(), log.end(),
+                                [acknowledged](const Change &change) { return change.version > acknowledged; });
+    log.erase(log.begin(), pending);
 }
 
-void main() {
-    if (isTextured) {
-        vec3 texColor = texture(tex, vTexCoord).rgb;
-
-        // Convert texture coordinates to geographic coordinates
-        float lon = vTexCoord.x * 360.0 - 180.0;
 
-        float latitudeMinRad = radians(-85.0);
-        float latitudeMaxRad = radians(85.0);
-        float yMin = log(tan(latitudeMinRad) + 1.0 / cos(latitudeMinRad));
-        float yMax = log(tan(latitudeMaxRad) + 1.0 / cos(latitudeMaxRad));
-        float y = yMin + vTexCoord.y * (yMax - yMin);
-        float lat = degrees(atan(sinh(y)));
+/**
+ * A frame capture requested on the control socket. It is taken from the first
+ * frame drawn from a snapshot at least as new as `sceneVersion`, so it shows
+ * every command executed before it.
+ */
+struct CaptureRequest {
+    uint64_t sceneVersion;
+    std::string file;
+    ControlServer::Ticket ticket;
+};
 
-        vec3 normal = geoToCartesian(lat, lon);
 
-        // Sun position at summer solstice: fixed latitude +23°
-        float sunLon = 180.0 - hourOffset * 15.0;
-        float sunLat = earthTiltDeg;
-        vec3 sunDir = geoToCartesian(sunLat, sunLon);
+/**
+ * A fleet of vehicles shuttling along the paths that existed when it was added.
+ * Only these parameters travel with the snapshots; the render thread expands
+ * them into the individual vehicles, and the seed makes that deterministic.
+ */
+struct FleetSpec {
+    int count;
+    float speed;       // average speed in km/s
+    float departure;   // time of the first departures in seconds
+    unsigned int seed;
+    int pathCount;     // vehicles use the paths [0, pathCount)
+};
 
-        // Calculate lighting (angle between surface normal and sun direction)
-        float light = dot(normal, sunDir);
 
-        if (light > 0)
-            fragColor = vec4(texColor, 1.0);          // Day
-        else
-            fragColor = vec4(texColor * 0.5, 1.0);     // Night (50% dim)
-    } else {
-        fragColor = vec4(color, 1.0);
-    }
+/**
+ * Returns one of the random numbers of a fleet's vehicle, uniform in [0, 1): the
+ * SplitMix64 hash of the fleet's seed, the vehicle and the draw. Each vehicle
+ * depends on its index only, so the vehicles of a fleet can be created in any
+ * order on any thread and still come out the same.
+ *
+ * @param seed    The fleet's seed.
+ * @param vehicle Index of the vehicle in the fleet.
+ * @param draw    Which of the vehicle's four numbers, 0 to 3.
+ */
+static float fleetRandom(unsigned int seed, size_t vehicle, int draw) {
+    uint64_t z = (static_cast<uint64_t>(seed) << 32) + 4 * static_cast<uint64_t>(vehicle) + draw;
+    z = (z + 0x9e3779b97f4a7c15ull) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z ^= z >> 31;
+    return static_cast<float>(z >> 40) / static_cast<float>(1u << 24);
 }
-)";
-
-
-const std::vector<unsigned char> encodedData = {
-    252, 252, 252, 252, 252, 252, 252, 252, 252, 0, 9, 80,
-    1, 148, 13, 72, 13, 140, 25, 60, 21, 132, 41, 12, 1, 28,
-    25, 128, 61, 0, 17, 4, 29, 124, 81, 8, 37, 116, 89, 0, 69,
-    16, 5, 48, 97, 0, 77, 0, 25, 8, 1, 8, 253, 253, 253, 253,
-    101, 10, 237, 14, 237, 14, 241, 10, 141, 2, 93, 14, 121, 2,
-    5, 6, 93, 14, 49, 6, 57, 26, 89, 18, 41, 10, 57, 26, 89, 18,
-    41, 14, 1, 2, 45, 26, 89, 26, 33, 18, 57, 14, 93, 26, 33, 18,
-    57, 10, 93, 18, 5, 2, 33, 18, 41, 2, 5, 2, 5, 6, 89, 22, 29, 2,
-    1, 22, 37, 2, 1, 6, 1, 2, 97, 22, 29, 38, 45, 2, 97, 10, 1, 2, 37,
-    42, 17, 2, 13, 2, 5, 2, 89, 10, 49, 46, 25, 10, 101, 2, 5, 6, 37,
-    50, 9, 30, 89, 10, 9, 2, 37, 50, 5, 38, 81, 26, 45, 22, 17, 54, 77,
-    30, 41, 22, 17, 58, 1, 2, 61, 38, 65, 2, 9, 58, 69, 46, 37, 6, 1, 10,
-    9, 62, 65, 38, 5, 2, 33, 102, 57, 54, 33, 102, 57, 30, 1, 14, 33, 2,
-    9, 86, 9, 2, 21, 6, 13, 26, 5, 6, 53, 94, 29, 26, 1, 22, 29, 0, 29, 98,
-    5, 14, 9, 46, 1, 2, 5, 6, 5, 2, 0, 13, 0, 13, 118, 1, 2, 1, 42, 1, 4, 5,
-    6, 5, 2, 4, 33, 78, 1, 6, 1, 6, 1, 10, 5, 34, 1, 20, 2, 9, 2, 12, 25, 14,
-    5, 30, 1, 54, 13, 6, 9, 2, 1, 32, 13, 8, 37, 2, 13, 2, 1, 70, 49, 28, 13,
-    16, 53, 2, 1, 46, 1, 2, 1, 2, 53, 28, 17, 16, 57, 14, 1, 18, 1, 14, 1, 2,
-    57, 24, 13, 20, 57, 0, 2, 1, 2, 17, 0, 17, 2, 61, 0, 5, 16, 1, 28, 25, 0,
-    41, 2, 117, 56, 25, 0, 33, 2, 1, 2, 117, 52, 201, 48, 77, 0, 121, 40, 1, 0,
-    205, 8, 1, 0, 1, 12, 213, 4, 13, 12, 253, 253, 253, 141
+
+
+/**
+ * One view of the window: its camera and the hour offset of its day-night
+ * shading. Views are numbered row by row from the top left of the window.
+ */
+struct ViewSpec {
+    Camera camera;
+    int hourOffset = 0;
 };
 
 
+/**
+ * A view as drawn by the render thread: what it shows, its uniform buffer, and
+ * the signals of its passes in the frame graph.
+ */
+struct RenderView {
+    ViewSpec spec;
+    ViewUniforms *uniforms = nullptr;
+    FrameGraph::Resource hourSignal = 0;
+    FrameGraph::Resource viewSignal = 0;
+    FrameGraph::Resource mapLayer = 0;
+};
+
+
+/**
+ * Returns the number of columns, and of rows, of a square grid of views.
+ */
+static int viewColumns(size_t viewCount) {
+    return static_cast<int>(std::lround(std::sqrt(static_cast<double>(viewCount))));
+}
+
+
+/**
+ * Immutable state of the scene handed from the main thread to the render thread.
+ * Its columns share their chunks with the scene model (see `SharedColumn`), so
+ * publishing copies only the chunks changed since the previous snapshot, and no
+ * column at all when just the views or the timeline time changed.
+ * The network only ever grows, so the render thread creates the GPU objects of
+ * the stations and paths past the ones it already has. Retirements are logged
+ * in `lifetimeChanges`, marker changes in `styleChanges` and the new selected,
+ * hovered and dimmed flags in `stateChanges`, so the render thread applies just
+ * the new entries too; the flags themselves are not part of the snapshot. Each
+ * entry records the first snapshot that carries it; once the render thread
+ * acknowledged that snapshot, the entry is dropped from the logs of the next
+ * ones (see `trimApplied`).
+ */
+struct SceneSnapshot {
+    uint64_t version = 0;
+    std::vector<ViewSpec> views;
+    float timelineTime = 0.0f;
+    SharedColumn<dvec2> stationGeoCoords;
+    SharedColumn<vec2> stationLifetimes;
+    SharedColumn<MarkerStyle> stationStyles;
+    SharedColumn<PathLink> pathLinks;
+    std::vector<NetworkChange> lifetimeChanges;
+    std::vector<StyleChange> styleChanges;
+    std::vector<StateChange> stateChanges;
+    SharedColumn<RangeRing> rings;
+    SharedColumn<FleetSpec> fleets;
+    std::string replayFile;   // recorded tracks to replay, empty for none
+    int replaySerial = 0;     // changes whenever a replay is started
+    float replaySpeed = 1.0f;
+};
+
 
 class MyApp : public glApp {
 
+    // Main thread: input handling, simulation and the scene model.
+    SharedColumn<dvec2> stationGeoCoords;
+    SharedColumn<vec2> stationLifetimes;
+    SharedColumn<MarkerStyle> stationStyles;
+    std::vector<int> stationRegions;      // region of each station, see `classifyStations`
+    SharedColumn<PathLink> pathLinks;
+    std::vector<NetworkChange> lifetimeChanges;
+    std::vector<StyleChange> styleChanges;
+    std::vector<unsigned char> stationStates;   // `ObjectSelected`, `ObjectHovered` and `ObjectDimmed` flags
+    std::vector<unsigned char> pathStates;
+    std::vector<StateChange> stateChanges;
+    SharedColumn<RangeRing> rings;
+    SharedColumn<FleetSpec> fleets;
+    StationPicker *picker;
+    int hoveredStation;                   // -1 if none
+    float largestMarker;                  // size of the largest station marker, bounds the hover search
+    std::vector<int> pickCandidates;      // reused between hover tests
+    RegionIndex *regions;
+    std::string replayFile;
+    int replaySerial;
+    float replaySpeed;
+    float timelineTime;
+    float simulationTime;
+    IncrementalScheduler *scheduler;
+    IncrementalScheduler::WorkId generation;
+    ControlServer *control;
+    uint64_t sceneVersion;
+    bool sceneChanged;
+    std::vector<ViewSpec> views;
+    int activeView;   // the view under the cursor, which keys apply to
+    bool dragging;
+    int dragView;
+    vec2 dragFrom;   // position of the previous drag step, in the NDC of the dragged view
+
+    SnapshotExchange<SceneSnapshot> sceneExchange;
+    std::atomic<uint64_t> acknowledgedVersion{0};   // newest snapshot the render thread applied
+
+    // Both threads: the worker pool, created before the render thread starts.
+    WorkerPool *workers;
+
+    // Frame captures, handed from the main thread to the render thread and back,
+    // and the replies of vector exports, handed back from the worker pool.
+    std::mutex captureMutex;
+    std::vector<CaptureRequest> captureRequests;
+    std::vector<std::pair<ControlServer::Ticket, ControlReply>> captureResults;
+
+    // Render thread: GPU resources mirroring the latest snapshot.
     Map *map;
-    std::vector<Path *> paths;
-    std::vector<Station *> stations;
-    GPUProgram *prog;
+    CubeSphere *globe;
+    CoastlineLayer *land;
+    NetworkTimeline *network;
+    RangeRingLayer *ringLayer;
+    std::vector<size_t> stationLabels;
+    std::vector<size_t> pathLabels;
+    float renderedTimeline;
+    ShaderLibrary *shaders;
+    ShaderWatcher *shaderWatcher;
+    TextRenderer *labels;
+    PositionStream *positionFeed;
+    VehicleLayer *vehicles;
+    size_t expandedFleets;
+    TrajectoryReplay *replay;
+    VehicleLayer *replayVehicles;
+    int replayedSerial;
+    AsyncLoader *loader;
+    float shownProgress;
+    uint64_t renderedVersion;
+    std::vector<RenderView> renderViews;
+    RenderScale *renderScale;
+    bool mapDrawn;                        // whether a map pass ran in the current frame
 
-    std::vector<vec2> stationGeoCoords;
-    std::vector<float> distances;
-    int hourOffset;
+    FrameGraph *frameGraph;
+    FrameGraph::Resource networkSignal;
+    FrameGraph::Resource timelineSignal;
+    FrameGraph::Resource assetSignal;
+    FrameGraph::Resource labelSignal;
+    FrameGraph::Resource feedSignal;
+    FrameGraph::Resource vehicleSignal;
 
 private:
     /**
@@ -181,14 +377,14 @@ private:
      * haversine formula to compute the shortest path between the `start` and `end`
      * points on the surface of the Earth.
      *
-     * @param start The starting geographical coordinate as a vec2 object, where
-     *              x represents longitude and y represents latitude, in degrees.
-     * @param end   The ending geographical coordinate as a vec2 object, where
-     *              x represents longitude and y represents latitude, in degrees.
+     * @param start The starting geographical coordinate, where x represents
+     *              latitude and y represents longitude, in degrees.
+     * @param end   The ending geographical coordinate, where x represents
+     *              latitude and y represents longitude, in degrees.
      * @return The great-circle distance between the start and end coordinates,
      *         measured in kilometers.
      */
-    float calculateDistance(const vec2 &start, const vec2 &end) const {
+    float calculateDistance(const dvec2 &start, const dvec2 &end) const {
         vec3 startCart = geoToCartesian(start);
         vec3 endCart = geoToCartesian(end);
 
@@ -205,95 +401,1350 @@ private:
     }
 
 
+    /**
+     * Adds a station at a geographic position to the scene model. Main thread only;
+     * the render thread picks the station up with the next published snapshot.
+     *
+     * @param geoPos   Position of the new station, in degrees.
+     * @param lifetime Appear and disappear time on the timeline, in hours.
+     * @return The index of the new station.
+     */
+    int addStation(const dvec2 &geoPos, const vec2 &lifetime) {
+        stationGeoCoords.push_back(geoPos);
+        stationLifetimes.push_back(lifetime);
+        stationStyles.push_back(MarkerStyle());
+        stationStates.push_back(0);
+        picker->add(geoToNormalizedMap(geoPos));
+        sceneChanged = true;
+        return static_cast<int>(stationGeoCoords.size() - 1);
+    }
+
+
+    /**
+     * Changes the marker of a station. The render thread uploads just that
+     * station's record. Main thread only.
+     *
+     * @param station Index of the station.
+     * @param style   The new icon, size, color and flags.
+     */
+    void setStationStyle(int station, const MarkerStyle &style) {
+        stationStyles.mutate(station) = style;
+        styleChanges.push_back({station, sceneVersion + 1});
+        largestMarker = fmaxf(largestMarker, style.size);
+        sceneChanged = true;
+    }
+
+
+    /**
+     * Changes the selected, hovered and dimmed flags of a station. Only the new
+     * flags travel to the render thread, which uploads just that station's byte
+     * of the state buffer. Main thread only.
+     *
+     * @param station Index of the station.
+     * @param state   The new flags.
+     */
+    void setStationState(int station, unsigned char state) {
+        if (stationStates[station] == state) return;
+        stationStates[station] = state;
+        stateChanges.push_back({false, station, state, sceneVersion + 1});
+        sceneChanged = true;
+    }
+
+
+    /**
+     * Changes the selected, hovered and dimmed flags of a path, like `setStationState`.
+     *
+     * @param path  Index of the path.
+     * @param state The new flags.
+     */
+    void setPathState(int path, unsigned char state) {
+        if (pathStates[path] == state) return;
+        pathStates[path] = state;
+        stateChanges.push_back({true, path, state, sceneVersion + 1});
+        sceneChanged = true;
+    }
+
+
+    /**
+     * Connects two stations of the scene model by a path and records its length.
+     * The path appears at the current timeline time, or when the later of its
+     * stations appears, and disappears with the earlier one. Main thread only.
+     *
+     * @param from Index of the first station.
+     * @param to   Index of the second station.
+     * @return The new path.
+     */
+    const PathLink &addPath(int from, int to) {
+        vec2 a = stationLifetimes[from], b = stationLifetimes[to];
+        float appear = fmaxf(timelineTime, fmaxf(a.x, b.x));
+        vec2 lifetime(appear, fmaxf(appear, fminf(a.y, b.y)));
+        pathLinks.push_back({from, to, calculateDistance(stationGeoCoords[from], stationGeoCoords[to]), lifetime});
+        pathStates.push_back(0);
+        sceneChanged = true;
+        return pathLinks.back();
+    }
+
+
+    /**
+     * Adds a range ring around a station to the scene model. Main thread only.
+     *
+     * @param station    Index of the station at the center.
+     * @param kilometers Radius of the ring.
+     * @return The index of the new ring.
+     */
+    int addRing(int station, float kilometers) {
+        rings.push_back(RangeRing::around(stationGeoCoords[station], kilometers));
+        sceneChanged = true;
+        return static_cast<int>(rings.size() - 1);
+    }
+
+
+    /**
+     * Adds a station and, if it is not the first one, connects it to the previous
+     * station, like a click on the map does.
+     *
+     * @param geoPos   Position of the new station, in degrees.
+     * @param lifetime Appear and disappear time of the station, in hours.
+     */
+    void extendNetwork(const dvec2 &geoPos, const vec2 &lifetime) {
+        int station = addStation(geoPos, lifetime);
+        if (station >= 1) addPath(station - 1, station);
+    }
+
+
+    /**
+     * Tags the stations added since the last call with the region they are in,
+     * split across the worker pool. Main thread only.
+     */
+    void classifyStations() {
+        regions->classify(stationGeoCoords, stationRegions.size(), stationRegions, *workers);
+    }
+
+
+    /**
+     * Returns the name of the region a station is in, or "open water".
+     */
+    std::string regionName(int station) const {
+        int region = stationRegions[station];
+        return region == RegionIndex::Outside ? "open water" : regions->Name(region);
+    }
+
+
+    /**
+     * Returns the lifetime of a station added now: it appears at the current
+     * timeline time and is never retired.
+     */
+    vec2 fromNow() const {
+        return vec2(timelineTime, TimelineNever);
+    }
+
+
+    /**
+     * Retires a station and the paths connected to it at a point of the timeline.
+     * Main thread only.
+     *
+     * @param station Index of the station.
+     * @param time    Disappear time in hours; moved up to the appear time if earlier.
+     */
+    void retireStation(int station, float time) {
+        vec2 &lifetime = stationLifetimes.mutate(station);
+        lifetime.y = fmaxf(time, lifetime.x);
+        lifetimeChanges.push_back({false, station, sceneVersion + 1});
+        for (size_t i = 0; i < pathLinks.size(); ++i) {
+            const PathLink &link = pathLinks[i];
+            if (link.from != station && link.to != station) continue;
+            float disappear = fmaxf(link.lifetime.x, fminf(link.lifetime.y, lifetime.y));
+            if (disappear == link.lifetime.y) continue;
+            pathLinks.mutate(i).lifetime.y = disappear;
+            lifetimeChanges.push_back({true, static_cast<int>(i), sceneVersion + 1});
+        }
+        sceneChanged = true;
+    }
+
+
+    /**
+     * Adds a fleet of vehicles to the scene model. They leave over the next ten
+     * seconds along random paths of the network. Main thread only.
+     *
+     * @param count Number of vehicles.
+     * @param speed Average speed in km/s; each vehicle deviates by up to 50%.
+     * @return False if there is no path to travel along.
+     */
+    bool addFleet(int count, float speed) {
+        if (pathLinks.empty() || count <= 0 || speed <= 0.0f) return false;
+        fleets.push_back({count, speed, simulationTime, std::random_device{}(), static_cast<int>(pathLinks.size())});
+        sceneChanged = true;
+        return true;
+    }
+
+
+    /**
+     * Changes the speed of the replay. Main thread only.
+     *
+     * @param speed Speed relative to real time, clamped to the supported range.
+     */
+    void changeReplaySpeed(float speed) {
+        replaySpeed = std::clamp(speed, TrajectoryReplay::MinSpeed, TrajectoryReplay::MaxSpeed);
+        sceneChanged = true;
+        std::cout << "Replay speed: " << replaySpeed << "x" << std::endl;
+    }
+
+
+    /**
+     * Splits the window into a square grid of views. Views that remain keep their
+     * camera and hour offset; new ones start as copies of the active view. Main
+     * thread only.
+     *
+     * @param count Number of views, a square number up to `MaxViewColumns` squared.
+     */
+    void setViewCount(int count) {
+        ViewSpec active = views[activeView];
+        views.resize(count, active);
+        activeView = std::min(activeView, count - 1);
+        dragging = false;
+        sceneChanged = true;
+    }
+
+
+    /**
+     * Finds the view under a position in the window.
+     *
+     * @param pX The x-coordinate in window pixels.
+     * @param pY The y-coordinate in window pixels.
+     * @return Index of the view.
+     */
+    int viewAt(int pX, int pY) const {
+        int columns = viewColumns(views.size());
+        int tile = WindowSize / columns;
+        return std::clamp(pY / tile, 0, columns - 1) * columns + std::clamp(pX / tile, 0, columns - 1);
+    }
+
+
+    /**
+     * Converts a position in window pixels into the normalized device coordinates
+     * of a view. Positions outside the view are outside [-1, 1].
+     *
+     * @param view Index of the view.
+     * @param pX   The x-coordinate in window pixels.
+     * @param pY   The y-coordinate in window pixels.
+     */
+    vec2 pixelToNdc(int view, int pX, int pY) const {
+        int columns = viewColumns(views.size());
+        int tile = WindowSize / columns;
+        vec2 inTile(static_cast<float>(pX - view % columns * tile), static_cast<float>(pY - view / columns * tile));
+        return vec2(2.0f * inTile.x / tile - 1.0f, 1.0f - 2.0f * inTile.y / tile);
+    }
+
+
+    /**
+     * Finds the station whose marker is under a position in the window: the
+     * nearest station visible at the timeline time whose marker, as drawn and
+     * grown by `HoverSlack` pixels, contains the position. Selected and hovered
+     * markers are drawn `HighlightGrowth` times larger, so the search reaches
+     * as far as the largest marker would when grown. Only the stations of the
+     * picker's cells around the position are tested.
+     *
+     * @param view Index of the view under the position.
+     * @param pX   The x-coordinate in window pixels.
+     * @param pY   The y-coordinate in window pixels.
+     * @return Index of the station, or -1 if there is none.
+     */
+    int stationAt(int view, int pX, int pY) {
+        const Camera &camera = views[view].camera;
+        vec2 ndc = pixelToNdc(view, pX, pY);
+        dvec2 geo;
+        if (!camera.ndcToGeographic(ndc, geo)) return -1;
+        dvec2 map = geoToNormalizedMap(geo);
+        float ndcPerPixel = 2.0f / static_cast<float>(WindowSize / viewColumns(views.size()));
+        float reach = (largestMarker * HighlightGrowth / 2.0f + HoverSlack) * ndcPerPixel;
+
+        // How far the reach extends on the map, which the globe stretches towards its rim
+        double radius = 0.0;
+        for (vec2 side: {vec2(reach, 0.0f), vec2(-reach, 0.0f), vec2(0.0f, reach), vec2(0.0f, -reach)}) {
+            dvec2 sideGeo;
+            if (!camera.ndcToGeographic(ndc + side, sideGeo)) continue;
+            dvec2 offset = geoToNormalizedMap(sideGeo) - map;
+            offset.x -= 2.0 * std::round(offset.x / 2.0);
+            radius = std::max({radius, std::abs(offset.x), std::abs(offset.y)});
+        }
+
+        picker->near(map, radius, pickCandidates);
+        int nearest = -1;
+        float nearestDistance = 0.0f;
+        for (int station: pickCandidates) {
+            vec2 lifetime = stationLifetimes[station];
+            vec2 stationNdc;
+            if (timelineTime < lifetime.x || timelineTime >= lifetime.y ||
+                !camera.mapToNdc(picker->Position(station), stationNdc))
+                continue;
+            float distance = length(stationNdc - ndc) / ndcPerPixel;
+            float size = stationStyles[station].size;
+            if (stationStates[station] & (ObjectSelected | ObjectHovered)) size *= HighlightGrowth;
+            if (distance > size / 2.0f + HoverSlack) continue;
+            if (nearest < 0 || distance < nearestDistance) {
+                nearest = station;
+                nearestDistance = distance;
+            }
+        }
+        return nearest;
+    }
+
+
+    /**
+     * Moves the hovered flag to another station, which changes the state of
+     * two stations at most. Main thread only.
+     *
+     * @param station Index of the station under the cursor, or -1 for none.
+     */
+    void hoverStation(int station) {
+        if (station == hoveredStation) return;
+        if (hoveredStation >= 0)
+            setStationState(hoveredStation, static_cast<unsigned char>(stationStates[hoveredStation] & ~ObjectHovered));
+        hoveredStation = station;
+        if (station >= 0) setStationState(station, static_cast<unsigned char>(stationStates[station] | ObjectHovered));
+    }
+
+
+    /**
+     * Applies one command received on the control socket to the scene model.
+     * Station indices start at 0, so station "S1" is index 0. Captures are
+     * answered by the render thread once a frame showing the current scene has
+     * been drawn and saved, exports once the worker pool has written the file.
+     *
+     * @param command The command.
+     * @param ticket  Identifies a deferred reply when it is completed.
+     * @return The reply to send back.
+     */
+    ControlReply executeCommand(const ControlCommand &command, ControlServer::Ticket ticket) {
+        auto isStation = [this](float index) {
+            return index >= 0.0f && index < static_cast<float>(stationGeoCoords.size()) &&
+                   index == floorf(index);
+        };
+        auto isStateFlags = [](float flags) {
+            return flags >= 0.0f && flags == floorf(flags) &&
+                   (static_cast<unsigned int>(flags) & ~static_cast<unsigned int>(ObjectSelected | ObjectDimmed)) == 0;
+        };
+        ControlReply reply;
+        switch (command.opcode) {
+            case ControlCommand::AddStation:
+                if (fabsf(command.arguments[0]) > 85.0f || fabsf(command.arguments[1]) > 180.0f)
+                    return ControlReply::error("position out of range");
+                reply.index = addStation(dvec2(command.arguments[0], command.arguments[1]), fromNow());
+                return reply;
+            case ControlCommand::Scrub:
+                timelineTime = command.arguments[0];
+                sceneChanged = true;
+                return reply;
+            case ControlCommand::RetireStation:
+                if (!isStation(command.arguments[0])) return ControlReply::error("no such station");
+                retireStation(static_cast<int>(command.arguments[0]), command.arguments[1]);
+                return reply;
+            case ControlCommand::AddPath:
+            case ControlCommand::QueryDistance: {
+                if (!isStation(command.arguments[0]) || !isStation(command.arguments[1]))
+                    return ControlReply::error("no such station");
+                int from = static_cast<int>(command.arguments[0]);
+                int to = static_cast<int>(command.arguments[1]);
+                reply.hasValue = true;
+                if (command.opcode == ControlCommand::QueryDistance) {
+                    reply.value = calculateDistance(stationGeoCoords[from], stationGeoCoords[to]);
+                } else {
+                    reply.value = addPath(from, to).distance;
+                    reply.index = static_cast<int>(pathLinks.size() - 1);
+                }
+                return reply;
+            }
+            case ControlCommand::SetHour: {
+                float view = command.arguments[1];
+                if (view < 0.0f || view > static_cast<float>(views.size()) || view != floorf(view))
+                    return ControlReply::error("no such view");
+                for (size_t i = 0; i < views.size(); ++i)
+                    if (view == 0.0f || static_cast<float>(i + 1) == view)
+                        views[i].hourOffset = static_cast<int>(command.arguments[0]);
+                sceneChanged = true;
+                return reply;
+            }
+            case ControlCommand::SetViews: {
+                int columns = viewColumns(static_cast<size_t>(std::max(command.arguments[0], 0.0f)));
+                if (columns < 1 || columns > MaxViewColumns || static_cast<float>(columns * columns) != command.arguments[0])
+                    return ControlReply::error("view count must be 1, 4 or 9");
+                setViewCount(columns * columns);
+                return reply;
+            }
+            case ControlCommand::AddFleet:
+                if (command.arguments[0] < 1.0f || command.arguments[0] > 16.0e6f)
+                    return ControlReply::error("vehicle count out of range");
+                if (!addFleet(static_cast<int>(command.arguments[0]), command.arguments[1]))
+                    return ControlReply::error("no paths or invalid speed");
+                reply.index = static_cast<int>(fleets.size() - 1);
+                return reply;
+            case ControlCommand::Replay: {
+                TrajectoryReader tracks(command.file);
+                if (!tracks.IsOpen() || tracks.ChunkCount() == 0) return ControlReply::error("cannot read " + command.file);
+                replayFile = command.file;
+                replaySerial++;
+                replaySpeed = std::clamp(command.arguments[0], TrajectoryReplay::MinSpeed, TrajectoryReplay::MaxSpeed);
+                sceneChanged = true;
+                reply.value = static_cast<float>(tracks.EndTime() - tracks.StartTime());
+                reply.hasValue = true;
+                return reply;
+            }
+            case ControlCommand::QueryRegion:
+                if (!isStation(command.arguments[0])) return ControlReply::error("no such station");
+                classifyStations();
+                reply.index = stationRegions[static_cast<int>(command.arguments[0])];
+                return reply;
+            case ControlCommand::ReplaySpeed:
+                if (replayFile.empty()) return ControlReply::error("no replay running");
+                changeReplaySpeed(command.arguments[0]);
+                return reply;
+            case ControlCommand::SetMarker: {
+                if (!isStation(command.arguments[0])) return ControlReply::error("no such station");
+                float icon = command.arguments[1], size = command.arguments[2];
+                if (icon < 0.0f || icon >= static_cast<float>(IconAtlas::IconCount) || icon != floorf(icon))
+                    return ControlReply::error("no such icon");
+                if (!(size >= 1.0f && size <= MaxMarkerSize)) return ControlReply::error("size out of range");
+                int station = static_cast<int>(command.arguments[0]);
+                MarkerStyle style = stationStyles[station];
+                style.icon = static_cast<int>(icon);
+                style.size = size;
+                setStationStyle(station, style);
+                return reply;
+            }
+            case ControlCommand::SetMarkerColor: {
+                if (!isStation(command.arguments[0])) return ControlReply::error("no such station");
+                float color = command.arguments[1], flags = command.arguments[2];
+                if (color < 0.0f || color > static_cast<float>(0xffffff) || color != floorf(color))
+                    return ControlReply::error("invalid color");
+                if (flags != 0.0f && flags != static_cast<float>(MarkerHalo)) return ControlReply::error("invalid flags");
+                int station = static_cast<int>(command.arguments[0]);
+                auto rgb = static_cast<unsigned int>(color);
+                MarkerStyle style = stationStyles[station];
+                style.color = vec3(static_cast<float>(rgb >> 16), static_cast<float>(rgb >> 8 & 0xff),
+                                   static_cast<float>(rgb & 0xff)) / 255.0f;
+                style.flags = static_cast<unsigned int>(flags);
+                setStationStyle(station, style);
+                return reply;
+            }
+            case ControlCommand::SetStationState:
+            case ControlCommand::SetPathState: {
+                bool path = command.opcode == ControlCommand::SetPathState;
+                float index = command.arguments[0];
+                if (path ? !(index >= 0.0f && index < static_cast<float>(pathLinks.size()) && index == floorf(index))
+                         : !isStation(index))
+                    return ControlReply::error(path ? "no such path" : "no such station");
+                if (!isStateFlags(command.arguments[1])) return ControlReply::error("invalid flags");
+                int object = static_cast<int>(index);
+                auto flags = static_cast<unsigned char>(command.arguments[1]);
+                if (path) {
+                    setPathState(object, static_cast<unsigned char>((pathStates[object] & ObjectHovered) | flags));
+                } else {
+                    setStationState(object, static_cast<unsigned char>((stationStates[object] & ObjectHovered) | flags));
+                }
+                return reply;
+            }
+            case ControlCommand::AddRing:
+                if (!isStation(command.arguments[0])) return ControlReply::error("no such station");
+                if (!(command.arguments[1] > 0.0f && command.arguments[1] <= MaxRingRadius))
+                    return ControlReply::error("radius out of range");
+                reply.index = addRing(static_cast<int>(command.arguments[0]), command.arguments[1]);
+                return reply;
+            case ControlCommand::QueryCoverage: {
+                if (fabsf(command.arguments[0]) > 90.0f || fabsf(command.arguments[1]) > 180.0f)
+                    return ControlReply::error("position out of range");
+                dvec3 point(geoToCartesian(dvec2(command.arguments[0], command.arguments[1])));
+                int covering = 0;
+                for (size_t i = 0; i < rings.size(); ++i) {
+                    if (!rings[i].contains(point)) continue;
+                    if (covering++ == 0) reply.index = static_cast<int>(i);
+                }
+                reply.value = static_cast<float>(covering);
+                reply.hasValue = true;
+                return reply;
+            }
+            case ControlCommand::Export: {
+                VectorExporter::Format format;
+                if (!VectorExporter::formatOf(command.file, format))
+                    return ControlReply::error("export needs an .svg or .pdf file");
+                float view = command.arguments[0];
+                if (view < 0.0f || view > static_cast<float>(views.size()) || view != floorf(view))
+                    return ControlReply::error("no such view");
+                exportView(views[view == 0.0f ? 0 : static_cast<int>(view) - 1], command.file, format, ticket);
+                reply.deferred = true;
+                return reply;
+            }
+            case ControlCommand::Capture: {
+                std::lock_guard<std::mutex> lock(captureMutex);
+                captureRequests.push_back({sceneVersion + 1, command.file, ticket});
+                sceneChanged = true;
+                reply.deferred = true;
+                return reply;
+            }
+            default:
+                return ControlReply::error("unsupported command");
+        }
+    }
+
+
+    /**
+     * Exports the stations and paths visible at the timeline time, the range
+     * rings and the night side of a view as a vector file. Stations are drawn
+     * with the icon, size and color of their marker; halos and the state flags
+     * are not exported. The export shares the columns of the scene model as
+     * they are now, which costs one pointer per chunk, and the worker pool
+     * streams the features from them into the file, so neither side copies the
+     * network. Changes made meanwhile copy the chunks they write to and do not
+     * reach the file. The reply is handed back to the main thread with the
+     * capture replies. Main thread only.
+     *
+     * @param view   The view to export; a globe view is exported as the flat map.
+     * @param file   The SVG or PDF file to write.
+     * @param format Its format.
+     * @param ticket Identifies the deferred reply.
+     */
+    void exportView(const ViewSpec &view, const std::string &file, VectorExporter::Format format,
+                    ControlServer::Ticket ticket) {
+        workers->submit([this, view, file, format, ticket, time = timelineTime, geoCoords = stationGeoCoords,
+                         lifetimes = stationLifetimes, styles = stationStyles, links = pathLinks,
+                         exportedRings = rings] {
+            auto visible = [time](const vec2 &lifetime) { return lifetime.x <= time && time < lifetime.y; };
+            VectorExporter exporter(file, format, view.camera);
+            exporter.beginFill(vec3(0.0f, 0.0f, 1.0f), 1.0f);
+            exporter.fillMapArea();
+            exporter.beginFill(vec3(0.0f, 0.0f, 0.0f), 0.5f);   // the map shader halves the night side
+            exporter.fillNightSide(view.hourOffset);
+            exporter.beginStroke(vec3(1.0f, 1.0f, 0.0f), 3.0f);
+            for (size_t i = 0; i < links.size(); ++i) {
+                const PathLink &link = links[i];
+                if (visible(link.lifetime)) exporter.drawGreatCircle(geoCoords[link.from], geoCoords[link.to]);
+            }
+            exporter.beginStroke(vec3(1.0f, 0.4f, 0.8f), 2.0f);
+            for (size_t i = 0; i < exportedRings.size(); ++i) exporter.drawRing(exportedRings[i]);
+            vec3 fillColor(-1.0f);   // a new fill layer starts whenever the marker color changes
+            for (size_t i = 0; i < geoCoords.size(); ++i) {
+                if (!visible(lifetimes[i])) continue;
+                const MarkerStyle &style = styles[i];
+                if (style.color != fillColor) {
+                    fillColor = style.color;
+                    exporter.beginFill(fillColor, 1.0f);
+                }
+                exporter.drawMarker(geoCoords[i], style.icon, style.size);
+            }
+            uint64_t size = exporter.close();
+
+            ControlReply reply = size == 0 ? ControlReply::error("cannot write " + file) : ControlReply();
+            reply.value = static_cast<float>(size) / 1024.0f;
+            reply.hasValue = size != 0;
+            std::lock_guard<std::mutex> lock(captureMutex);
+            captureResults.emplace_back(ticket, reply);
+        });
+    }
+
+
+    /**
+     * Reads the backbuffer and saves it as a PNG for every capture request that
+     * the frame just drawn satisfies. Encoding and writing run on the worker pool;
+     * the replies are handed back to the main thread. Render thread only.
+     */
+    void serveCaptures() {
+        std::vector<CaptureRequest> due;
+        {
+            std::lock_guard<std::mutex> lock(captureMutex);
+            for (auto it = captureRequests.begin(); it != captureRequests.end();) {
+                if (it->sceneVersion <= renderedVersion) {
+                    due.push_back(*it);
+                    it = captureRequests.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        if (due.empty()) return;
+
+        auto pixels = std::make_shared<std::vector<unsigned char>>(WindowSize * WindowSize * 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glReadBuffer(GL_BACK);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, WindowSize, WindowSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels->data());
+
+        for (const CaptureRequest &request: due) {
+            workers->submit([this, pixels, request] {
+                std::vector<unsigned char> image(pixels->size());
+                for (int y = 0; y < WindowSize; ++y)   // GL rows start at the bottom, PNG rows at the top
+                    std::copy_n(pixels->data() + (WindowSize - 1 - y) * WindowSize * 4, WindowSize * 4,
+                                image.data() + y * WindowSize * 4);
+                unsigned error = lodepng::encode(request.file, image, WindowSize, WindowSize);
+                ControlReply reply = error ? ControlReply::error(lodepng_error_text(error)) : ControlReply();
+                std::lock_guard<std::mutex> lock(captureMutex);
+                captureResults.emplace_back(request.ticket, reply);
+            });
+        }
+    }
+
+
+    /**
+     * Copies the scene model into the back snapshot and hands it to the render
+     * thread. The columns are shared rather than copied, and only those that
+     * changed since the back snapshot was last filled. The logs are first trimmed
+     * to the changes the render thread has not applied yet. Main thread only.
+     */
+    void publishScene() {
+        uint64_t acknowledged = acknowledgedVersion.load();
+        trimApplied(lifetimeChanges, acknowledged);
+        trimApplied(styleChanges, acknowledged);
+        trimApplied(stateChanges, acknowledged);
+        SceneSnapshot &snapshot = sceneExchange.Back();
+        snapshot.version = ++sceneVersion;
+        snapshot.views = views;
+        snapshot.timelineTime = timelineTime;
+        stationGeoCoords.copyTo(snapshot.stationGeoCoords);
+        stationLifetimes.copyTo(snapshot.stationLifetimes);
+        stationStyles.copyTo(snapshot.stationStyles);
+        pathLinks.copyTo(snapshot.pathLinks);
+        snapshot.lifetimeChanges = lifetimeChanges;
+        snapshot.styleChanges = styleChanges;
+        snapshot.stateChanges = stateChanges;
+        rings.copyTo(snapshot.rings);
+        fleets.copyTo(snapshot.fleets);
+        snapshot.replayFile = replayFile;
+        snapshot.replaySerial = replaySerial;
+        snapshot.replaySpeed = replaySpeed;
+        sceneExchange.publish();
+        sceneChanged = false;
+        refreshScreen();
+    }
+
+
+    /**
+     * Creates the vehicles of a fleet: each one picks a path, a speed and a
+     * departure time from `fleetRandom`. The vehicles are computed on the worker
+     * pool, and the render thread only takes its share. Render thread only.
+     *
+     * @param scene The snapshot holding the fleet's paths.
+     * @param fleet The fleet.
+     */
+    void expandFleet(const SceneSnapshot &scene, const FleetSpec &fleet) {
+        vehicles->addVehicles(static_cast<size_t>(fleet.count), *workers,
+                              [&scene, &fleet](size_t i, vec3 &start, vec3 &end, float &speed, float &departure) {
+            int path = std::min(static_cast<int>(fleetRandom(fleet.seed, i, 0) * static_cast<float>(fleet.pathCount)),
+                                fleet.pathCount - 1);
+            const PathLink &link = scene.pathLinks[path];
+            start = geoToCartesian(scene.stationGeoCoords[link.from]);
+            end = geoToCartesian(scene.stationGeoCoords[link.to]);
+            speed = fleet.speed * (0.5f + fleetRandom(fleet.seed, i, 1));
+            departure = fleet.departure + 10.0f * fleetRandom(fleet.seed, i, 2);
+        });
+    }
+
+
+    /**
+     * Brings the GPU resources up to date with the newest published snapshot, if
+     * there is one. Adds the stations and paths added since the previous snapshot
+     * to the network and labels them: stations with their number, paths with
+     * their length. Splits the window into a new grid of views if their number changed,
+     * and uploads the camera and hour offset of each view that changed them. Applies
+     * the retirements, marker styles and state flags logged since the previous
+     * snapshot, uploads the new range rings, expands the fleets added since then
+     * into vehicles, moves the network and its labels to the timeline time, and
+     * starts or adjusts the replay of recorded tracks. Finally acknowledges the
+     * snapshot, so the main thread drops the applied changes from its logs.
+     * Render thread only.
+     */
+    void syncScene() {
+        if (!sceneExchange.acquire()) return;
+        const SceneSnapshot &scene = sceneExchange.Front();
+        uint64_t applied = renderedVersion;   // changes first published up to here are applied
+
+        renderedVersion = scene.version;
+        if (scene.views.size() != renderViews.size()) layoutViews(scene.views.size());
+        int tile = WindowSize / viewColumns(renderViews.size());
+        for (size_t i = 0; i < renderViews.size(); ++i) {
+            RenderView &view = renderViews[i];
+            const ViewSpec &spec = scene.views[i];
+            if (spec.hourOffset == view.spec.hourOffset && spec.camera == view.spec.camera) continue;
+            if (spec.hourOffset != view.spec.hourOffset) frameGraph->touch(view.hourSignal);
+            if (spec.camera != view.spec.camera) {
+                labels->setView(static_cast<int>(i), spec.camera);
+                frameGraph->touch(view.viewSignal);
+            }
+            view.spec = spec;
+            view.uniforms->update(spec.camera, spec.hourOffset, tile, tile);
+        }
+        for (; expandedFleets < scene.fleets.size(); ++expandedFleets)
+            expandFleet(scene, scene.fleets[expandedFleets]);
+        if (scene.replaySerial != replayedSerial) {
+            replayedSerial = scene.replaySerial;
+            delete replay;
+            replay = new TrajectoryReplay(scene.replayFile, scene.replaySpeed);
+            replayVehicles->endPositions(0);
+            frameGraph->touch(vehicleSignal);
+        } else if (replay != nullptr) {
+            replay->setSpeed(scene.replaySpeed);
+        }
+
+        bool networkChanged = stationLabels.size() != scene.stationGeoCoords.size() ||
+                              pathLabels.size() != scene.pathLinks.size() ||
+                              (!scene.lifetimeChanges.empty() && scene.lifetimeChanges.back().version > applied) ||
+                              (!scene.styleChanges.empty() && scene.styleChanges.back().version > applied) ||
+                              (!scene.stateChanges.empty() && scene.stateChanges.back().version > applied) ||
+                              ringLayer->Count() != scene.rings.size();
+        for (size_t i = stationLabels.size(); i < scene.stationGeoCoords.size(); ++i) {
+            dvec2 geoPos = scene.stationGeoCoords[i];
+            network->addStation(geoPos, scene.stationLifetimes[i], scene.stationStyles[i]);
+            stationLabels.push_back(labels->addLabel(geoToNormalizedMap(geoPos), "S" + std::to_string(i + 1),
+                                                     vec3(1.0f, 1.0f, 1.0f), 2, vec2(0.0f, 8.0f),
+                                                     scene.stationLifetimes[i]));
+        }
+        for (size_t i = pathLabels.size(); i < scene.pathLinks.size(); ++i) {
+            const PathLink &link = scene.pathLinks[i];
+            dvec2 start = scene.stationGeoCoords[link.from];
+            dvec2 end = scene.stationGeoCoords[link.to];
+            network->addPath(start, end, link.lifetime);
+            vec3 middle = sphericalLinearInterpolation(geoToCartesian(start), geoToCartesian(end), 0.5f);
+            pathLabels.push_back(labels->addLabel(dvec2(geoToNormalizedMap(cartesianToGeographic(middle))),
+                                                  std::to_string(static_cast<int>(link.distance)) + " km",
+                                                  vec3(1.0f, 1.0f, 0.0f), 1, vec2(0.0f, 4.0f), link.lifetime));
+        }
+        for (const NetworkChange &change: scene.lifetimeChanges) {
+            if (change.version <= applied) continue;
+            if (change.path) {
+                vec2 lifetime = scene.pathLinks[change.index].lifetime;
+                network->setPathDisappear(change.index, lifetime.y);
+                labels->setLifetime(pathLabels[change.index], lifetime);
+            } else {
+                vec2 lifetime = scene.stationLifetimes[change.index];
+                network->setStationDisappear(change.index, lifetime.y);
+                labels->setLifetime(stationLabels[change.index], lifetime);
+            }
+        }
+        for (const StyleChange &change: scene.styleChanges)
+            if (change.version > applied) network->setStationStyle(change.station, scene.stationStyles[change.station]);
+        for (const StateChange &change: scene.stateChanges) {
+            if (change.version <= applied) continue;
+            if (change.path)
+                network->setPathState(change.index, change.state);
+            else
+                network->setStationState(change.index, change.state);
+        }
+        for (size_t i = ringLayer->Count(); i < scene.rings.size(); ++i) ringLayer->addRing(scene.rings[i]);
+        if (networkChanged) {
+            network->commit();
+            ringLayer->commit();
+            frameGraph->touch(networkSignal);
+            frameGraph->touch(labelSignal);
+        }
+
+        if (scene.timelineTime != renderedTimeline) {
+            renderedTimeline = scene.timelineTime;
+            labels->setTime(renderedTimeline);
+            frameGraph->touch(timelineSignal);
+            std::cout << "Timeline at " << renderedTimeline << " h: " << network->VisibleStations(renderedTimeline)
+                      << " of " << network->StationCount() << " stations and " << network->VisiblePaths(renderedTimeline)
+                      << " of " << network->PathCount() << " paths visible" << std::endl;
+        }
+        acknowledgedVersion.store(scene.version);
+    }
+
+
+    /**
+     * Starts generating a network of random stations as an incremental work item,
+     * cancelling a generation still in progress. Every simulation step adds as many
+     * stations as fit into the budget, and they reach the render thread with the
+     * snapshot published at the end of the step. Each station appears on the
+     * timeline within `GeneratedAppearSpan` hours and stays for a random time.
+     *
+     * @param count Number of stations to add.
+     */
+    void generateNetwork(int count) {
+        scheduler->cancel(generation);
+        std::mt19937 random(std::random_device{}());
+        float origin = timelineTime;
+        generation = scheduler->submit("random network", 0,
+                                       [this, count, random, origin](const IncrementalScheduler::Slice &slice) mutable {
+                                           std::uniform_real_distribution<float> ndc(-0.95f, 0.95f);
+                                           std::uniform_real_distribution<float> appear(0.0f, GeneratedAppearSpan);
+                                           std::uniform_real_distribution<float> stay(GeneratedMinLifetime,
+                                                                                      GeneratedMaxLifetime);
+                                           do {
+                                               dvec2 geoPos = mapCoordinatesToGeographic(dvec2(ndc(random), ndc(random)));
+                                               float appearTime = origin + appear(random);
+                                               extendNetwork(geoPos, vec2(appearTime, appearTime + stay(random)));
+                                           } while (--count > 0 && !slice.expired());
+                                           return count == 0;
+                                       });
+    }
+
+
+    /**
+     * Binds the uniform buffer of a view for the draw calls that follow.
+     *
+     * @param index Index of the view.
+     * @return The camera of the view.
+     */
+    const Camera &useView(int index) const {
+        renderViews[index].uniforms->bind();
+        return renderViews[index].spec.camera;
+    }
+
+
+    /**
+     * Splits the window into a square grid of views on the render thread: sizes
+     * the label layouts, the globe mesh and the uniform buffers for the new tiles,
+     * and declares the passes of every view in a new frame graph. Views that
+     * remain keep what they show, but every view is drawn again.
+     *
+     * @param count Number of views.
+     */
+    void layoutViews(size_t count) {
+        for (size_t i = count; i < renderViews.size(); ++i) delete renderViews[i].uniforms;
+        renderViews.resize(count);
+        int tile = WindowSize / viewColumns(count);
+        labels->setViews(static_cast<int>(count), tile, tile);
+        globe->setViewportHeight(renderScale->scaled(tile));
+        for (size_t i = 0; i < count; ++i) {
+            RenderView &view = renderViews[i];
+            if (view.uniforms == nullptr) view.uniforms = new ViewUniforms();
+            view.uniforms->update(view.spec.camera, view.spec.hourOffset, tile, tile);
+            labels->setView(static_cast<int>(i), view.spec.camera);
+        }
+        delete frameGraph;
+        buildFrameGraph();
+    }
+
+
+    /**
+     * Resizes the map layer of every view to the current `RenderScale`, together
+     * with the tessellation of the globe, which is drawn into it. The map passes
+     * run again in the next frame.
+     */
+    void scaleMapLayers() {
+        int mapSize = renderScale->scaled(WindowSize / viewColumns(renderViews.size()));
+        for (const RenderView &view: renderViews) frameGraph->resizeTarget(view.mapLayer, mapSize, mapSize);
+        globe->setViewportHeight(mapSize);
+    }
+
+
+    /**
+     * Declares the render passes of a frame and the resources connecting them.
+     *
+     * Every view of the window has its own chain of passes and persistent
+     * targets of the size of its tile, so the targets of all views together
+     * cover the window once, however many views there are. The passes of a view
+     * bind its uniform buffer (see `useView`) and draw the shared layers through
+     * its camera; the geometry, textures and programs exist only once.
+     *
+     * The map layer of a view only depends on its hour offset and camera and the
+     * network layer only on the stations and paths, so each of them is re-rendered
+     * into its own persistent target just when its input signal was touched; a view
+     * whose camera and hour did not change is not redrawn. All layers also read
+     * `assetSignal`, which is touched whenever an asset finished loading or
+     * reloaded shaders were swapped in. Until the shaders are loaded, the map
+     * layer is a plain ocean-colored placeholder. Per view:
+     * - "map" reads the view's `hourSignal` and `viewSignal` and renders the lit map into
+     *   `mapLayer`, with the vector land polygons blended over the texture; in globe mode
+     *   the map texture covers the `CubeSphere` in front of a dark background. Every later
+     *   pass reads its output directly or indirectly, so moving the view redraws all of
+     *   its layers. Each pass picks the `GLOBE` variants of its programs while the view
+     *   shows the globe.
+     * - "network" reads `mapLayer`, `networkSignal` and `timelineSignal`, copies the
+     *   map into `sceneLayer` and draws the paths and stations visible at the
+     *   timeline time on top of it. `mapLayer` is smaller than the view while the
+     *   `RenderScale` lowers its resolution; the copy then upscales it, and the
+     *   paths, stations and every later layer are still drawn at full resolution.
+     * - "labels" reads `sceneLayer`, `labelSignal` and `timelineSignal`, copies the scene into
+     *   `labelLayer` and draws the station and distance labels over it.
+     * - "feed" reads `labelLayer` and `feedSignal`, copies the labelled scene into
+     *   `feedLayer` and draws the positions streamed from the shared memory feed.
+     * - "vehicles" reads `feedLayer` and `vehicleSignal`, copies the scene into
+     *   `vehicleLayer` and draws the vehicles and the replayed tracks at their
+     *   positions of this frame.
+     *
+     * Finally, "present" copies the `vehicleLayer` of every view into its tile of the
+     * backbuffer on every frame, and draws a progress bar at the bottom while assets
+     * are loading.
+     */
+    void buildFrameGraph() {
+        frameGraph = new FrameGraph(WindowSize, WindowSize);
+        networkSignal = frameGraph->createSignal("network");
+        timelineSignal = frameGraph->createSignal("timeline");
+        assetSignal = frameGraph->createSignal("assets");
+        labelSignal = frameGraph->createSignal("labels");
+        feedSignal = frameGraph->createSignal("positionFeed");
+        vehicleSignal = frameGraph->createSignal("vehicles");
+
+        int columns = viewColumns(renderViews.size());
+        int tile = WindowSize / columns;
+        std::vector<FrameGraph::Resource> viewLayers;
+        for (size_t i = 0; i < renderViews.size(); ++i)
+            viewLayers.push_back(addViewPasses(static_cast<int>(i), tile));
+
+        frameGraph->addPass("present", viewLayers, frameGraph->backbuffer(),
+                            [this, viewLayers, columns, tile](FrameGraph &graph) {
+                                for (size_t i = 0; i < viewLayers.size(); ++i) {
+                                    int column = static_cast<int>(i) % columns, row = static_cast<int>(i) / columns;
+                                    graph.blit(viewLayers[i], graph.backbuffer(),
+                                               ivec4(column * tile, WindowSize - (row + 1) * tile, tile, tile));
+                                }
+                                if (loader->Busy()) drawProgressBar(loader->Progress());
+                            });
+    }
+
+
+    /**
+     * Declares the passes and targets of one view, see `buildFrameGraph`.
+     *
+     * @param index Index of the view.
+     * @param tile  Width and height of the view in pixels.
+     * @return The last layer of the view, which holds the finished view.
+     */
+    FrameGraph::Resource addViewPasses(int index, int tile) {
+        RenderView &view = renderViews[index];
+        std::string suffix = " " + std::to_string(index + 1);
+        view.hourSignal = frameGraph->createSignal("hourOffset" + suffix);
+        view.viewSignal = frameGraph->createSignal("view" + suffix);
+        int mapSize = renderScale->scaled(tile);
+        FrameGraph::Resource mapLayer = frameGraph->createTarget("mapLayer" + suffix, mapSize, mapSize, true);
+        view.mapLayer = mapLayer;
+        FrameGraph::Resource sceneLayer = frameGraph->createTarget("sceneLayer" + suffix, tile, tile, true);
+        FrameGraph::Resource labelLayer = frameGraph->createTarget("labelLayer" + suffix, tile, tile, true);
+        FrameGraph::Resource feedLayer = frameGraph->createTarget("feedLayer" + suffix, tile, tile, true);
+        FrameGraph::Resource vehicleLayer = frameGraph->createTarget("vehicleLayer" + suffix, tile, tile, true);
+
+        frameGraph->addPass("map" + suffix, {view.hourSignal, view.viewSignal, assetSignal}, mapLayer,
+                            [this, index](FrameGraph &) {
+            if (shaders == nullptr) {
+                glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+                return;
+            }
+            mapDrawn = true;
+            const Camera &camera = useView(index);
+            unsigned int projection = camera.IsGlobe() ? SHADER_GLOBE : 0;
+            GPUProgram *mapProgram = shaders->variant(SHADER_MAP_LIGHTING | projection);
+            mapProgram->Use();
+            if (camera.IsGlobe()) {
+                glClearColor(0.02f, 0.02f, 0.06f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+                map->DrawGlobe(mapProgram, camera, *globe);
+            } else {
+                map->DrawMap(mapProgram, camera);
+            }
+            GPUProgram *landProgram = shaders->variant(SHADER_GEO_POSITION | SHADER_FLAT_COLOR | projection);
+            landProgram->Use();
+            land->DrawLand(landProgram, camera, vec3(0.3f, 0.6f, 0.25f), 0.5f);
+        });
+
+        frameGraph->addPass("network" + suffix, {mapLayer, networkSignal, timelineSignal, assetSignal}, sceneLayer,
+                            [this, index, mapLayer, sceneLayer](FrameGraph &graph) {
+                                graph.blit(mapLayer, sceneLayer);
+                                if (shaders == nullptr) return;
+                                const Camera &camera = useView(index);
+                                bool onGlobe = camera.IsGlobe();
+                                GPUProgram *pathProgram = shaders->variant(
+                                        SHADER_GREAT_CIRCLE | SHADER_TIMELINE | SHADER_FLAT_COLOR | SHADER_OBJECT_STATE |
+                                        (onGlobe ? SHADER_GLOBE : SHADER_SPLIT_POSITION));
+                                pathProgram->Use();
+                                network->DrawPaths(pathProgram, camera, vec3(1.0f, 1.0f, 0.0f), renderedTimeline);
+                                GPUProgram *ringProgram = shaders->variant(SHADER_RANGE_RING | SHADER_FLAT_COLOR |
+                                                                           (onGlobe ? SHADER_GLOBE : 0));
+                                ringProgram->Use();
+                                ringLayer->DrawRings(ringProgram, camera, vec3(1.0f, 0.4f, 0.8f));
+                                GPUProgram *stationProgram = shaders->variant(
+                                        SHADER_TIMELINE | SHADER_INSTANCED_MARKER | SHADER_OBJECT_STATE |
+                                        (onGlobe ? SHADER_SPHERE_POSITION | SHADER_GLOBE : SHADER_SPLIT_POSITION));
+                                stationProgram->Use();
+                                network->DrawStations(stationProgram, camera, renderedTimeline);
+                            });
+
+        frameGraph->addPass("labels" + suffix, {sceneLayer, labelSignal, timelineSignal, assetSignal}, labelLayer,
+                            [this, index, sceneLayer, labelLayer](FrameGraph &graph) {
+                                graph.blit(sceneLayer, labelLayer);
+                                if (shaders == nullptr) return;
+                                useView(index);
+                                GPUProgram *textProgram = shaders->variant(SHADER_SDF_TEXT);
+                                textProgram->Use();
+                                labels->DrawLabels(textProgram, index);
+                            });
+
+        frameGraph->addPass("feed" + suffix, {labelLayer, feedSignal, assetSignal}, feedLayer,
+                            [this, index, labelLayer, feedLayer](FrameGraph &graph) {
+                                graph.blit(labelLayer, feedLayer);
+                                if (shaders == nullptr) return;
+                                const Camera &camera = useView(index);
+                                GPUProgram *feedProgram = shaders->variant(
+                                        SHADER_GEO_POSITION | SHADER_FLAT_COLOR | (camera.IsGlobe() ? SHADER_GLOBE : 0));
+                                feedProgram->Use();
+                                positionFeed->DrawPositions(feedProgram, camera, vec3(0.0f, 1.0f, 1.0f));
+                            });
+
+        frameGraph->addPass("vehicles" + suffix, {feedLayer, vehicleSignal, assetSignal}, vehicleLayer,
+                            [this, index, feedLayer, vehicleLayer](FrameGraph &graph) {
+                                graph.blit(feedLayer, vehicleLayer);
+                                if (shaders == nullptr) return;
+                                const Camera &camera = useView(index);
+                                GPUProgram *vehicleProgram = shaders->variant(
+                                        SHADER_SPHERE_POSITION | SHADER_FLAT_COLOR | (camera.IsGlobe() ? SHADER_GLOBE : 0));
+                                vehicleProgram->Use();
+                                vehicles->DrawVehicles(vehicleProgram, camera, vec3(1.0f, 0.5f, 0.0f));
+                                replayVehicles->DrawVehicles(vehicleProgram, camera, vec3(0.4f, 1.0f, 0.4f));
+                            });
+        return vehicleLayer;
+    }
+
+
+    /**
+     * Draws a loading progress bar along the bottom of the current framebuffer.
+     * Uses scissored clears only, so it works before any shader is compiled.
+     *
+     * @param progress Fraction of the loading steps completed, in [0, 1].
+     */
+    void drawProgressBar(float progress) {
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(20, 20, 560, 12);
+        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glScissor(22, 22, static_cast<int>(556 * progress), 8);
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
+    }
+
+
+    /**
+     * Decodes the run-length encoded map on a worker thread and uploads the
+     * texture on the GL thread. The map shows its placeholder until then.
+     */
+    LoadTask loadMapImage() {
+        loader->expect(2);
+        co_await loader->onWorker();
+        std::vector<vec3> pixels = Map::decodeImage(Map::EncodedImage);
+        loader->completed("map image");
+
+        co_await loader->onGLThread();
+        map->setImage(pixels);
+        loader->completed("map texture");
+        frameGraph->touch(assetSignal);
+        refreshScreen();
+    }
+
+
+    /**
+     * Reads the uber-shader sources on a worker thread, then compiles the variants
+     * drawn every frame on the GL thread, one per frame loop iteration, so that no
+     * single frame absorbs the whole compilation. The globe variants are among them,
+     * so switching to the globe never waits for a compilation. Once all of them are
+     * ready the library is published and the hot reload watcher is started.
+     */
+    LoadTask loadShaders() {
+        static const unsigned int frameVariants[] = {SHADER_MAP_LIGHTING, SHADER_SDF_TEXT,
+                                                     SHADER_GREAT_CIRCLE | SHADER_SPLIT_POSITION | SHADER_TIMELINE |
+                                                     SHADER_FLAT_COLOR | SHADER_OBJECT_STATE,
+                                                     SHADER_SPLIT_POSITION | SHADER_TIMELINE | SHADER_INSTANCED_MARKER |
+                                                     SHADER_OBJECT_STATE,
+                                                     SHADER_GEO_POSITION | SHADER_FLAT_COLOR,
+                                                     SHADER_SPHERE_POSITION | SHADER_FLAT_COLOR,
+                                                     SHADER_RANGE_RING | SHADER_FLAT_COLOR,
+                                                     SHADER_MAP_LIGHTING | SHADER_GLOBE,
+                                                     SHADER_GREAT_CIRCLE | SHADER_TIMELINE | SHADER_FLAT_COLOR |
+                                                     SHADER_OBJECT_STATE | SHADER_GLOBE,
+                                                     SHADER_SPHERE_POSITION | SHADER_TIMELINE | SHADER_INSTANCED_MARKER |
+                                                     SHADER_OBJECT_STATE | SHADER_GLOBE,
+                                                     SHADER_GEO_POSITION | SHADER_FLAT_COLOR | SHADER_GLOBE,
+                                                     SHADER_SPHERE_POSITION | SHADER_FLAT_COLOR | SHADER_GLOBE,
+                                                     SHADER_RANGE_RING | SHADER_FLAT_COLOR | SHADER_GLOBE};
+        loader->expect(1 + static_cast<int>(std::size(frameVariants)));
+        co_await loader->onWorker();
+        auto library = std::make_unique<ShaderLibrary>(fs::path(SHADER_DIR) / "uber.vert",
+                                                       fs::path(SHADER_DIR) / "uber.frag");
+        loader->completed("shader sources");
+
+        for (unsigned int features: frameVariants) {
+            co_await loader->onGLThread();
+            library->variant(features);
+            loader->completed("shader variant");
+        }
+        shaders = library.release();
+        shaderWatcher = new ShaderWatcher(shaders);
+        frameGraph->touch(assetSignal);
+        refreshScreen();
+    }
+
+
+    /**
+     * Loads the land mesh from its cache, or triangulates the land polygons, on a
+     * worker thread and uploads it on the GL thread.
+     */
+    LoadTask loadLand() {
+        loader->expect(2);
+        co_await loader->onWorker();
+        CoastlineMesh mesh(fs::path(DATA_DIR) / "land.txt", fs::temp_directory_path() / "GFX_Lab3" / "land.mesh");
+        loader->completed("land mesh");
+
+        co_await loader->onGLThread();
+        land->setMesh(mesh);
+        loader->completed("land buffers");
+        frameGraph->touch(assetSignal);
+        refreshScreen();
+    }
+
+
+    /**
+     * Loads the glyph atlas from its cache, or generates it, on a worker thread
+     * and uploads it on the GL thread. Labels appear once it is uploaded.
+     */
+    LoadTask loadGlyphAtlas() {
+        loader->expect(2);
+        co_await loader->onWorker();
+        GlyphAtlas atlas(fs::temp_directory_path() / "GFX_Lab3" / "sdf_atlas.png");
+        loader->completed("glyph atlas");
+
+        co_await loader->onGLThread();
+        labels->setAtlas(atlas);
+        loader->completed("glyph texture");
+        frameGraph->touch(labelSignal);
+        refreshScreen();
+    }
+
+
 public:
-    MyApp() : glApp(4, 5, 600, 600, "Grafika labor #3") { }
+    MyApp() : glApp(4, 5, WindowSize, WindowSize, "Grafika labor #3") { useRenderThread(); }
 
 
     /**
-     * Initializes essential components required for the application, including:
-     * - Setting up the map data using the provided encoded dataset.
-     * - Creating and initializing a GPU program for rendering operations by compiling
-     *   and linking vertex and fragment shaders.
-     * - Initializing the hour offset used for time-based application logic.
+     * Initializes the scene model on the main thread, which has no GL context:
+     * - Creates the `IncrementalScheduler` for work spread over simulation steps.
+     * - Opens the control socket for scripting clients.
+     * - Starts the `WorkerPool` shared by both threads, and indexes the regions
+     *   that stations are tagged with. Creates the picker that finds the station
+     *   under the cursor.
+     * - Shows a single view, with the hour offset used for time-based application logic at 0.
+     * - Publishes the empty scene, so the render thread has a snapshot to start from.
+     */
+    void onInitialization() override {
+        scheduler = new IncrementalScheduler();
+        generation = 0;
+        control = new ControlServer((fs::temp_directory_path() / "gfx_lab3.sock").string());
+        workers = new WorkerPool();
+        regions = new RegionIndex(fs::path(DATA_DIR) / "land.txt");
+        picker = new StationPicker();
+        hoveredStation = -1;
+        largestMarker = MarkerStyle().size;
+        sceneVersion = 0;
+        replaySerial = 0;
+        replaySpeed = 1.0f;
+        views.assign(1, ViewSpec());
+        activeView = 0;
+        dragging = false;
+        dragView = 0;
+        timelineTime = 0.0f;
+        simulationTime = 0.0f;
+        publishScene();
+    }
+
+
+    /**
+     * Initializes the GPU side on the render thread, including:
+     * - Creating the map with a placeholder texture and the label renderer.
+     * - Starting the worker pool and the coroutine-based asset loader.
+     * - Building the frame graph that schedules the render passes.
      *
-     * This method is overridden from the base class and designed to be called during
-     * the application initialization phase. It ensures the necessary objects and
-     * resources are prepared for rendering and other application-specific tasks.
+     * It only creates cheap objects and starts the loads, so the first frame appears
+     * immediately; the map image, the shaders and the glyph atlas arrive over the
+     * next frames.
      *
      * Actions performed in this method:
-     * 1. Creates a new instance of the `Map` class using the `encodedData` to populate
-     *    the geometry or other map-related structures.
-     * 2. Allocates and initializes a new `GPUProgram` instance, using the provided
-     *    `vertexShaderSource` and `fragmentShaderSource` strings for shader compilation.
-     * 3. Sets the `hourOffset` variable to an initial value of 0, possibly for time or
-     *    animation-related features.
+     * 1. Creates a new instance of the `Map` class showing a placeholder color, the
+     *    land layer drawn over it once its mesh is loaded, and the mesh of the globe.
+     *    Enables the clip distance that removes the far side of the globe.
+     * 2. Creates the label renderer; labels are drawn once the atlas has arrived.
+     *    Creates the stream of positions published by simulators in shared memory,
+     *    the layer of vehicles moving along the paths and the layer of replayed tracks.
+     * 3. Creates the `AsyncLoader` pumped by `onRenderTimeElapsed` on the shared worker pool.
+     * 4. Creates the `RenderScale` that times the frames, and sets up a single view,
+     *    whose map, network, labels, feed and vehicle passes and the present pass are
+     *    declared via `buildFrameGraph`; `syncScene` splits the window when the snapshot
+     *    asks for more views.
+     * 5. Starts the `loadMapImage`, `loadLand`, `loadShaders` and `loadGlyphAtlas` coroutines.
      */
-    void onInitialization() override {
-        map = new Map(encodedData);
-        prog = new GPUProgram();
-        prog->create(vertexShaderSource, fragmentShaderSource);
-        hourOffset = 0;
-    }
-
-
-    /**
-     * Handles the rendering process for the application. This method is responsible for clearing
-     * the screen, setting up the GPU program, and rendering the main map, paths, and stations
-     * with appropriate attributes and visual properties.
-     *
-     * The rendering sequence includes:
-     * - Clearing the color buffer of the screen using `glClear` to ensure fresh rendering for every frame.
-     * - Activating the shader program through `prog->Use`, preparing it for drawing operations.
-     * - Setting a uniform value for the "hourOffset" parameter in the shader program to influence
-     *   time-based visual adjustments for the rendering.
-     * - Drawing the main map via the `map->DrawMap` function, using the active shader program.
-     * - Iterating over `paths` and rendering each path by calling `DrawPath` with a yellow (1.0, 1.0, 0.0)
-     *   color for visualization.
-     * - Iterating over `stations` and rendering each station by calling `DrawStation` with a red
-     *   (1.0, 0.0, 0.0) color for visualization.
-     *
-     * Inputs:
-     * - `hourOffset`: An integer offset that is converted to a floating-point value for use in the
-     *   shader program. This value can influence the visual representation of time-related information.
-     * - `prog`: A pointer to the `GPUProgram` object responsible for managing shader programs and
-     *   handling uniform data.
-     * - `map`: A pointer to the `Map` object that represents the primary map geometry to be rendered.
-     * - `paths`: A collection of `Path` objects, each representing a graphical path to be rendered
-     *   with a specific color.
-     * - `stations`: A collection of `Station` objects, each representing a graphical station to be
-     *   rendered with a specific color.
+    void onRenderInitialization() override {
+        map = new Map();
+        globe = new CubeSphere(WindowSize);
+        glEnable(GL_CLIP_DISTANCE0);
+        land = new CoastlineLayer();
+        network = new NetworkTimeline();
+        ringLayer = new RangeRingLayer();
+        renderedTimeline = 0.0f;
+        labels = new TextRenderer(WindowSize, WindowSize);
+        positionFeed = new PositionStream(DefaultPositionFeedName);
+        vehicles = new VehicleLayer();
+        expandedFleets = 0;
+        replay = nullptr;
+        replayVehicles = new VehicleLayer();
+        replayedSerial = 0;
+        shaders = nullptr;
+        shaderWatcher = nullptr;
+        loader = new AsyncLoader(*workers);
+        shownProgress = 0.0f;
+        renderedVersion = 0;
+        renderScale = new RenderScale(FrameBudget);
+        mapDrawn = false;
+        frameGraph = nullptr;
+        layoutViews(1);
+
+        loadMapImage();
+        loadLand();
+        loadShaders();
+        loadGlyphAtlas();
+    }
+
+
+    /**
+     * Handles the rendering process for the application on the render thread: takes
+     * over the newest scene snapshot, executes the frame graph, timing it for the
+     * `RenderScale`, and saves the frame for the capture requests it satisfies.
+     *
+     * The draw order is not hard-coded: the passes declared in `buildFrameGraph`
+     * run in the order implied by their inputs and outputs. Passes whose inputs did not
+     * change since the previous frame are skipped, so a frame in which neither the hour
+     * offset nor the network changed only copies the cached scene to the screen.
      *
      * Outputs:
      * - The frame is rendered to the screen with the updated representation of the map, paths, and
      *   stations according to their associated visual properties.
      */
     void onDisplay() override {
-        glClear(GL_COLOR_BUFFER_BIT);
-        prog->Use();
+        syncScene();
+        renderScale->beginFrame();
+        frameGraph->execute();
+        renderScale->endFrame(mapDrawn);
+        mapDrawn = false;
+        serveCaptures();
+    }
 
-        prog->setUniform(static_cast<float>(hourOffset), "hourOffset");
-        map->DrawMap(prog);
 
-        for (auto *path: paths)
-            path->DrawPath(prog, vec3(1.0f, 1.0f, 0.0f));
+    /**
+     * Called once per simulation step on the main thread. Answers the finished frame
+     * captures, executes the commands received on the control socket, runs
+     * incremental work for at most `IncrementalBudget` seconds, tags the stations
+     * added meanwhile with their region in one parallel batch, then publishes the
+     * scene if any of these changed it. A step hands at most one snapshot to the
+     * render thread, so the commands of a step, and every batch, reach the screen
+     * together.
+     *
+     * @param startTime Time of the previous call in seconds.
+     * @param endTime   Current time in seconds.
+     */
+    void onTimeElapsed(float startTime, float endTime) override {
+        simulationTime = endTime;
+        {
+            std::lock_guard<std::mutex> lock(captureMutex);
+            for (const auto &result: captureResults) control->complete(result.first, result.second);
+            captureResults.clear();
+        }
+        control->poll([this](const ControlCommand &command, ControlServer::Ticket ticket) {
+            return executeCommand(command, ticket);
+        });
+        scheduler->run(IncrementalBudget);
+        classifyStations();
+        if (sceneChanged) publishScene();
+    }
 
-        for (auto *station: stations)
-            station->DrawStation(prog, vec3(1.0f, 0.0f, 0.0f));
+
+    /**
+     * Called once per iteration of the render loop. Resumes the loading coroutines
+     * waiting for the GL thread, redraws when the loading progress changed or the
+     * position feed published a new frame, moves the vehicles and redraws them on
+     * every iteration while there are any, advances the replay of recorded tracks, and
+     * swaps in shader programs that the watcher thread recompiled since the last
+     * call; the old programs stay in use until then, and for good if the new
+     * sources did not compile. Finally resizes the map layers and redraws when the
+     * frame times measured so far moved the `RenderScale`.
+     *
+     * @param startTime Time of the previous call in seconds.
+     * @param endTime   Current time in seconds.
+     */
+    void onRenderTimeElapsed(float startTime, float endTime) override {
+        loader->pump();
+        if (loader->Progress() != shownProgress) {
+            shownProgress = loader->Progress();
+            refreshScreen();
+        }
+        if (positionFeed->update(endTime)) {
+            frameGraph->touch(feedSignal);
+            refreshScreen();
+        }
+        if (vehicles->Count() > 0) {
+            vehicles->update(endTime, *workers);
+            frameGraph->touch(vehicleSignal);
+            refreshScreen();
+        }
+        if (replay != nullptr) {
+            if (replay->update(endTime, *replayVehicles, *workers)) frameGraph->touch(vehicleSignal);
+            refreshScreen();
+        }
+        if (shaders != nullptr && shaders->applyReload()) {
+            frameGraph->touch(assetSignal);
+            refreshScreen();
+        }
+        if (renderScale->update()) {
+            scaleMapLayers();
+            std::cout << "Map rendered at " << std::lround(100.0f * renderScale->Scale()) << "% resolution" << std::endl;
+            refreshScreen();
+        }
     }
 
 
     /**
-     * Handles keyboard input events triggered by the user. Specifically, listens for the
-     * 'n' or 'N' key presses to advance the hour offset and refresh the application screen
-     * to reflect the updated state.
+     * Handles keyboard input events triggered by the user. Listens for the
+     * 'n' or 'N' key presses to advance the hour offset, which reaches the screen with the
+     * next published snapshot, for 'g' or 'G' to generate a random network over the next
+     * simulation steps, for 'c' or 'C' to cancel pending generation, for 'v' or 'V'
+     * to send a fleet of `FleetVehicles` vehicles along the paths, for ',' and '.'
+     * ('<' and '>') to move the timeline back and forth by `ScrubStep` (`ScrubJump`) hours,
+     * for '[' and ']' to halve or double the speed of the replay, for '+' and '-' to
+     * zoom in and out around the center of the view, for 'o' or 'O' to switch
+     * between the map and the globe, for 'w' or 'W' to split the window into
+     * 1, 4 or 9 views in turn, for 's' or 'S' to select or deselect the station
+     * under the cursor, and for 'r' or 'R' to add a range ring of `DefaultRingRadius`
+     * around it. The hour, the zoom and the globe apply to the view under
+     * the cursor.
      *
      * @param key The integer representation of the key pressed. This can correspond to ASCII values,
      *            where 'n' or 'N' are used to indicate advancing the hour.
      */
     void onKeyboard(int key) override {
         if (key == 'n' || key == 'N') {
-            hourOffset++;
-            refreshScreen();
+            views[activeView].hourOffset++;
+            sceneChanged = true;
+        } else if (key == 'g' || key == 'G') {
+            generateNetwork(GeneratedStations);
+        } else if (key == 'c' || key == 'C') {
+            scheduler->cancelAll();
+        } else if (key == 'v' || key == 'V') {
+            if (!addFleet(FleetVehicles, FleetSpeed)) std::cout << "Add a path before sending vehicles" << std::endl;
+        } else if (key == ',' || key == '.' || key == '<' || key == '>') {
+            float step = (key == '<' || key == '>') ? ScrubJump : ScrubStep;
+            timelineTime += (key == '.' || key == '>') ? step : -step;
+            sceneChanged = true;
+        } else if ((key == '[' || key == ']') && !replayFile.empty()) {
+            changeReplaySpeed(key == ']' ? 2.0f * replaySpeed : 0.5f * replaySpeed);
+        } else if (key == '+' || key == '=' || key == '-') {
+            views[activeView].camera.zoomAt(vec2(0.0f, 0.0f), key == '-' ? 0.5f : 2.0f);
+            sceneChanged = true;
+        } else if (key == 'o' || key == 'O') {
+            Camera &camera = views[activeView].camera;
+            camera.setGlobe(!camera.IsGlobe());
+            sceneChanged = true;
+        } else if (key == 'w' || key == 'W') {
+            int columns = viewColumns(views.size()) % MaxViewColumns + 1;
+            setViewCount(columns * columns);
+        } else if ((key == 's' || key == 'S') && hoveredStation >= 0) {
+            auto state = static_cast<unsigned char>(stationStates[hoveredStation] ^ ObjectSelected);
+            setStationState(hoveredStation, state);
+            std::cout << "Station S" << hoveredStation + 1 << ((state & ObjectSelected) ? " selected" : " deselected")
+                      << std::endl;
+        } else if ((key == 'r' || key == 'R') && hoveredStation >= 0) {
+            addRing(hoveredStation, DefaultRingRadius);
         }
     }
 
@@ -305,56 +1756,131 @@ public:
      * created stations.
      *
      * When the left button is pressed, the method performs the following:
-     * - Converts the screen coordinates of the click into normalized device coordinates (NDC).
-     * - Maps the NDC to geographic coordinates on the map.
-     * - Creates a new station at the geographic position and stores it.
-     * - If there are at least two stations, generates a path between the last two stations,
-     *   calculates the distance, and updates the list of distances.
+     * - Finds the view under the click and converts the screen coordinates of the click
+     *   into its normalized device coordinates (NDC).
+     * - Maps the NDC through the camera of the view to geographic coordinates on the map
+     *   or the globe; clicks beside the globe are ignored.
+     * - Adds a station at the geographic position to the scene model with `extendNetwork`,
+     *   which also connects it to the previous station and records the path's length.
+     * - Tags the station with its region and displays the region's name.
      * - Displays the computed distance in kilometers.
-     * - Triggers a screen refresh to render the updated elements.
+     * - The render thread creates the station, the path and their labels once the
+     *   scene is published at the end of the current simulation step.
+     *
+     * Pressing the right button starts dragging the map of the view under the cursor,
+     * see `onMouseMotion`.
      *
-     * @param but The mouse button that was pressed. Expected to be `MOUSE_LEFT` for processing.
+     * @param but The mouse button that was pressed.
      * @param pX The x-coordinate of the mouse cursor at the time of the press, in screen coordinates.
      * @param pY The y-coordinate of the mouse cursor at the time of the press, in screen coordinates.
      */
     void onMousePressed(MouseButton but, int pX, int pY) override {
-        if (but == MOUSE_LEFT) {
-            float ndcX = (2.0f * pX / 600) - 1.0f;
-            float ndcY = 1.0f - (2.0f * pY / 600);
-            vec2 geoPos = mapCoordinatesToGeographic(vec2(ndcX, ndcY));
-            stations.push_back(new Station(geoPos));
-            stationGeoCoords.push_back(geoPos);
-            if (stations.size() >= 2) {
-                vec2 start = stationGeoCoords[stationGeoCoords.size() - 2];
-                vec2 end = stationGeoCoords[stationGeoCoords.size() - 1];
-                paths.push_back(new Path(start, end));
-                float distance = calculateDistance(start, end);
-                distances.push_back(distance);
-                std::cout << "Distance: " << static_cast<int>(distance) << " km" << std::endl;
-            }
-            refreshScreen();
+        activeView = viewAt(pX, pY);
+        if (but == MOUSE_RIGHT) {
+            dragging = true;
+            dragView = activeView;
+            dragFrom = pixelToNdc(dragView, pX, pY);
+        } else if (but == MOUSE_LEFT) {
+            dvec2 geoPos;
+            if (!views[activeView].camera.ndcToGeographic(pixelToNdc(activeView, pX, pY), geoPos)) return;
+            extendNetwork(geoPos, fromNow());
+            classifyStations();
+            std::cout << "Station S" << stationGeoCoords.size() << " in "
+                      << regionName(static_cast<int>(stationGeoCoords.size() - 1)) << std::endl;
+            if (stationGeoCoords.size() >= 2)
+                std::cout << "Distance: " << static_cast<int>(pathLinks.back().distance) << " km" << std::endl;
         }
     }
 
 
+    /**
+     * Pans the map of the dragged view with the cursor while the right button is
+     * held, even when the cursor leaves the view. The map repeats horizontally, so
+     * it can be dragged around the globe any number of times; the globe turns
+     * under the cursor. Otherwise the view under the cursor becomes the one the
+     * keys apply to, and the station under the cursor is highlighted as hovered;
+     * only the station losing and the station gaining the flag change.
+     *
+     * @param pX The x-coordinate of the mouse cursor, in screen coordinates.
+     * @param pY The y-coordinate of the mouse cursor, in screen coordinates.
+     */
+    void onMouseMotion(int pX, int pY) override {
+        if (!dragging) {
+            activeView = viewAt(pX, pY);
+            hoverStation(stationAt(activeView, pX, pY));
+            return;
+        }
+        vec2 ndc = pixelToNdc(dragView, pX, pY);
+        views[dragView].camera.pan(ndc - dragFrom);
+        dragFrom = ndc;
+        sceneChanged = true;
+    }
+
+
+    /**
+     * Ends dragging the map when the right button is released.
+     */
+    void onMouseReleased(MouseButton but, int pX, int pY) override {
+        if (but == MOUSE_RIGHT) dragging = false;
+    }
+
+
+    /**
+     * Frees the GL objects on the render thread, while its context is still
+     * current and before the framework destroys the window.
+     *
+     * The method performs the following steps:
+     * - Destroys the loads still waiting for the GL thread, which may own GL
+     *   objects such as a half compiled shader library.
+     * - Frees memory allocated for the frame graph and its render targets, and the
+     *   uniform buffers of the views and the frame timer queries.
+     * - Frees memory allocated for the map object, the globe mesh and the land mesh buffers.
+     * - Frees the label renderer and its glyph atlas texture.
+     * - Unmaps the position feed and frees its vertex buffers.
+     * - Frees the vehicles and their instance buffer.
+     * - Stops the replay's loader thread and frees the replayed positions.
+     * - Stops the shader watcher thread, has the main thread destroy its shared
+     *   context, and frees the shader library and its compiled variants.
+     * - Frees the buffers of the stations, paths and range rings.
+     */
+    void onRenderShutdown() override {
+        loader->cancelGLWork();
+        delete frameGraph;
+        for (RenderView &view: renderViews) delete view.uniforms;
+        delete renderScale;
+        delete map;
+        delete globe;
+        delete land;
+        delete labels;
+        delete positionFeed;
+        delete vehicles;
+        delete replay;
+        delete replayVehicles;
+        delete shaderWatcher;
+        delete shaders;
+        delete network;
+        delete ringLayer;
+    }
+
+
     /**
      * Destructor for the MyApp class.
-     * Cleans up dynamically allocated memory and deallocates resources used by the application.
-     * This ensures there is no memory leak when the application terminates.
+     * Frees the objects of the main thread when the application terminates; the
+     * GL objects are gone by then, see `onRenderShutdown`.
      *
      * The destructor performs the following steps:
-     * - Frees memory allocated for the map object.
-     * - Frees memory allocated for the GPUProgram object.
-     * - Iterates through and deletes all dynamically allocated Path objects stored in the `paths` vector.
-     * - Iterates through and deletes all dynamically allocated Station objects stored in the `stations` vector.
-     *
-     * This process releases all resources associated with the application, preparing it for a proper cleanup.
+     * - Closes the control socket and drops the pending incremental work.
+     * - Frees the region index and the station picker.
+     * - Stops the worker pool and destroys the loads that reached the GL queue
+     *   since `onRenderShutdown`; they have not made GL objects yet.
      */
     ~MyApp() {
-        delete map;
-        delete prog;
-        for (auto *path: paths) delete path;
-        for (auto *station: stations) delete station;
+        delete control;
+        delete scheduler;
+        delete regions;
+        delete picker;
+        delete workers;
+        delete loader;
     }
 
 } app;
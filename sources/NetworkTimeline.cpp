@@ -0,0 +1,473 @@
+#include "NetworkTimeline.h"
+#include "Path.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+
+/**
+ * Sorts the instances added since the last call into the column. If all of them
+ * appear no earlier than the last instance so far, which is the usual case, they
+ * are appended; otherwise the column is merged from the first position at which
+ * one of them belongs. Only the positions from there on are marked for upload.
+ */
+template<typename Instance>
+void NetworkTimeline::Column<Instance>::merge() {
+    if (pending.empty()) return;
+    auto firstId = static_cast<uint32_t>(idAt.size());
+    std::vector<uint32_t> order(pending.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return pending[a].lifetime.x < pending[b].lifetime.x;
+    });
+
+    size_t first = std::upper_bound(appearTimes.begin(), appearTimes.end(), pending[order[0]].lifetime.x) -
+                   appearTimes.begin();
+    std::vector<Instance> tail(instances.begin() + first, instances.end());
+    std::vector<uint32_t> tailIds(idAt.begin() + first, idAt.end());
+    instances.resize(first);
+    appearTimes.resize(first);
+    idAt.resize(first);
+
+    size_t old = 0, added = 0;
+    while (old < tail.size() || added < order.size()) {
+        bool takeOld = added == order.size() ||
+                       (old < tail.size() && tail[old].lifetime.x <= pending[order[added]].lifetime.x);
+        const Instance &instance = takeOld ? tail[old] : pending[order[added]];
+        instances.push_back(instance);
+        appearTimes.push_back(instance.lifetime.x);
+        idAt.push_back(takeOld ? tailIds[old++] : firstId + order[added++]);
+    }
+    positionOf.resize(idAt.size());
+    for (size_t position = first; position < idAt.size(); ++position) positionOf[idAt[position]] = static_cast<uint32_t>(position);
+
+    size_t sortedBefore = disappearTimes.size();
+    for (const Instance &instance: pending) disappearTimes.push_back(instance.lifetime.y);
+    std::sort(disappearTimes.begin() + static_cast<std::ptrdiff_t>(sortedBefore), disappearTimes.end());
+    std::inplace_merge(disappearTimes.begin(), disappearTimes.begin() + static_cast<std::ptrdiff_t>(sortedBefore),
+                       disappearTimes.end());
+
+    pending.clear();
+    stateOf.resize(idAt.size(), 0);
+    dirtyBegin = std::min(dirtyBegin, first);
+    dirtyEnd = instances.size();
+}
+
+
+/**
+ * Changes the disappear time of an instance, which keeps its position since the
+ * column is sorted by appear time. Marks just that instance for upload.
+ *
+ * @param id   The instance, by the order it was added in.
+ * @param time New disappear time; not earlier than the appear time.
+ */
+template<typename Instance>
+void NetworkTimeline::Column<Instance>::setDisappear(uint32_t id, float time) {
+    if (id >= idAt.size()) {
+        Instance &instance = pending[id - idAt.size()];
+        instance.lifetime.y = std::max(time, instance.lifetime.x);
+        return;
+    }
+    size_t position = positionOf[id];
+    Instance &instance = instances[position];
+    time = std::max(time, instance.lifetime.x);
+    disappearTimes.erase(std::lower_bound(disappearTimes.begin(), disappearTimes.end(), instance.lifetime.y));
+    disappearTimes.insert(std::upper_bound(disappearTimes.begin(), disappearTimes.end(), time), time);
+    instance.lifetime.y = time;
+    touched.push_back(position);
+}
+
+
+/**
+ * Returns an instance for a change that keeps its position, such as a new
+ * style, and marks just that instance for upload.
+ *
+ * @param id The instance, by the order it was added in.
+ */
+template<typename Instance>
+Instance &NetworkTimeline::Column<Instance>::modify(uint32_t id) {
+    if (id >= idAt.size()) return pending[id - idAt.size()];
+    size_t position = positionOf[id];
+    touched.push_back(position);
+    return instances[position];
+}
+
+
+/**
+ * Changes the state flags of an instance. Marks just its byte of the state
+ * buffer for upload; an instance not merged yet gets it with its range.
+ *
+ * @param id    The instance, by the order it was added in.
+ * @param state `ObjectSelected`, `ObjectHovered` and `ObjectDimmed` flags.
+ */
+template<typename Instance>
+void NetworkTimeline::Column<Instance>::setState(uint32_t id, unsigned char state) {
+    if (id >= stateOf.size()) stateOf.resize(id + 1, 0);
+    stateOf[id] = state;
+    if (id < idAt.size()) touchedStates.push_back(positionOf[id]);
+}
+
+
+/**
+ * Uploads the marked range of instances, or the whole column if it outgrew the
+ * buffer, which then grows to at least twice its size. Instances changed in
+ * place outside that range are uploaded one record each. The state buffer
+ * follows the same range, and a state changed outside it is a one-byte upload.
+ */
+template<typename Instance>
+void NetworkTimeline::Column<Instance>::upload() {
+    if (dirtyBegin >= dirtyEnd && touched.empty() && touchedStates.empty()) return;
+    if (instances.size() > capacity) {
+        capacity = std::max({instances.size(), 2 * capacity, size_t(1024)});
+        glBindBuffer(GL_ARRAY_BUFFER, stateVbo);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(capacity * sizeof(Instance)), nullptr, GL_DYNAMIC_DRAW);
+        dirtyBegin = 0;
+        dirtyEnd = instances.size();
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (dirtyBegin < dirtyEnd)
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(dirtyBegin * sizeof(Instance)),
+                        static_cast<GLsizeiptr>((dirtyEnd - dirtyBegin) * sizeof(Instance)), instances.data() + dirtyBegin);
+    for (size_t position: touched)
+        if (position < dirtyBegin || position >= dirtyEnd)
+            glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(position * sizeof(Instance)), sizeof(Instance),
+                            instances.data() + position);
+
+    glBindBuffer(GL_ARRAY_BUFFER, stateVbo);
+    if (dirtyBegin < dirtyEnd) {
+        std::vector<unsigned char> states(dirtyEnd - dirtyBegin);
+        for (size_t position = dirtyBegin; position < dirtyEnd; ++position)
+            states[position - dirtyBegin] = stateOf[idAt[position]];
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(dirtyBegin), static_cast<GLsizeiptr>(states.size()),
+                        states.data());
+    }
+    for (size_t position: touchedStates)
+        if (position < dirtyBegin || position >= dirtyEnd)
+            glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(position), 1, &stateOf[idAt[position]]);
+    touched.clear();
+    touchedStates.clear();
+    dirtyBegin = SIZE_MAX;
+    dirtyEnd = 0;
+}
+
+
+/**
+ * Returns the number of instances that appeared at or before a time. They are
+ * the first ones in the buffer, so this is the draw count.
+ */
+template<typename Instance>
+size_t NetworkTimeline::Column<Instance>::Appeared(float time) const {
+    return std::upper_bound(appearTimes.begin(), appearTimes.end(), time) - appearTimes.begin();
+}
+
+
+/**
+ * Returns the number of instances visible at a time: those that appeared, minus
+ * those that also disappeared, with two binary searches.
+ */
+template<typename Instance>
+size_t NetworkTimeline::Column<Instance>::Visible(float time) const {
+    return Appeared(time) - (std::upper_bound(disappearTimes.begin(), disappearTimes.end(), time) -
+                             disappearTimes.begin());
+}
+
+
+/**
+ * Enables a float vertex attribute of an instance type in the bound vertex array.
+ */
+static void instanceAttribute(GLuint location, GLint size, GLsizei stride, size_t offset) {
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(offset));
+}
+
+
+/**
+ * Enables the state flags of the instances, from the bound state buffer, as an
+ * integer vertex attribute of the bound vertex array.
+ */
+static void stateAttribute() {
+    glEnableVertexAttribArray(9);
+    glVertexAttribIPointer(9, 1, GL_UNSIGNED_BYTE, 1, nullptr);
+}
+
+
+/**
+ * Creates the buffers, the vertex arrays and the icon texture. Stations and
+ * paths are instances whose vertices are generated from `gl_VertexID`, on the
+ * map and on the globe; stations have one vertex array for each, over the same
+ * buffers. Each column has a second buffer with the state flags of its
+ * instances. The divisors of the map's arrays are set when drawing, since they
+ * depend on the number of world copies.
+ */
+NetworkTimeline::NetworkTimeline() {
+    glGenVertexArrays(1, &stations.vao);
+    glGenBuffers(1, &stations.vbo);
+    glGenBuffers(1, &stations.stateVbo);
+    glBindVertexArray(stations.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, stations.stateVbo);
+    stateAttribute();
+    glBindBuffer(GL_ARRAY_BUFFER, stations.vbo);
+    instanceAttribute(0, 2, sizeof(StationInstance), offsetof(StationInstance, high));
+    instanceAttribute(5, 2, sizeof(StationInstance), offsetof(StationInstance, low));
+    instanceAttribute(4, 2, sizeof(StationInstance), offsetof(StationInstance, lifetime));
+    instanceAttribute(3, 3, sizeof(StationInstance), offsetof(StationInstance, color));
+    instanceAttribute(2, 3, sizeof(StationInstance), offsetof(StationInstance, marker));
+
+    glGenVertexArrays(1, &stationsOnGlobe);
+    glBindVertexArray(stationsOnGlobe);
+    glBindBuffer(GL_ARRAY_BUFFER, stations.stateVbo);
+    stateAttribute();
+    glBindBuffer(GL_ARRAY_BUFFER, stations.vbo);
+    instanceAttribute(0, 3, sizeof(StationInstance), offsetof(StationInstance, direction));
+    instanceAttribute(4, 2, sizeof(StationInstance), offsetof(StationInstance, lifetime));
+    instanceAttribute(3, 3, sizeof(StationInstance), offsetof(StationInstance, color));
+    instanceAttribute(2, 3, sizeof(StationInstance), offsetof(StationInstance, marker));
+    for (GLuint attribute: {0u, 2u, 3u, 4u, 9u}) glVertexAttribDivisor(attribute, 1);
+
+    glGenVertexArrays(1, &paths.vao);
+    glGenBuffers(1, &paths.vbo);
+    glGenBuffers(1, &paths.stateVbo);
+    glBindVertexArray(paths.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, paths.stateVbo);
+    stateAttribute();
+    glBindBuffer(GL_ARRAY_BUFFER, paths.vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PathInstance),
+                          reinterpret_cast<void *>(offsetof(PathInstance, start)));
+    glVertexAttribDivisor(0, 1);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(PathInstance),
+                          reinterpret_cast<void *>(offsetof(PathInstance, end)));
+    glVertexAttribDivisor(1, 1);
+    instanceAttribute(5, 2, sizeof(PathInstance), offsetof(PathInstance, startHigh));
+    instanceAttribute(6, 2, sizeof(PathInstance), offsetof(PathInstance, startLow));
+    instanceAttribute(7, 2, sizeof(PathInstance), offsetof(PathInstance, endHigh));
+    instanceAttribute(8, 2, sizeof(PathInstance), offsetof(PathInstance, endLow));
+    for (GLuint attribute: {5u, 6u, 7u, 8u}) glVertexAttribDivisor(attribute, 1);
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(PathInstance),
+                          reinterpret_cast<void *>(offsetof(PathInstance, lifetime)));
+    glVertexAttribDivisor(4, 1);
+    glBindVertexArray(0);
+
+    IconAtlas atlas;
+    glGenTextures(1, &iconTexture);
+    glBindTexture(GL_TEXTURE_2D, iconTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, IconAtlas::Width, IconAtlas::Height, 0, GL_RG, GL_UNSIGNED_BYTE,
+                 atlas.Texels().data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+/**
+ * Copies a marker style into the color and marker attributes of a station.
+ */
+static void applyStyle(const MarkerStyle &style, vec3 &color, vec3 &marker) {
+    color = style.color;
+    marker = vec3(static_cast<float>(style.icon), style.size, static_cast<float>(style.flags));
+}
+
+
+/**
+ * Adds a station. It reaches the GPU with the next `commit`.
+ *
+ * @param geo      Position in degrees.
+ * @param lifetime Appear and disappear time in hours.
+ * @param style    Icon, size, color and flags of its marker.
+ */
+void NetworkTimeline::addStation(const dvec2 &geo, const vec2 &lifetime, const MarkerStyle &style) {
+    StationInstance instance{};
+    splitPosition(geoToNormalizedMap(geo), instance.high, instance.low);
+    instance.direction = geoToCartesian(geo);
+    instance.lifetime = lifetime;
+    applyStyle(style, instance.color, instance.marker);
+    stations.pending.push_back(instance);
+}
+
+
+/**
+ * Changes the marker of a station. Only its record is uploaded with the next `commit`.
+ *
+ * @param station Index of the station.
+ * @param style   Icon, size, color and flags of the marker.
+ */
+void NetworkTimeline::setStationStyle(int station, const MarkerStyle &style) {
+    StationInstance &instance = stations.modify(static_cast<uint32_t>(station));
+    applyStyle(style, instance.color, instance.marker);
+}
+
+
+/**
+ * Adds a path. It reaches the GPU with the next `commit`.
+ *
+ * @param startGeo Position of the first station in degrees.
+ * @param endGeo   Position of the second station in degrees.
+ * @param lifetime Appear and disappear time in hours.
+ */
+void NetworkTimeline::addPath(const dvec2 &startGeo, const dvec2 &endGeo, const vec2 &lifetime) {
+    PathInstance instance{};
+    instance.start = geoToCartesian(startGeo);
+    instance.end = geoToCartesian(endGeo);
+    dvec2 start = geoToNormalizedMap(startGeo), end = geoToNormalizedMap(endGeo);
+    end.x -= 2.0 * std::round((end.x - start.x) / 2.0);
+    splitPosition(start, instance.startHigh, instance.startLow);
+    splitPosition(end, instance.endHigh, instance.endLow);
+    instance.lifetime = lifetime;
+    paths.pending.push_back(instance);
+}
+
+
+/**
+ * Retires a station at a time, e.g. when it was closed.
+ *
+ * @param station Index of the station.
+ * @param time    Disappear time in hours.
+ */
+void NetworkTimeline::setStationDisappear(int station, float time) {
+    stations.setDisappear(static_cast<uint32_t>(station), time);
+}
+
+
+/**
+ * Retires a path at a time.
+ *
+ * @param path Index of the path.
+ * @param time Disappear time in hours.
+ */
+void NetworkTimeline::setPathDisappear(int path, float time) {
+    paths.setDisappear(static_cast<uint32_t>(path), time);
+}
+
+
+/**
+ * Changes the state flags of a station. Only its byte is uploaded with the next `commit`.
+ *
+ * @param station Index of the station.
+ * @param state   `ObjectSelected`, `ObjectHovered` and `ObjectDimmed` flags.
+ */
+void NetworkTimeline::setStationState(int station, unsigned char state) {
+    stations.setState(static_cast<uint32_t>(station), state);
+}
+
+
+/**
+ * Changes the state flags of a path. Only its byte is uploaded with the next `commit`.
+ *
+ * @param path  Index of the path.
+ * @param state `ObjectSelected`, `ObjectHovered` and `ObjectDimmed` flags.
+ */
+void NetworkTimeline::setPathState(int path, unsigned char state) {
+    paths.setState(static_cast<uint32_t>(path), state);
+}
+
+
+/**
+ * Sorts the stations and paths added since the last call into place and
+ * uploads the changed ranges of both buffers.
+ */
+void NetworkTimeline::commit() {
+    stations.merge();
+    paths.merge();
+    stations.upload();
+    paths.upload();
+}
+
+
+/**
+ * Returns the number of stations visible at a time.
+ */
+size_t NetworkTimeline::VisibleStations(float time) const {
+    return stations.Visible(time);
+}
+
+
+/**
+ * Returns the number of paths visible at a time.
+ */
+size_t NetworkTimeline::VisiblePaths(float time) const {
+    return paths.Visible(time);
+}
+
+
+/**
+ * Draws the paths that are visible at a time. Arcs crossing the antimeridian
+ * reach up to half a map into the next copy, so the copies within that margin
+ * of the view are drawn too. Each path is one instance per copy; the divisor of
+ * the path attributes maps them back to the same path.
+ *
+ * @param prog   A `GREAT_CIRCLE | SPLIT_POSITION | TIMELINE | FLAT_COLOR | OBJECT_STATE` program, already
+ *               in use; `GREAT_CIRCLE | TIMELINE | FLAT_COLOR | OBJECT_STATE | GLOBE` on the globe.
+ * @param camera The view to draw.
+ * @param color  The color of the paths, shaded by their state.
+ * @param time   The point of the timeline to show, in hours.
+ */
+void NetworkTimeline::DrawPaths(GPUProgram *prog, const Camera &camera, vec3 color, float time) const {
+    size_t count = paths.Appeared(time);
+    if (count == 0) return;
+    prog->setUniform(color, "color");
+    prog->setUniform(static_cast<float>(ArcSegments), "arcSegments");
+    prog->setUniform(time, "timelineTime");
+    int copies = camera.setUniforms(prog, Camera::HalfWorld);
+    glLineWidth(3.0f);
+    glBindVertexArray(paths.vao);
+    for (GLuint attribute: {0u, 1u, 4u, 5u, 6u, 7u, 8u, 9u}) glVertexAttribDivisor(attribute, copies);
+    glDrawArraysInstanced(GL_LINE_STRIP, 0, ArcSegments + 1, static_cast<int>(count) * copies);
+    glBindVertexArray(0);
+}
+
+
+/**
+ * Draws the stations that are visible at a time as icon markers, with one
+ * instanced call of four-vertex quads, alpha blended over the target.
+ *
+ * @param prog   A `SPLIT_POSITION | TIMELINE | INSTANCED_MARKER | OBJECT_STATE` program, already in use;
+ *               `SPHERE_POSITION | TIMELINE | INSTANCED_MARKER | OBJECT_STATE | GLOBE` on the globe.
+ * @param camera The view to draw; every visible copy of the map is one instance per station.
+ * @param time   The point of the timeline to show, in hours.
+ */
+void NetworkTimeline::DrawStations(GPUProgram *prog, const Camera &camera, float time) const {
+    size_t count = stations.Appeared(time);
+    if (count == 0) return;
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, iconTexture);
+    prog->setUniform(0, "tex");
+    prog->setUniform(vec2(IconAtlas::Columns, IconAtlas::Rows), "atlasGrid");
+    prog->setUniform(static_cast<float>(IconAtlas::CellSize) / IconAtlas::IconSize, "markerQuadScale");
+    prog->setUniform(time, "timelineTime");
+    int copies = camera.setUniforms(prog);
+    if (!camera.IsGlobe()) {
+        glBindVertexArray(stations.vao);
+        for (GLuint attribute: {0u, 2u, 3u, 4u, 5u, 9u}) glVertexAttribDivisor(attribute, copies);
+    } else {
+        glBindVertexArray(stationsOnGlobe);
+    }
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<int>(count) * copies);
+    glDisable(GL_BLEND);
+    glBindVertexArray(0);
+}
+
+
+/**
+ * Destructor for the `NetworkTimeline` class. Releases the buffers, vertex arrays and the icon texture.
+ */
+NetworkTimeline::~NetworkTimeline() {
+    glDeleteBuffers(1, &stations.vbo);
+    glDeleteBuffers(1, &stations.stateVbo);
+    glDeleteVertexArrays(1, &stations.vao);
+    glDeleteVertexArrays(1, &stationsOnGlobe);
+    glDeleteBuffers(1, &paths.vbo);
+    glDeleteBuffers(1, &paths.stateVbo);
+    glDeleteVertexArrays(1, &paths.vao);
+    glDeleteTextures(1, &iconTexture);
+}
@@ -0,0 +1,181 @@
+#ifndef NETWORKTIMELINE_H
+#define NETWORKTIMELINE_H
+
+#include "framework.h"
+#include "Camera.h"
+#include "IconAtlas.h"
+#include <vector>
+
+
+/**
+ * Disappear time of stations and paths that were never retired, in hours.
+ */
+constexpr float TimelineNever = 1e30f;
+
+/**
+ * State flags of a station or path, shading it in the `OBJECT_STATE` shader variants.
+ */
+constexpr unsigned char ObjectSelected = 1u << 0;   // lightened, and markers get their halo
+constexpr unsigned char ObjectHovered = 1u << 1;    // lightened less
+constexpr unsigned char ObjectDimmed = 1u << 2;     // darkened
+
+
+/**
+ * How a station is drawn: an icon of the `IconAtlas`, its size in pixels, its
+ * color and its `MarkerHalo` style flags. The default is the red 10-pixel square.
+ */
+struct MarkerStyle {
+    int icon = IconSquare;
+    float size = 10.0f;
+    vec3 color = vec3(1.0f, 0.0f, 0.0f);
+    unsigned int flags = 0;
+};
+
+
+/**
+ * @class NetworkTimeline
+ * @brief Draws every station and path of the network as it was at a point in time.
+ *
+ * Each station and path has a lifetime: the time it appears and the time it
+ * disappears on the timeline. Stations are points and paths are great-circle
+ * arcs generated in the vertex shader from their endpoints, so each of them is
+ * a single instance in one of two GPU buffers, and the whole network is drawn
+ * with two draw calls.
+ *
+ * Both buffers are kept sorted by appear time, and the appear and disappear
+ * times are also kept as sorted columns on the CPU. Showing the network at a
+ * time is then a binary search for the number of instances that appeared so
+ * far, which is the draw count; instances that disappeared since are hidden by
+ * the `TIMELINE` shader variant. Moving the time never touches the buffers.
+ * They are only updated when the network changes, and then only from the first
+ * instance that moved to the last one, which for stations and paths appearing
+ * at the current time is just the new ones at the end, plus the single records
+ * of the instances changed in place, such as a retirement or a new style.
+ *
+ * Stations are drawn as icon markers (`INSTANCED_MARKER` shader variant): each
+ * station's record holds its icon in the `IconAtlas`, size, color and flags
+ * next to its position, the vertex shader expands it into a quad from
+ * `gl_VertexID`, and all stations are drawn with one instanced call.
+ *
+ * The selected, hovered and dimmed flags of stations and paths are kept apart
+ * from the instances, in a second buffer of one byte per instance in the same
+ * order, read as an integer attribute by the `OBJECT_STATE` shader variant.
+ * Hovering or selecting an object changes its byte alone, so highlighting
+ * costs a one-byte upload and no extra draw call however large the network.
+ *
+ * Positions are given in double precision and stored as high/low float pairs
+ * of their map coordinates (see `splitPosition`), which the `SPLIT_POSITION`
+ * shader variant draws relative to the camera, so stations and the endpoints
+ * of paths stay exactly in place at street-level zoom.
+ *
+ * Stations also keep their unit vector, and paths are stored by the unit vectors
+ * of their endpoints anyway, so the globe is drawn from the same buffers: paths
+ * through the same vertex array, and stations through a second vertex array
+ * reading the unit vectors of the same buffer. Switching between the map and
+ * the globe never touches the buffers either.
+ *
+ * Stations and paths are identified by the order they were added in, like in
+ * the scene model.
+ */
+class NetworkTimeline final {
+public:
+    static constexpr int ArcSegments = 64;
+
+private:
+    struct StationInstance {
+        vec2 high;       // map position, split into high and low parts
+        vec2 low;
+        vec3 direction;  // unit vector, for the globe
+        vec2 lifetime;
+        vec3 color;
+        vec3 marker;     // icon, size in pixels, flags
+    };
+
+    struct PathInstance {
+        vec3 start;      // unit vectors of the endpoints
+        vec3 end;
+        vec2 startHigh;  // map positions of the endpoints, split; the end unwrapped towards the start
+        vec2 startLow;
+        vec2 endHigh;
+        vec2 endLow;
+        vec2 lifetime;
+    };
+
+    /**
+     * Instances sorted by appear time, with the bookkeeping to find them by id,
+     * to count them at a time, and to upload only what changed.
+     */
+    template<typename Instance>
+    struct Column {
+        std::vector<Instance> instances;     // sorted by lifetime.x
+        std::vector<float> appearTimes;      // lifetime.x of `instances`
+        std::vector<float> disappearTimes;   // sorted on their own
+        std::vector<uint32_t> idAt;          // id of the instance at a position
+        std::vector<uint32_t> positionOf;    // position of the instance with an id
+        std::vector<Instance> pending;       // added since the last `commit`
+        size_t dirtyBegin = SIZE_MAX;
+        size_t dirtyEnd = 0;
+        std::vector<size_t> touched;         // positions changed in place since the last upload
+        std::vector<unsigned char> stateOf;  // state flags of the instance with an id
+        std::vector<size_t> touchedStates;   // positions whose state changed since the last upload
+        unsigned int vao = 0;
+        unsigned int vbo = 0;
+        unsigned int stateVbo = 0;           // state flags by position
+        size_t capacity = 0;
+
+        void merge();
+
+        void setDisappear(uint32_t id, float time);
+
+        Instance &modify(uint32_t id);
+
+        void setState(uint32_t id, unsigned char state);
+
+        void upload();
+
+        size_t Appeared(float time) const;
+
+        size_t Visible(float time) const;
+    };
+
+    Column<StationInstance> stations;
+    Column<PathInstance> paths;
+    unsigned int stationsOnGlobe = 0;   // vertex array over the unit vectors of `stations`
+    unsigned int iconTexture = 0;
+
+public:
+    NetworkTimeline();
+
+    void addStation(const dvec2 &geo, const vec2 &lifetime, const MarkerStyle &style);
+
+    void setStationStyle(int station, const MarkerStyle &style);
+
+    void addPath(const dvec2 &startGeo, const dvec2 &endGeo, const vec2 &lifetime);
+
+    void setStationDisappear(int station, float time);
+
+    void setPathDisappear(int path, float time);
+
+    void setStationState(int station, unsigned char state);
+
+    void setPathState(int path, unsigned char state);
+
+    void commit();
+
+    size_t StationCount() const { return stations.idAt.size() + stations.pending.size(); }
+
+    size_t PathCount() const { return paths.idAt.size() + paths.pending.size(); }
+
+    size_t VisibleStations(float time) const;
+
+    size_t VisiblePaths(float time) const;
+
+    void DrawPaths(GPUProgram *prog, const Camera &camera, vec3 color, float time) const;
+
+    void DrawStations(GPUProgram *prog, const Camera &camera, float time) const;
+
+    ~NetworkTimeline();
+};
+
+
+#endif //NETWORKTIMELINE_H
@@ -1,4 +1,6 @@
 #include "Path.h"
+#include <algorithm>
+#include <cmath>
 
 
 /**
@@ -32,6 +34,21 @@ vec2 geoToNormalizedMap(const vec2 &geo) {
 }
 
 
+/**
+ * Converts geographic coordinates to normalized map coordinates in double
+ * precision, with the same projection as the single precision version.
+ *
+ * @param geo Latitude and longitude in degrees.
+ * @return The normalized map coordinates.
+ */
+dvec2 geoToNormalizedMap(const dvec2 &geo) {
+    const double maxY = std::log(std::tan(85.0 * M_PI / 180.0) + 1.0 / std::cos(85.0 * M_PI / 180.0));
+    double latitudeRad = geo.x * M_PI / 180.0;
+    double mercatorProjectionY = std::log(std::tan(latitudeRad) + 1.0 / std::cos(latitudeRad));
+    return dvec2(geo.y / 180.0, mercatorProjectionY / maxY);
+}
+
+
 /**
  * Converts normalized map coordinates to geographic coordinates (latitude and longitude).
  *
@@ -64,6 +81,37 @@ vec2 mapCoordinatesToGeographic(const vec2 &normalizedMap) {
 }
 
 
+/**
+ * Converts normalized map coordinates to geographic coordinates in double
+ * precision, e.g. for a click at deep zoom.
+ *
+ * @param normalizedMap The normalized map coordinates.
+ * @return Latitude and longitude in degrees.
+ */
+dvec2 mapCoordinatesToGeographic(const dvec2 &normalizedMap) {
+    const double maxY = std::log(std::tan(85.0 * M_PI / 180.0) + 1.0 / std::cos(85.0 * M_PI / 180.0));
+    double latitude = std::atan(std::sinh(normalizedMap.y * maxY)) * 180.0 / M_PI;
+    return dvec2(latitude, normalizedMap.x * 180.0);
+}
+
+
+/**
+ * Splits a double precision position into the nearest float position and the
+ * float remainder. Their sum is exact to about 1e-14 of the map width, and the
+ * camera position is split the same way, so a shader subtracting the two high
+ * parts and the two low parts separately gets the position relative to the
+ * camera without the cancellation a single float would suffer.
+ *
+ * @param position The position.
+ * @param high     Receives the float nearest to the position.
+ * @param low      Receives the remainder.
+ */
+void splitPosition(const dvec2 &position, vec2 &high, vec2 &low) {
+    high = vec2(position);
+    low = vec2(position - dvec2(high));
+}
+
+
 /**
  * Converts geographic coordinates (latitude and longitude) to Cartesian coordinates.
  *
@@ -90,6 +138,21 @@ vec3 geoToCartesian(const vec2 &geo) {
 }
 
 
+/**
+ * Converts geographic coordinates to a unit vector, computed in double precision.
+ *
+ * @param geo Latitude and longitude in degrees.
+ * @return The unit vector.
+ */
+vec3 geoToCartesian(const dvec2 &geo) {
+    double latitudeRad = geo.x * M_PI / 180.0;
+    double longitudeRad = geo.y * M_PI / 180.0;
+    return vec3(dvec3(std::cos(latitudeRad) * std::cos(longitudeRad),
+                      std::cos(latitudeRad) * std::sin(longitudeRad),
+                      std::sin(latitudeRad)));
+}
+
+
 /**
  * Performs spherical linear interpolation (SLERP) between two vectors.
  *
@@ -145,50 +208,33 @@ vec2 cartesianToGeographic(const vec3 &cartesianCoordinates) {
 
 
 /**
- * Constructs a Path object connecting two geographic coordinates.
- *
- * This function generates a path between two points specified by their geographic
- * coordinates (latitude and longitude). The path consists of interpolated points
- * between the start and end coordinates, which are converted and stored as normalized
- * map coordinates. The object's vertex buffer is updated to include these points.
- *
- * @param start A vec2 object representing the starting point of the path, where
- *              `start.x` is the latitude in degrees and `start.y` is the longitude in degrees.
- * @param end   A vec2 object representing the ending point of the path, where
- *              `end.x` is the latitude in degrees and `end.y` is the longitude in degrees.
- */
-Path::Path(const vec2 &start, const vec2 &end) {
-    vec3 startCart = geoToCartesian(start);
-    vec3 endCart = geoToCartesian(end);
-    const int numPoints = 100;
-
-    for (int i = 0; i <= numPoints; ++i) {
-        float t = static_cast<float>(i) / numPoints;
-        vec3 interpCart = sphericalLinearInterpolation(startCart, endCart, t);
-        vec2 interpGeo = cartesianToGeographic(interpCart);
-        Vtx().push_back(geoToNormalizedMap(interpGeo));
-    }
-    updateGPU();
-}
-
-
-/**
- * Renders a path using a GPU program with the specified color.
- *
- * This method draws a series of connected line segments representing the path
- * on the current OpenGL context. It uses the provided GPU program to set uniforms,
- * such as the color of the path and whether it is textured. The method ensures drawing
- * with a specific line width and activates the necessary vertex arrays and buffers.
- *
- * @param prog The GPUProgram instance used to set uniforms and render the path.
- * @param color A vec3 object specifying the RGB color of the path.
+ * Samples the great-circle arc between two stations on the map, like the
+ * `GREAT_CIRCLE` vertex shader draws it: spherical interpolation between the
+ * endpoints, every point unwrapped towards the start, and the endpoints
+ * themselves exact. The CPU-side drawings of paths use it, so they match the
+ * GPU one.
+ *
+ * @param startGeo Position of the first station in degrees.
+ * @param endGeo   Position of the second station in degrees.
+ * @param segments Number of segments of the arc, at least 1.
+ * @param points   Receives `segments + 1` normalized map positions, appended.
  */
-void Path::DrawPath(GPUProgram *prog, vec3 color) {
-    if (vtx.size() > 0) {
-        prog->setUniform(color, "color");
-        prog->setUniform(false, "isTextured");
-        glLineWidth(3.0f);
-        Bind();
-        glDrawArrays(GL_LINE_STRIP, 0, static_cast<int>(vtx.size()));
+void sampleGreatCircle(const dvec2 &startGeo, const dvec2 &endGeo, int segments, std::vector<dvec2> &points) {
+    dvec2 start = geoToNormalizedMap(startGeo), end = geoToNormalizedMap(endGeo);
+    end.x -= 2.0 * std::round((end.x - start.x) / 2.0);
+    dvec3 from = dvec3(geoToCartesian(startGeo)), to = dvec3(geoToCartesian(endGeo));
+    double omega = std::acos(std::clamp(glm::dot(from, to), -1.0, 1.0));
+    points.push_back(start);
+    for (int i = 1; i < segments; ++i) {
+        double t = static_cast<double>(i) / segments;
+        dvec3 point = omega < 1e-4 ? from : (std::sin((1.0 - t) * omega) * from + std::sin(t * omega) * to) /
+                                            std::sin(omega);
+        double length = glm::length(point);
+        dvec2 geo(glm::degrees(std::asin(std::clamp(point.z / length, -1.0, 1.0))),
+                  glm::degrees(std::atan2(point.y, point.x)));
+        dvec2 map = geoToNormalizedMap(dvec2(std::clamp(geo.x, -85.0, 85.0), geo.y));
+        map.x -= 2.0 * std::round((map.x - start.x) / 2.0);
+        points.push_back(map);
     }
+    points.push_back(end);
 }
@@ -1,37 +1,40 @@
 #ifndef PATH_H
 #define PATH_H
 
-#include "Map.h"
+#include "framework.h"
 
 
+/**
+ * Conversions between geographic coordinates (latitude, longitude in degrees),
+ * the normalized Mercator map and unit vectors, and interpolation along great
+ * circles. Shared by the network, the vehicles, the labels and the CPU-side
+ * drawing of paths in the vector export and the software renderer.
+ *
+ * The double precision overloads keep positions exact to well below a meter,
+ * for the stations and paths that are drawn relative to the camera at deep
+ * zoom; `splitPosition` turns such a position into the two floats the shaders
+ * receive.
+ */
+
 vec2 geoToNormalizedMap(const vec2 &geo);
 
+dvec2 geoToNormalizedMap(const dvec2 &geo);
+
 vec2 mapCoordinatesToGeographic(const vec2 &normalizedMap);
 
+dvec2 mapCoordinatesToGeographic(const dvec2 &normalizedMap);
+
+void splitPosition(const dvec2 &position, vec2 &high, vec2 &low);
+
 vec3 geoToCartesian(const vec2 &geo);
 
+vec3 geoToCartesian(const dvec2 &geo);
+
 vec3 sphericalLinearInterpolation(const vec3 &startVector, const vec3 &endVector, float interpolationFactor);
 
 vec2 cartesianToGeographic(const vec3 &cartesianCoordinates);
 
-
-/**
- * @class Path
- * @brief A class representing a geographical path between two points, derived from the Geometry class.
- *
- * The Path class allows for creating a path between two geographical coordinates
- * and rendering it using a specific GPU program and color. Internally, the path
- * is represented as a series of points interpolated between the starting and ending
- * geographical coordinates.
- *
- * The class utilizes the `Geometry` class for its GPU vertex array and buffer management.
- */
-class Path final : public Geometry<vec2> {
-public:
-    Path(const vec2 &start, const vec2 &end);
-
-    void DrawPath(GPUProgram *prog, vec3 color);
-};
+void sampleGreatCircle(const dvec2 &startGeo, const dvec2 &endGeo, int segments, std::vector<dvec2> &points);
 
 
 #endif //PATH_H
@@ -0,0 +1,252 @@
+#include "PositionFeed.h"
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * Returns the size of one slot in the segment: the slot header followed by its
+ * records, rounded up to a cache line so that slots never share one.
+ *
+ * @param slotCapacity Number of records per slot.
+ * @return Distance between consecutive slots in bytes.
+ */
+static size_t slotStrideFor(uint32_t slotCapacity) {
+    size_t bytes = sizeof(PositionFeedSlot) + static_cast<size_t>(slotCapacity) * sizeof(PositionRecord);
+    return (bytes + 63) / 64 * 64;
+}
+
+
+/**
+ * Returns the records stored after a slot header.
+ */
+static PositionRecord *recordsOf(PositionFeedSlot *slot) {
+    return reinterpret_cast<PositionRecord *>(reinterpret_cast<unsigned char *>(slot) + sizeof(PositionFeedSlot));
+}
+
+
+/**
+ * Creates the shared memory segment of a feed, replacing a stale one left behind
+ * by a producer that did not exit cleanly. Check `IsOpen` for success.
+ *
+ * @param name         POSIX shared memory name, starting with a slash.
+ * @param slotCount    Number of frames in the ring; at least 2.
+ * @param slotCapacity Maximum number of records per frame.
+ */
+PositionFeedWriter::PositionFeedWriter(const std::string &name, uint32_t slotCount, uint32_t slotCapacity)
+    : name(name) {
+#if defined(__unix__) || defined(__APPLE__)
+    if (slotCount < 2) slotCount = 2;
+    slotStride = slotStrideFor(slotCapacity);
+    size = sizeof(PositionFeedHeader) + slotCount * slotStride;
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) < 0) {
+        std::cerr << "Cannot create the position feed " << name << std::endl;
+        if (fd >= 0) close(fd);
+        return;
+    }
+    void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Cannot map the position feed " << name << std::endl;
+        shm_unlink(name.c_str());
+        return;
+    }
+    memory = static_cast<unsigned char *>(mapping);
+
+    auto *header = new(memory) PositionFeedHeader();
+    header->version = PositionFeedVersion;
+    header->slotCount = slotCount;
+    header->slotCapacity = slotCapacity;
+    header->publishedFrame.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < slotCount; ++i) {
+        auto *slot = new(memory + sizeof(PositionFeedHeader) + i * slotStride) PositionFeedSlot();
+        slot->sequence.store(0, std::memory_order_relaxed);
+        slot->frame.store(0, std::memory_order_relaxed);
+        slot->count.store(0, std::memory_order_relaxed);
+    }
+    header->magic.store(PositionFeedMagic, std::memory_order_release);
+#else
+    std::cerr << "The position feed needs POSIX shared memory" << std::endl;
+#endif
+}
+
+
+/**
+ * Returns the slot that holds a given frame.
+ */
+PositionFeedSlot *PositionFeedWriter::slot(uint64_t frameNumber) const {
+    auto *header = reinterpret_cast<PositionFeedHeader *>(memory);
+    return reinterpret_cast<PositionFeedSlot *>(memory + sizeof(PositionFeedHeader) +
+                                                frameNumber % header->slotCount * slotStride);
+}
+
+
+/**
+ * Returns the maximum number of records per frame.
+ */
+uint32_t PositionFeedWriter::SlotCapacity() const {
+    return memory ? reinterpret_cast<PositionFeedHeader *>(memory)->slotCapacity : 0;
+}
+
+
+/**
+ * Starts writing the next frame: marks its slot as being written and returns
+ * its records. Readers that copy the slot until `publish` discard the copy.
+ *
+ * @return Room for `SlotCapacity()` records.
+ */
+PositionRecord *PositionFeedWriter::beginFrame() {
+    PositionFeedSlot *next = slot(frame + 1);
+    next->sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return recordsOf(next);
+}
+
+
+/**
+ * Completes the frame started by `beginFrame` and makes it the newest one.
+ *
+ * @param count Number of records written, at most `SlotCapacity()`.
+ */
+void PositionFeedWriter::publish(uint32_t count) {
+    auto *header = reinterpret_cast<PositionFeedHeader *>(memory);
+    PositionFeedSlot *next = slot(++frame);
+    next->frame.store(frame, std::memory_order_relaxed);
+    next->count.store(count < header->slotCapacity ? count : header->slotCapacity, std::memory_order_relaxed);
+    next->sequence.fetch_add(1, std::memory_order_release);
+    header->publishedFrame.store(frame, std::memory_order_release);
+}
+
+
+/**
+ * Destructor for the `PositionFeedWriter` class. Unmaps the segment and removes
+ * its name; viewers keep their mapping until they notice the feed went quiet.
+ */
+PositionFeedWriter::~PositionFeedWriter() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (memory) {
+        munmap(memory, size);
+        shm_unlink(name.c_str());
+    }
+#endif
+}
+
+
+/**
+ * Maps an existing feed read-only. The reader stays closed if the segment does
+ * not exist yet, is still being set up, or speaks another protocol version.
+ *
+ * @param name POSIX shared memory name, starting with a slash.
+ */
+PositionFeedReader::PositionFeedReader(const std::string &name) {
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return;
+    struct stat info{};
+    if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(PositionFeedHeader)) {
+        close(fd);
+        return;
+    }
+    void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return;
+
+    const auto *candidate = static_cast<const PositionFeedHeader *>(mapping);
+    size_t stride = slotStrideFor(candidate->slotCapacity);
+    if (candidate->magic.load(std::memory_order_acquire) != PositionFeedMagic ||
+        candidate->version != PositionFeedVersion || candidate->slotCount < 2 ||
+        sizeof(PositionFeedHeader) + candidate->slotCount * stride > static_cast<size_t>(info.st_size)) {
+        munmap(mapping, static_cast<size_t>(info.st_size));
+        return;
+    }
+    memory = static_cast<const unsigned char *>(mapping);
+    size = static_cast<size_t>(info.st_size);
+    slotStride = stride;
+#endif
+}
+
+
+/**
+ * Returns the slot that holds a given frame.
+ */
+const PositionFeedSlot *PositionFeedReader::slot(uint64_t frameNumber) const {
+    return reinterpret_cast<const PositionFeedSlot *>(memory + sizeof(PositionFeedHeader) +
+                                                      frameNumber % header()->slotCount * slotStride);
+}
+
+
+/**
+ * Returns the maximum number of records per frame, i.e. the room a destination
+ * passed to `readLatest` must have.
+ */
+uint32_t PositionFeedReader::SlotCapacity() const {
+    return memory ? header()->slotCapacity : 0;
+}
+
+
+/**
+ * Returns the number of the newest complete frame; 0 before the first one.
+ */
+uint64_t PositionFeedReader::PublishedFrame() const {
+    return memory ? header()->publishedFrame.load(std::memory_order_acquire) : 0;
+}
+
+
+/**
+ * Copies the newest complete frame into `destination`.
+ *
+ * The slot's sequence is read before and after the copy; if the producer started
+ * rewriting the slot in between, the copy is discarded and repeated with the
+ * then newest frame, at most `MaxAttempts` times.
+ *
+ * @param destination Room for `SlotCapacity()` records, e.g. a mapped vertex buffer.
+ * @param frame       Receives the number of the copied frame.
+ * @param count       Receives the number of records copied.
+ * @return True if a consistent frame was copied; false if nothing was published
+ *         yet or every attempt was overwritten during the copy.
+ */
+bool PositionFeedReader::readLatest(PositionRecord *destination, uint64_t &frame, uint32_t &count) const {
+    if (!memory) return false;
+    for (int attempt = 0; attempt < MaxAttempts; ++attempt) {
+        uint64_t newest = header()->publishedFrame.load(std::memory_order_acquire);
+        if (newest == 0) return false;
+
+        const PositionFeedSlot *source = slot(newest);
+        uint64_t before = source->sequence.load(std::memory_order_acquire);
+        if (before & 1) continue;
+        uint64_t slotFrame = source->frame.load(std::memory_order_relaxed);
+        uint32_t slotCount = source->count.load(std::memory_order_relaxed);
+        if (slotCount > header()->slotCapacity) continue;
+
+        std::memcpy(destination, reinterpret_cast<const unsigned char *>(source) + sizeof(PositionFeedSlot),
+                    slotCount * sizeof(PositionRecord));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (source->sequence.load(std::memory_order_relaxed) == before && slotFrame == newest) {
+            frame = slotFrame;
+            count = slotCount;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * Destructor for the `PositionFeedReader` class. Unmaps the segment.
+ */
+PositionFeedReader::~PositionFeedReader() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (memory) munmap(const_cast<unsigned char *>(memory), size);
+#endif
+}
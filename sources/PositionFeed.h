@@ -0,0 +1,127 @@
+#ifndef POSITIONFEED_H
+#define POSITIONFEED_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+/**
+ * Shared memory protocol between position producers (simulators running in other
+ * processes on the same host) and the viewer. This header does not depend on
+ * OpenGL, so producers can include it on its own.
+ *
+ * The segment starts with a `PositionFeedHeader`, followed by `slotCount` slots.
+ * Each slot is a `PositionFeedSlot` followed by `slotCapacity` position records,
+ * padded to a multiple of 64 bytes. The producer writes frame `n` (starting at 1)
+ * into slot `n % slotCount`, so the viewer can copy the newest frame while the
+ * next ones are written. A slot is protected by a seqlock: its sequence is odd
+ * while the producer writes it, and a reader that sees the same even sequence
+ * before and after copying the slot knows it copied a consistent frame.
+ */
+constexpr uint32_t PositionFeedMagic = 0x50464431;   // "PFD1"
+constexpr uint32_t PositionFeedVersion = 1;
+constexpr const char *DefaultPositionFeedName = "/gfx_lab3_positions";
+
+
+/**
+ * One position, laid out exactly as the viewer's vertex buffer expects it: the
+ * first two floats are the vertex position in the `vec2 geo` convention of the
+ * map (latitude, longitude in degrees).
+ */
+struct PositionRecord {
+    float latitude;
+    float longitude;
+    uint32_t objectId;
+    uint32_t flags;
+};
+
+static_assert(sizeof(PositionRecord) == 16, "position records are 16 bytes in shared memory");
+
+
+struct alignas(64) PositionFeedHeader {
+    std::atomic<uint32_t> magic;            // written last, once the header is complete
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotCapacity;                  // records per slot
+    std::atomic<uint64_t> publishedFrame;   // newest complete frame, 0 before the first
+};
+
+
+struct alignas(64) PositionFeedSlot {
+    std::atomic<uint64_t> sequence;         // odd while the slot is being written
+    std::atomic<uint64_t> frame;
+    std::atomic<uint32_t> count;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory atomics must be lock-free");
+
+
+/**
+ * @class PositionFeedWriter
+ * @brief Producer side of the position feed: creates the segment and publishes frames.
+ *
+ * Each frame is written in place: `beginFrame` returns the records of the next
+ * slot, already marked as being written, and `publish` completes it.
+ */
+class PositionFeedWriter final {
+    std::string name;
+    unsigned char *memory = nullptr;
+    size_t size = 0;
+    size_t slotStride = 0;
+    uint64_t frame = 0;
+
+    PositionFeedSlot *slot(uint64_t frameNumber) const;
+
+public:
+    PositionFeedWriter(const std::string &name, uint32_t slotCount, uint32_t slotCapacity);
+
+    bool IsOpen() const { return memory != nullptr; }
+
+    uint32_t SlotCapacity() const;
+
+    PositionRecord *beginFrame();
+
+    void publish(uint32_t count);
+
+    ~PositionFeedWriter();
+};
+
+
+/**
+ * @class PositionFeedReader
+ * @brief Viewer side of the position feed: maps the segment read-only and copies frames out.
+ *
+ * The reader never writes to the shared memory and never blocks the producer. It
+ * copies the newest frame straight into a destination such as a mapped vertex
+ * buffer, and retries with the then newest frame if the producer overwrote the
+ * slot during the copy.
+ */
+class PositionFeedReader final {
+    const unsigned char *memory = nullptr;
+    size_t size = 0;
+    size_t slotStride = 0;
+
+    const PositionFeedHeader *header() const { return reinterpret_cast<const PositionFeedHeader *>(memory); }
+
+    const PositionFeedSlot *slot(uint64_t frameNumber) const;
+
+public:
+    static constexpr int MaxAttempts = 4;
+
+    explicit PositionFeedReader(const std::string &name);
+
+    bool IsOpen() const { return memory != nullptr; }
+
+    uint32_t SlotCapacity() const;
+
+    uint64_t PublishedFrame() const;
+
+    bool readLatest(PositionRecord *destination, uint64_t &frame, uint32_t &count) const;
+
+    ~PositionFeedReader();
+};
+
+
+#endif //POSITIONFEED_H
@@ -0,0 +1,114 @@
+#include "PositionStream.h"
+#include <iostream>
+
+
+/**
+ * Creates the two vertex arrays. Their buffers are sized once a feed is found.
+ *
+ * @param feedName POSIX shared memory name of the feed.
+ */
+PositionStream::PositionStream(const std::string &feedName) : feedName(feedName) {
+    glGenVertexArrays(2, vaos);
+    glGenBuffers(2, vbos);
+    for (int i = 0; i < 2; ++i) {
+        glBindVertexArray(vaos[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, vbos[i]);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(PositionRecord), nullptr);
+    }
+    glBindVertexArray(0);
+}
+
+
+/**
+ * Maps the feed and, if it holds more records per frame than the buffers do,
+ * grows both buffers. Keeps the current reader if the feed cannot be opened.
+ *
+ * @param time Current time in seconds.
+ */
+void PositionStream::connect(float time) {
+    lastAttempt = time;
+    auto *fresh = new PositionFeedReader(feedName);
+    if (!fresh->IsOpen()) {
+        delete fresh;
+        return;
+    }
+    if (reader == nullptr) std::cout << "Connected to position feed " << feedName << std::endl;
+    delete reader;
+    reader = fresh;
+    uploadedFrame = 0;
+    lastFrameTime = time;
+
+    if (reader->SlotCapacity() > capacity) {
+        capacity = reader->SlotCapacity();
+        for (int i = 0; i < 2; ++i) {
+            glBindBuffer(GL_ARRAY_BUFFER, vbos[i]);
+            glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(capacity) * sizeof(PositionRecord), nullptr,
+                         GL_STREAM_DRAW);
+        }
+        counts[0] = counts[1] = 0;
+    }
+}
+
+
+/**
+ * Uploads the newest frame of the feed if it has not been uploaded yet. Called
+ * on the render thread once per iteration of the render loop.
+ *
+ * @param time Current time in seconds.
+ * @return True if new positions were uploaded and the frame has to be redrawn.
+ */
+bool PositionStream::update(float time) {
+    bool quiet = reader == nullptr || time - lastFrameTime > StaleSeconds;
+    if (quiet && time - lastAttempt >= RetrySeconds) connect(time);
+    if (reader == nullptr) return false;
+
+    uint64_t published = reader->PublishedFrame();
+    if (published == 0 || published == uploadedFrame) return false;
+    lastFrameTime = time;
+
+    int back = 1 - front;
+    glBindBuffer(GL_ARRAY_BUFFER, vbos[back]);
+    void *destination = glMapBufferRange(GL_ARRAY_BUFFER, 0,
+                                         static_cast<GLsizeiptr>(capacity) * sizeof(PositionRecord),
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (destination == nullptr) return false;
+    uint64_t frame = 0;
+    uint32_t count = 0;
+    bool copied = reader->readLatest(static_cast<PositionRecord *>(destination), frame, count);
+    if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE || !copied) return false;
+
+    counts[back] = count;
+    front = back;
+    uploadedFrame = frame;
+    return true;
+}
+
+
+/**
+ * Draws the positions of the newest uploaded frame as points.
+ *
+ * @param prog   A `GEO_POSITION | FLAT_COLOR` program, already in use.
+ * @param camera The view to draw; every visible copy of the map is one instance.
+ * @param color  The color of the points.
+ */
+void PositionStream::DrawPositions(GPUProgram *prog, const Camera &camera, vec3 color) const {
+    if (counts[front] == 0) return;
+    prog->setUniform(color, "color");
+    int copies = camera.setUniforms(prog);
+    glPointSize(3.0f);
+    glBindVertexArray(vaos[front]);
+    glDrawArraysInstanced(GL_POINTS, 0, static_cast<int>(counts[front]), copies);
+    glBindVertexArray(0);
+}
+
+
+/**
+ * Destructor for the `PositionStream` class. Unmaps the feed and releases the
+ * vertex buffers and arrays.
+ */
+PositionStream::~PositionStream() {
+    delete reader;
+    glDeleteBuffers(2, vbos);
+    glDeleteVertexArrays(2, vaos);
+}
@@ -0,0 +1,53 @@
+#ifndef POSITIONSTREAM_H
+#define POSITIONSTREAM_H
+
+#include "framework.h"
+#include "PositionFeed.h"
+#include "Camera.h"
+
+
+/**
+ * @class PositionStream
+ * @brief Streams the frames of a shared memory position feed into vertex buffers.
+ *
+ * Two vertex buffers alternate: the newest frame is copied from the feed straight
+ * into the mapped back buffer, which becomes the drawn one only if the copy was
+ * consistent. A torn or failed copy therefore never reaches the screen; the
+ * previous frame is drawn instead. The records are uploaded unchanged, and the
+ * `GEO_POSITION` shader variant projects their latitude and longitude.
+ *
+ * The feed is looked up once per `RetrySeconds` until a producer creates it, and
+ * again when it has been quiet for `StaleSeconds`, so a restarted producer is
+ * picked up without restarting the viewer.
+ */
+class PositionStream final {
+    static constexpr float RetrySeconds = 1.0f;
+    static constexpr float StaleSeconds = 2.0f;
+
+    std::string feedName;
+    PositionFeedReader *reader = nullptr;
+    unsigned int vaos[2] = {0, 0};
+    unsigned int vbos[2] = {0, 0};
+    uint32_t counts[2] = {0, 0};
+    int front = 0;
+    uint32_t capacity = 0;
+    uint64_t uploadedFrame = 0;
+    float lastAttempt = -RetrySeconds;
+    float lastFrameTime = 0.0f;
+
+    void connect(float time);
+
+public:
+    explicit PositionStream(const std::string &feedName);
+
+    bool update(float time);
+
+    uint32_t Count() const { return counts[front]; }
+
+    void DrawPositions(GPUProgram *prog, const Camera &camera, vec3 color) const;
+
+    ~PositionStream();
+};
+
+
+#endif //POSITIONSTREAM_H
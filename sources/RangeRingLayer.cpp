@@ -0,0 +1,150 @@
+#include "RangeRingLayer.h"
+#include <algorithm>
+#include <cmath>
+
+
+/**
+ * Radius of the Earth in kilometers, for a circumference of 40000 km.
+ */
+static const double EarthRadius = 40000.0 / (2.0 * M_PI);
+
+
+/**
+ * Creates the ring of the points within a distance of a position.
+ *
+ * @param geo        The center in degrees.
+ * @param kilometers The great-circle distance from the center, up to `MaxRadius` radians.
+ */
+RangeRing RangeRing::around(const dvec2 &geo, double kilometers) {
+    dvec2 angles(glm::radians(geo.x), glm::radians(geo.y));
+    dvec3 center(std::cos(angles.x) * std::cos(angles.y), std::cos(angles.x) * std::sin(angles.y), std::sin(angles.x));
+    return {center, std::min(kilometers / EarthRadius, MaxRadius)};
+}
+
+
+/**
+ * Tells whether a point is within the ring, on it included: its angle to the
+ * center is at most the radius.
+ *
+ * @param point A unit vector.
+ */
+bool RangeRing::contains(const dvec3 &point) const {
+    return glm::dot(point, center) >= std::cos(radius);
+}
+
+
+/**
+ * Tells whether the ring encloses the pole of its center's hemisphere, so
+ * that it runs around the whole map.
+ */
+bool RangeRing::enclosesPole() const {
+    return std::abs(center.z) > std::cos(radius);
+}
+
+
+/**
+ * Returns the point of the ring at a fraction of the circle. The circle starts
+ * on the side facing the pole of the center's hemisphere.
+ *
+ * @param t From 0 to 1, where both ends are the same point.
+ */
+dvec3 RangeRing::pointAt(double t) const {
+    dvec3 pole(0.0, 0.0, center.z < 0.0 ? -1.0 : 1.0);
+    dvec3 towardsPole = pole - center * glm::dot(pole, center);
+    dvec3 u = glm::dot(towardsPole, towardsPole) > 1e-12 ? glm::normalize(towardsPole) : dvec3(1.0, 0.0, 0.0);
+    dvec3 v = glm::cross(center, u);
+    double angle = 2.0 * M_PI * t;
+    return center * std::cos(radius) + (u * std::cos(angle) + v * std::sin(angle)) * std::sin(radius);
+}
+
+
+/**
+ * Returns the normalized map x coordinate that the point of the ring at a
+ * fraction of the circle is moved near by whole map widths: the center for
+ * most rings. A ring around a pole starts on the opposite meridian, half a map
+ * away, and sweeps once across the map, so the reference sweeps with it.
+ *
+ * @param t From 0 to 1.
+ */
+double RangeRing::unwrapReference(double t) const {
+    double centerX = std::atan2(center.y, center.x) / M_PI;
+    if (!enclosesPole()) return centerX;
+    return centerX - (center.z < 0.0 ? -1.0 : 1.0) * (1.0 - 2.0 * t);
+}
+
+
+/**
+ * Creates the instance buffer and its vertex array. The divisors are set when
+ * drawing, since they depend on the number of world copies.
+ */
+RangeRingLayer::RangeRingLayer() {
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(RingInstance),
+                          reinterpret_cast<void *>(offsetof(RingInstance, center)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(RingInstance),
+                          reinterpret_cast<void *>(offsetof(RingInstance, radius)));
+    glBindVertexArray(0);
+}
+
+
+/**
+ * Adds a ring. It reaches the GPU with the next `commit`.
+ */
+void RangeRingLayer::addRing(const RangeRing &ring) {
+    rings.push_back({vec3(ring.center), static_cast<float>(ring.radius)});
+}
+
+
+/**
+ * Uploads the rings added since the last call, or all of them if they outgrew
+ * the buffer, which then grows to at least twice its size.
+ */
+void RangeRingLayer::commit() {
+    if (uploaded == rings.size()) return;
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (rings.size() > capacity) {
+        capacity = std::max({rings.size(), 2 * capacity, size_t(1024)});
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(capacity * sizeof(RingInstance)), nullptr,
+                     GL_DYNAMIC_DRAW);
+        uploaded = 0;
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(uploaded * sizeof(RingInstance)),
+                    static_cast<GLsizeiptr>((rings.size() - uploaded) * sizeof(RingInstance)), rings.data() + uploaded);
+    uploaded = rings.size();
+}
+
+
+/**
+ * Draws every ring. Rings reach up to half a map from their center, so the
+ * copies within that margin of the view are drawn too; each ring is one
+ * instance per copy.
+ *
+ * @param prog   A `RANGE_RING | FLAT_COLOR` program, already in use; `RANGE_RING | FLAT_COLOR | GLOBE` on the globe.
+ * @param camera The view to draw.
+ * @param color  The color of the rings.
+ */
+void RangeRingLayer::DrawRings(GPUProgram *prog, const Camera &camera, vec3 color) const {
+    if (uploaded == 0) return;
+    prog->setUniform(color, "color");
+    prog->setUniform(static_cast<float>(RingSegments), "ringSegments");
+    int copies = camera.setUniforms(prog, Camera::HalfWorld);
+    glLineWidth(2.0f);
+    glBindVertexArray(vao);
+    for (GLuint attribute: {0u, 1u}) glVertexAttribDivisor(attribute, copies);
+    glDrawArraysInstanced(GL_LINE_STRIP, 0, RingSegments + 1, static_cast<int>(uploaded) * copies);
+    glBindVertexArray(0);
+}
+
+
+/**
+ * Destructor for the `RangeRingLayer` class. Releases the buffer and the vertex array.
+ */
+RangeRingLayer::~RangeRingLayer() {
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+}
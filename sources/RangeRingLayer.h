@@ -0,0 +1,86 @@
+#ifndef RANGERINGLAYER_H
+#define RANGERINGLAYER_H
+
+#include "framework.h"
+#include "Camera.h"
+#include <vector>
+
+
+/**
+ * A geodesic range ring: the small circle of the points at the great-circle
+ * angle `radius` from `center`, bounding the area within that distance, such
+ * as the coverage of a depot.
+ *
+ * The `RANGE_RING` vertex shader generates the circle exactly like `pointAt`
+ * and unwraps it on the map like `unwrapReference`, and `contains` tests the
+ * area the same circle bounds, so queries on the CPU find what is drawn.
+ */
+struct RangeRing {
+    static constexpr double MaxRadius = 1.5;   // radians; below a quarter circle, a ring encloses at most one pole
+
+    dvec3 center;    // unit vector
+    double radius;   // radians
+
+    static RangeRing around(const dvec2 &geo, double kilometers);
+
+    bool contains(const dvec3 &point) const;
+
+    bool enclosesPole() const;
+
+    dvec3 pointAt(double t) const;
+
+    double unwrapReference(double t) const;
+};
+
+
+/**
+ * @class RangeRingLayer
+ * @brief Draws any number of range rings with one instanced draw call.
+ *
+ * A ring is a single instance of 16 bytes, its center and its radius; the
+ * `RANGE_RING` vertex shader turns `gl_VertexID` into the point of the ring
+ * at that fraction of the circle and projects it onto the map or the globe,
+ * so the points of the rings are never stored. Each ring is drawn as one line
+ * strip of `RingSegments` segments per world copy.
+ *
+ * On the map, the points of a ring are unwrapped near its center, so a ring
+ * across the antimeridian continues into the neighboring copy. A ring around
+ * a pole is no closed curve on the map but runs across the whole width of it;
+ * its points are unwrapped along the width instead, from half a map on one
+ * side of the center to half a map on the other, so that it joins up with the
+ * same ring of the neighboring copies.
+ *
+ * Rings are only ever added; each `commit` uploads the new ones.
+ */
+class RangeRingLayer final {
+public:
+    static constexpr int RingSegments = 128;
+
+private:
+    struct RingInstance {
+        vec3 center;
+        float radius;
+    };
+
+    std::vector<RingInstance> rings;
+    size_t uploaded = 0;
+    size_t capacity = 0;
+    unsigned int vao = 0;
+    unsigned int vbo = 0;
+
+public:
+    RangeRingLayer();
+
+    void addRing(const RangeRing &ring);
+
+    void commit();
+
+    size_t Count() const { return rings.size(); }
+
+    void DrawRings(GPUProgram *prog, const Camera &camera, vec3 color) const;
+
+    ~RangeRingLayer();
+};
+
+
+#endif //RANGERINGLAYER_H
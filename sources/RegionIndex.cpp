@@ -0,0 +1,202 @@
+#include "RegionIndex.h"
+#include "CoastlineMesh.h"
+#include <algorithm>
+
+
+/**
+ * Number of points one job of the worker pool classifies at least.
+ */
+static const size_t RegionGrain = 1024;
+
+
+/**
+ * Twice the signed area of the triangle (a, b, c); positive if counterclockwise.
+ */
+static inline float cross(const vec2 &a, const vec2 &b, const vec2 &c) {
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+
+/**
+ * Tells whether the segments pq and ab cross at a point inside both.
+ */
+static inline bool segmentsCross(const vec2 &p, const vec2 &q, const vec2 &a, const vec2 &b) {
+    return (cross(p, q, a) > 0.0f) != (cross(p, q, b) > 0.0f) && (cross(a, b, p) > 0.0f) != (cross(a, b, q) > 0.0f);
+}
+
+
+/**
+ * Position of the reference point within its cell, in cells. It is near the
+ * center, but off the round coordinates and simple slopes that polygon vertices
+ * tend to have, so that it practically never lies on an edge.
+ */
+static const float ReferenceX = 0.4871f;
+static const float ReferenceY = 0.5317f;
+
+
+/**
+ * Returns the reference point of a cell as (longitude, latitude).
+ */
+static inline vec2 cellCenter(int column, int row) {
+    return vec2(-180.0f + (static_cast<float>(column) + ReferenceX) / RegionIndex::CellsPerDegree,
+                -90.0f + (static_cast<float>(row) + ReferenceY) / RegionIndex::CellsPerDegree);
+}
+
+
+/**
+ * Reads the regions from a polygon file and builds the grid. A missing file
+ * leaves the index empty, so every point is outside.
+ *
+ * @param source The polygon file.
+ */
+RegionIndex::RegionIndex(const fs::path &source) {
+    std::vector<std::string> ringNames;
+    std::vector<std::vector<vec2>> rings;
+    CoastlineMesh::readPolygons(source, ringNames, rings);
+    for (size_t ring = 0; ring < rings.size(); ++ring) {
+        auto name = std::find(names.begin(), names.end(), ringNames[ring]);
+        auto region = static_cast<int>(name - names.begin());
+        if (name == names.end()) names.push_back(ringNames[ring]);
+        for (const std::vector<vec2> &piece: CoastlineMesh::splitAtAntimeridian(std::move(rings[ring]))) {
+            auto pieceIndex = static_cast<uint32_t>(pieceRegion.size());
+            pieceRegion.push_back(region);
+            for (size_t i = 0; i < piece.size(); ++i)
+                edges.push_back({piece[i], piece[(i + 1) % piece.size()], pieceIndex});
+        }
+    }
+    classifyCenters();
+    assignEdges();
+}
+
+
+/**
+ * Finds the piece containing each cell's reference point. Every row of them is a
+ * horizontal line; the edges crossing it are bucketed per row first, and the
+ * crossings of each piece, sorted along the line, delimit the spans inside it.
+ */
+void RegionIndex::classifyCenters() {
+    cellPiece.assign(static_cast<size_t>(Columns) * Rows, -1);
+    std::vector<std::vector<uint32_t>> rowEdges(Rows);
+    for (uint32_t i = 0; i < edges.size(); ++i) {
+        const Edge &edge = edges[i];
+        float low = std::min(edge.a.y, edge.b.y), high = std::max(edge.a.y, edge.b.y);
+        int first = std::max(0, static_cast<int>(std::ceil((low + 90.0f) * CellsPerDegree - ReferenceY)));
+        int last = std::min(Rows - 1, static_cast<int>(std::floor((high + 90.0f) * CellsPerDegree - ReferenceY)));
+        for (int row = first; row <= last; ++row) rowEdges[row].push_back(i);
+    }
+
+    std::vector<std::pair<uint32_t, float>> crossings;
+    for (int row = 0; row < Rows; ++row) {
+        float y = cellCenter(0, row).y;
+        crossings.clear();
+        for (uint32_t i: rowEdges[row]) {
+            const Edge &edge = edges[i];
+            if ((edge.a.y <= y) == (edge.b.y <= y)) continue;
+            float t = (y - edge.a.y) / (edge.b.y - edge.a.y);
+            crossings.emplace_back(edge.piece, edge.a.x + t * (edge.b.x - edge.a.x));
+        }
+        std::sort(crossings.begin(), crossings.end());
+        for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+            auto firstColumnAfter = [](float x) {
+                return static_cast<int>(std::ceil((x + 180.0f) * CellsPerDegree - ReferenceX));
+            };
+            int first = std::max(0, firstColumnAfter(crossings[i].second));
+            int last = std::min(Columns - 1, firstColumnAfter(crossings[i + 1].second) - 1);
+            for (int column = first; column <= last; ++column)
+                cellPiece[static_cast<size_t>(row) * Columns + column] = static_cast<int>(crossings[i].first);
+        }
+    }
+}
+
+
+/**
+ * Lists, for every cell, the edges whose bounding box overlaps it. This is a
+ * superset of the edges passing through the cell, which is all a lookup needs.
+ * The lists are stored back to back, counted in a first pass and filled in a
+ * second one.
+ */
+void RegionIndex::assignEdges() {
+    auto cellRange = [](const Edge &edge, int &column0, int &column1, int &row0, int &row1) {
+        auto toCell = [](float value, float offset, int count) {
+            return std::clamp(static_cast<int>(std::floor((value + offset) * CellsPerDegree)), 0, count - 1);
+        };
+        column0 = toCell(std::min(edge.a.x, edge.b.x), 180.0f, Columns);
+        column1 = toCell(std::max(edge.a.x, edge.b.x), 180.0f, Columns);
+        row0 = toCell(std::min(edge.a.y, edge.b.y), 90.0f, Rows);
+        row1 = toCell(std::max(edge.a.y, edge.b.y), 90.0f, Rows);
+    };
+
+    cellEdgeStart.assign(static_cast<size_t>(Columns) * Rows + 1, 0);
+    int column0, column1, row0, row1;
+    for (const Edge &edge: edges) {
+        cellRange(edge, column0, column1, row0, row1);
+        for (int row = row0; row <= row1; ++row)
+            for (int column = column0; column <= column1; ++column)
+                ++cellEdgeStart[static_cast<size_t>(row) * Columns + column + 1];
+    }
+    for (size_t cell = 1; cell < cellEdgeStart.size(); ++cell) cellEdgeStart[cell] += cellEdgeStart[cell - 1];
+
+    cellEdges.resize(cellEdgeStart.back());
+    std::vector<uint32_t> fill(cellEdgeStart.begin(), cellEdgeStart.end() - 1);
+    for (uint32_t i = 0; i < edges.size(); ++i) {
+        cellRange(edges[i], column0, column1, row0, row1);
+        for (int row = row0; row <= row1; ++row)
+            for (int column = column0; column <= column1; ++column)
+                cellEdges[fill[static_cast<size_t>(row) * Columns + column]++] = i;
+    }
+}
+
+
+/**
+ * Finds the region a point falls in.
+ *
+ * @param geo The point as (latitude, longitude) in degrees.
+ * @return Index of the region, or `Outside`.
+ */
+int RegionIndex::regionOf(const vec2 &geo) const {
+    vec2 point(geo.y - 360.0f * std::floor((geo.y + 180.0f) / 360.0f), std::clamp(geo.x, -90.0f, 90.0f));
+    int column = std::min(static_cast<int>((point.x + 180.0f) * CellsPerDegree), Columns - 1);
+    int row = std::min(static_cast<int>((point.y + 90.0f) * CellsPerDegree), Rows - 1);
+    size_t cell = static_cast<size_t>(row) * Columns + column;
+    int centerPiece = cellPiece[cell];
+    if (cellEdgeStart[cell] == cellEdgeStart[cell + 1])
+        return centerPiece < 0 ? Outside : pieceRegion[centerPiece];
+
+    // Pieces whose border lies an odd number of times between the point and the center.
+    vec2 center = cellCenter(column, row);
+    uint32_t crossed[16];
+    int crossedCount = 0;
+    for (uint32_t i = cellEdgeStart[cell]; i < cellEdgeStart[cell + 1]; ++i) {
+        const Edge &edge = edges[cellEdges[i]];
+        if (!segmentsCross(point, center, edge.a, edge.b)) continue;
+        uint32_t *found = std::find(crossed, crossed + crossedCount, edge.piece);
+        if (found != crossed + crossedCount) *found = crossed[--crossedCount];
+        else if (crossedCount < 16) crossed[crossedCount++] = edge.piece;
+    }
+    bool leftCenterPiece = centerPiece >= 0 &&
+                           std::find(crossed, crossed + crossedCount, static_cast<uint32_t>(centerPiece)) !=
+                           crossed + crossedCount;
+    if (centerPiece >= 0 && !leftCenterPiece) return pieceRegion[centerPiece];
+    for (int i = 0; i < crossedCount; ++i)
+        if (static_cast<int>(crossed[i]) != centerPiece) return pieceRegion[crossed[i]];
+    return Outside;
+}
+
+
+/**
+ * Classifies the points from `begin` on, split across the worker pool, and
+ * stores their regions at the same positions of `regions`.
+ *
+ * @param geo     The points as (latitude, longitude) in degrees.
+ * @param begin   First point to classify; the ones before keep their regions.
+ * @param regions Receives the regions; resized to the number of points.
+ * @param workers The pool the classification is split across.
+ */
+void RegionIndex::classify(const SharedColumn<dvec2> &geo, size_t begin, std::vector<int> &regions,
+                           WorkerPool &workers) const {
+    regions.resize(geo.size(), Outside);
+    if (begin >= geo.size()) return;
+    workers.parallelFor(geo.size() - begin, RegionGrain, [this, &geo, &regions, begin](size_t first, size_t last) {
+        for (size_t i = begin + first; i < begin + last; ++i) regions[i] = regionOf(vec2(geo[i]));
+    });
+}
@@ -0,0 +1,68 @@
+#ifndef REGIONINDEX_H
+#define REGIONINDEX_H
+
+#include "framework.h"
+#include "WorkerPool.h"
+#include "SharedColumn.h"
+#include <cstdint>
+
+
+/**
+ * @class RegionIndex
+ * @brief Finds the named polygon (country, service zone, ...) a geographic point falls in.
+ *
+ * The regions are read from a polygon file in the format of `CoastlineMesh`;
+ * rings with the same name form one region, and regions must not overlap. The
+ * rings are split at the antimeridian and indexed by a grid of `CellsPerDegree`
+ * cells per degree.
+ *
+ * Each cell records the polygon piece its reference point (near the center)
+ * lies in, found once for the whole grid by scanning every row of reference
+ * points, and the edges passing through it. Most cells have no edges, and
+ * every point in them belongs to the same region, so the lookup is a single
+ * array access. For the cells along borders, the segment from the point to the
+ * reference point is tested against the few
+ * edges of the cell: crossing a piece's border an odd number of times means
+ * the point and the reference point are on different sides of it.
+ *
+ * The index is immutable once built, so any number of threads may query it;
+ * `classify` splits a batch of points across the worker pool.
+ */
+class RegionIndex final {
+public:
+    static constexpr int CellsPerDegree = 1;
+    static constexpr int Columns = 360 * CellsPerDegree;
+    static constexpr int Rows = 180 * CellsPerDegree;
+    static constexpr int Outside = -1;
+
+private:
+    struct Edge {
+        vec2 a, b;       // (longitude, latitude)
+        uint32_t piece;
+    };
+
+    std::vector<std::string> names;
+    std::vector<int> pieceRegion;
+    std::vector<Edge> edges;
+    std::vector<int> cellPiece;           // piece containing the cell center, or -1
+    std::vector<uint32_t> cellEdgeStart;  // edges of cell i are cellEdges[start[i], start[i + 1])
+    std::vector<uint32_t> cellEdges;
+
+    void classifyCenters();
+
+    void assignEdges();
+
+public:
+    explicit RegionIndex(const fs::path &source);
+
+    size_t RegionCount() const { return names.size(); }
+
+    const std::string &Name(int region) const { return names[region]; }
+
+    int regionOf(const vec2 &geo) const;
+
+    void classify(const SharedColumn<dvec2> &geo, size_t begin, std::vector<int> &regions, WorkerPool &workers) const;
+};
+
+
+#endif //REGIONINDEX_H
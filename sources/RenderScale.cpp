@@ -0,0 +1,101 @@
+#include "RenderScale.h"
+
+
+/**
+ * Creates the timer queries. The scale starts at full resolution.
+ *
+ * @param frameBudget Time a frame may take in seconds.
+ */
+RenderScale::RenderScale(float frameBudget) : budget(frameBudget) {
+    for (Sample &sample: samples) glGenQueries(1, &sample.query);
+}
+
+
+/**
+ * Starts timing a frame. If every query is still waiting for its result, the
+ * frame is not timed.
+ */
+void RenderScale::beginFrame() {
+    timing = !samples[next].pending;
+    if (!timing) return;
+    glBeginQuery(GL_TIME_ELAPSED, samples[next].query);
+    cpuStart = Clock::now();
+}
+
+
+/**
+ * Stops timing the frame started by `beginFrame`.
+ *
+ * @param measured Whether the frame drew the map, i.e. whether its cost depends on the scale.
+ */
+void RenderScale::endFrame(bool measured) {
+    if (!timing) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    Sample &sample = samples[next];
+    sample.cpuSeconds = std::chrono::duration<float>(Clock::now() - cpuStart).count();
+    sample.measured = measured;
+    sample.pending = true;
+    sample.generation = generation;
+    next = (next + 1) % QueryCount;
+    timing = false;
+}
+
+
+/**
+ * Collects the frame times whose GPU queries have finished, oldest first,
+ * without waiting for the others, and adjusts the scale.
+ *
+ * @return True if the scale changed, so the map layer has to be resized.
+ */
+bool RenderScale::update() {
+    bool changed = false;
+    for (int i = 0; i < QueryCount; ++i) {
+        Sample &sample = samples[(next + i) % QueryCount];
+        if (!sample.pending) continue;
+        GLint available = 0;
+        glGetQueryObjectiv(sample.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(sample.query, GL_QUERY_RESULT, &nanoseconds);
+        sample.pending = false;
+        if (sample.measured && sample.generation == generation)
+            changed |= addSample(std::max(static_cast<float>(nanoseconds) * 1.0e-9f, sample.cpuSeconds));
+    }
+    return changed;
+}
+
+
+/**
+ * Adds the time of a frame at the current scale to the smoothed frame time, and
+ * moves the scale one step when it was over or under the budget long enough.
+ *
+ * @param seconds The longer of the GPU and the CPU time of the frame.
+ * @return True if the scale changed.
+ */
+bool RenderScale::addSample(float seconds) {
+    smoothed = smoothed < 0.0f ? seconds : smoothed + Smoothing * (seconds - smoothed);
+    if (smoothed > HighWater * budget) {
+        underBudget = 0;
+        if (++overBudget < FramesToLower || step == MinStep) return false;
+        --step;
+    } else if (smoothed < LowWater * budget) {
+        overBudget = 0;
+        if (++underBudget < FramesToRaise || step == Steps) return false;
+        ++step;
+    } else {
+        overBudget = underBudget = 0;
+        return false;
+    }
+    ++generation;
+    smoothed = -1.0f;
+    overBudget = underBudget = 0;
+    return true;
+}
+
+
+/**
+ * Destructor for the `RenderScale` class. Releases the timer queries.
+ */
+RenderScale::~RenderScale() {
+    for (Sample &sample: samples) glDeleteQueries(1, &sample.query);
+}
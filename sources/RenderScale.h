@@ -0,0 +1,78 @@
+#ifndef RENDERSCALE_H
+#define RENDERSCALE_H
+
+#include "framework.h"
+#include <chrono>
+
+
+/**
+ * @class RenderScale
+ * @brief Picks the resolution of the map layer from the measured frame time.
+ *
+ * Every frame is bracketed by `beginFrame` and `endFrame`, which time it both
+ * on the GPU, with a `GL_TIME_ELAPSED` query, and on the CPU; the longer of the
+ * two is the cost of the frame. The query results are collected a few frames
+ * later by `update` without stalling, and only frames that drew the map count,
+ * since the others would not get cheaper at a lower resolution.
+ *
+ * The scale moves in steps of 1/8 between 1/2 and 1 and has hysteresis: it goes
+ * down one step after the smoothed frame time stayed over the budget for a few
+ * frames, and up one step only after it stayed well under the budget for much
+ * longer. The low water mark is low enough that the next step up, which shades
+ * at most (5/4)^2 times the pixels, still fits the budget, so the scale does not
+ * oscillate between two steps. Frames issued before a change are ignored.
+ */
+class RenderScale final {
+public:
+    static constexpr int Steps = 8;          // the scale is a multiple of 1/Steps
+    static constexpr int MinStep = 4;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int QueryCount = 4;     // frames whose GPU time can be in flight
+    static constexpr float HighWater = 1.0f; // fractions of the budget
+    static constexpr float LowWater = 0.6f;
+    static constexpr int FramesToLower = 3;
+    static constexpr int FramesToRaise = 60;
+    static constexpr float Smoothing = 0.2f;
+
+    struct Sample {
+        unsigned int query = 0;
+        float cpuSeconds = 0.0f;
+        bool measured = false;
+        bool pending = false;
+        int generation = 0;
+    };
+
+    Sample samples[QueryCount];
+    int next = 0;
+    bool timing = false;
+    Clock::time_point cpuStart;
+    float budget;
+    int step = Steps;
+    int generation = 0;
+    float smoothed = -1.0f;
+    int overBudget = 0;
+    int underBudget = 0;
+
+    bool addSample(float seconds);
+
+public:
+    explicit RenderScale(float frameBudget);
+
+    void beginFrame();
+
+    void endFrame(bool measured);
+
+    bool update();
+
+    float Scale() const { return static_cast<float>(step) / Steps; }
+
+    int scaled(int size) const { return std::max(1, size * step / Steps); }
+
+    ~RenderScale();
+};
+
+
+#endif //RENDERSCALE_H
@@ -0,0 +1,234 @@
+#include "ShaderLibrary.h"
+#include "ViewUniforms.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+
+/**
+ * Names of the preprocessor symbols belonging to the bits of `ShaderFeature`,
+ * indexed by bit position.
+ */
+static const char *const featureDefines[] = {
+    "MAP_LIGHTING",
+    "FLAT_COLOR",
+    "INSTANCED_MARKER",
+    "SDF_TEXT",
+    "GEO_POSITION",
+    "SPHERE_POSITION",
+    "GREAT_CIRCLE",
+    "TIMELINE",
+    "SPLIT_POSITION",
+    "GLOBE",
+    "OBJECT_STATE",
+    "RANGE_RING",
+};
+
+
+/**
+ * Constructs a shader library over one vertex and one fragment uber-shader.
+ * No program is compiled until a variant is requested.
+ *
+ * @param vertexSource   GLSL source of the vertex stage, starting with `#version`.
+ * @param fragmentSource GLSL source of the fragment stage, starting with `#version`.
+ */
+ShaderLibrary::ShaderLibrary(const std::string &vertexSource, const std::string &fragmentSource)
+    : vertexSource(vertexSource), fragmentSource(fragmentSource) {
+}
+
+
+/**
+ * Constructs a shader library over uber-shaders stored in files. The files are
+ * read once here; `recompile` reads them again when they change on disk.
+ *
+ * @param vertexFile   Path of the vertex stage source.
+ * @param fragmentFile Path of the fragment stage source.
+ */
+ShaderLibrary::ShaderLibrary(const fs::path &vertexFile, const fs::path &fragmentFile)
+    : vertexFile(vertexFile), fragmentFile(fragmentFile) {
+    if (!readFile(vertexFile, vertexSource) || !readFile(fragmentFile, fragmentSource))
+        std::cerr << "Cannot read shader sources from " << vertexFile.parent_path() << std::endl;
+}
+
+
+/**
+ * Produces the source of one permutation by inserting a `#define` for every
+ * enabled feature directly after the `#version` directive, which GLSL requires
+ * to stay the first statement of the shader.
+ *
+ * @param source   The uber-shader source.
+ * @param features Bit mask of `ShaderFeature` values.
+ *
+ * @return The specialized shader source.
+ */
+std::string ShaderLibrary::specialize(const std::string &source, unsigned int features) {
+    std::string defines;
+    for (unsigned int bit = 0; bit < sizeof(featureDefines) / sizeof(featureDefines[0]); ++bit)
+        if (features & (1u << bit))
+            defines += std::string("#define ") + featureDefines[bit] + "\n";
+
+    size_t versionLine = source.find("#version");
+    size_t insertAt = versionLine == std::string::npos ? 0 : source.find('\n', versionLine);
+    insertAt = insertAt == std::string::npos ? source.size() : insertAt + 1;
+
+    std::string specialized = source;
+    specialized.insert(insertAt, defines);
+    return specialized;
+}
+
+
+/**
+ * Reads a whole text file.
+ *
+ * @param file     Path of the file.
+ * @param contents Receives the contents of the file.
+ *
+ * @return False if the file cannot be opened.
+ */
+bool ShaderLibrary::readFile(const fs::path &file, std::string &contents) {
+    std::ifstream stream(file);
+    if (!stream.is_open()) return false;
+    std::stringstream buffer;
+    buffer << stream.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+
+/**
+ * Compiles and links one permutation, and connects its `View` uniform block to
+ * the binding point of the view uniform buffers.
+ *
+ * @param vertexSource   The vertex uber-shader source.
+ * @param fragmentSource The fragment uber-shader source.
+ * @param features       Bit mask of `ShaderFeature` values.
+ * @param waitOnError    Whether a compile error should block until a key is pressed.
+ *
+ * @return The linked program, or nullptr if compilation or linking failed.
+ */
+GPUProgram *ShaderLibrary::compileVariant(const std::string &vertexSource, const std::string &fragmentSource,
+                                          unsigned int features, bool waitOnError) {
+    std::string vertex = specialize(vertexSource, features);
+    std::string fragment = specialize(fragmentSource, features);
+    auto *program = new GPUProgram();
+    program->setWaitError(waitOnError);
+    if (!program->create(vertex.c_str(), fragment.c_str())) {
+        delete program;
+        return nullptr;
+    }
+    program->setUniformBlock("View", ViewUniforms::Binding);
+    return program;
+}
+
+
+/**
+ * Returns the program compiled for the given feature combination, compiling
+ * and caching it on the first request. Must be called on the render thread.
+ *
+ * A variant may first be requested in the middle of a session, so a compile
+ * error never waits for a key press here: the error is printed and the variant
+ * is an empty program, which draws nothing, until a reload fixes it.
+ *
+ * @param features Bit mask of `ShaderFeature` values.
+ *
+ * @return The cached GPU program of the permutation.
+ */
+GPUProgram *ShaderLibrary::variant(unsigned int features) {
+    auto cached = variants.find(features);
+    if (cached != variants.end()) return cached->second;
+
+    GPUProgram *program = compileVariant(vertexSource, fragmentSource, features, false);
+    if (program == nullptr) program = new GPUProgram();
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    variants[features] = program;
+    return program;
+}
+
+
+/**
+ * Rebuilds every cached variant from the current contents of the shader files.
+ * Intended to run on a background thread whose shared context is current; the
+ * render thread keeps drawing with the old programs meanwhile.
+ *
+ * The programs are published for `applyReload` only if all of them compiled
+ * and linked, so a typo in the source never replaces a working program.
+ *
+ * @return True if new programs are waiting to be applied.
+ */
+bool ShaderLibrary::recompile() {
+    std::string vertex, fragment;
+    if (!readFile(vertexFile, vertex) || !readFile(fragmentFile, fragment)) return false;
+
+    std::vector<unsigned int> keys;
+    {
+        std::lock_guard<std::mutex> lock(reloadMutex);
+        for (auto &entry: variants) keys.push_back(entry.first);
+    }
+
+    std::unordered_map<unsigned int, GPUProgram *> programs;
+    bool success = true;
+    for (unsigned int key: keys) {
+        GPUProgram *program = compileVariant(vertex, fragment, key, false);
+        if (program == nullptr) {
+            success = false;
+            break;
+        }
+        programs[key] = program;
+    }
+
+    if (!success) {
+        for (auto &entry: programs) delete entry.second;
+        std::cerr << "Shader reload failed, keeping the previous programs" << std::endl;
+        return false;
+    }
+
+    // The programs must be complete before another context may use them
+    glFinish();
+
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    for (auto &entry: reloaded) delete entry.second;
+    reloaded = std::move(programs);
+    reloadedVertexSource = std::move(vertex);
+    reloadedFragmentSource = std::move(fragment);
+    reloadReady = true;
+    return true;
+}
+
+
+/**
+ * Swaps the programs produced by the last successful `recompile` in for the
+ * cached variants, deleting the old ones. Called on the render thread between
+ * frames, so a frame is always drawn with one consistent set of programs.
+ *
+ * @return True if the variants were replaced and the frame has to be redrawn.
+ */
+bool ShaderLibrary::applyReload() {
+    if (!reloadReady.load()) return false;
+
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    for (auto &entry: reloaded) {
+        auto current = variants.find(entry.first);
+        if (current != variants.end()) {
+            delete current->second;
+            current->second = entry.second;
+        } else {
+            variants[entry.first] = entry.second;
+        }
+    }
+    reloaded.clear();
+    vertexSource = std::move(reloadedVertexSource);
+    fragmentSource = std::move(reloadedFragmentSource);
+    reloadReady = false;
+    std::cout << "Shaders reloaded" << std::endl;
+    return true;
+}
+
+
+/**
+ * Destructor for the `ShaderLibrary` class. Deletes every compiled variant,
+ * including reloaded programs that were never applied.
+ */
+ShaderLibrary::~ShaderLibrary() {
+    for (auto &entry: variants) delete entry.second;
+    for (auto &entry: reloaded) delete entry.second;
+}
@@ -0,0 +1,85 @@
+#ifndef SHADERLIBRARY_H
+#define SHADERLIBRARY_H
+
+#include "framework.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+/**
+ * Feature flags selecting a shader permutation. Each flag is turned into a
+ * `#define` of the same name (without the `SHADER_` prefix) that is inserted
+ * after the `#version` line of both shader stages.
+ */
+enum ShaderFeature : unsigned int {
+    SHADER_MAP_LIGHTING = 1u << 0,     // textured map with day/night lighting
+    SHADER_FLAT_COLOR = 1u << 1,       // single uniform color
+    SHADER_INSTANCED_MARKER = 1u << 2, // instanced icon quads from the marker atlas, per-instance color and style
+    SHADER_SDF_TEXT = 1u << 3,         // instanced glyph quads from the SDF atlas
+    SHADER_GEO_POSITION = 1u << 4,     // positions in degrees, projected in the vertex stage
+    SHADER_SPHERE_POSITION = 1u << 5,  // positions as unit vectors on the globe, projected in the vertex stage
+    SHADER_GREAT_CIRCLE = 1u << 6,     // instanced arcs between two unit vectors, generated in the vertex stage
+    SHADER_TIMELINE = 1u << 7,         // per-vertex lifetime, hidden outside it at the timeline time
+    SHADER_SPLIT_POSITION = 1u << 8,   // double precision map positions as high/low float pairs
+    SHADER_GLOBE = 1u << 9,            // orthographic globe instead of the map, far side clipped
+    SHADER_OBJECT_STATE = 1u << 10,    // per-instance selected/hovered/dimmed flags shading the color
+    SHADER_RANGE_RING = 1u << 11,      // instanced small circles around a unit vector, generated in the vertex stage
+};
+
+
+/**
+ * @class ShaderLibrary
+ * @brief Compiles and caches specialized variants of one uber-shader source.
+ *
+ * Instead of branching on uniforms in the fragment shader, every combination of
+ * features is compiled into its own program, with the unused code paths removed
+ * by the preprocessor. Variants are compiled on first request and cached by their
+ * feature mask, so selecting one at draw time is a single hash lookup.
+ *
+ * When the library is created from files, `recompile` can rebuild every cached
+ * variant from the current file contents on a background thread with a shared
+ * context. The new programs are only swapped in by `applyReload` on the render
+ * thread, all at once, and only if every variant compiled and linked.
+ */
+class ShaderLibrary final {
+    fs::path vertexFile;
+    fs::path fragmentFile;
+    std::string vertexSource;
+    std::string fragmentSource;
+    std::unordered_map<unsigned int, GPUProgram *> variants;
+
+    std::mutex reloadMutex;
+    std::unordered_map<unsigned int, GPUProgram *> reloaded;
+    std::string reloadedVertexSource;
+    std::string reloadedFragmentSource;
+    std::atomic<bool> reloadReady{false};
+
+    static std::string specialize(const std::string &source, unsigned int features);
+
+    static bool readFile(const fs::path &file, std::string &contents);
+
+    static GPUProgram *compileVariant(const std::string &vertexSource, const std::string &fragmentSource,
+                                      unsigned int features, bool waitOnError);
+
+public:
+    ShaderLibrary(const std::string &vertexSource, const std::string &fragmentSource);
+
+    ShaderLibrary(const fs::path &vertexFile, const fs::path &fragmentFile);
+
+    const fs::path &VertexFile() const { return vertexFile; }
+
+    const fs::path &FragmentFile() const { return fragmentFile; }
+
+    GPUProgram *variant(unsigned int features);
+
+    bool recompile();
+
+    bool applyReload();
+
+    ~ShaderLibrary();
+};
+
+
+#endif //SHADERLIBRARY_H
@@ -0,0 +1,101 @@
+#include "ShaderWatcher.h"
+#include <chrono>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * Starts watching the directory of the library's shader files. Must be called
+ * on the thread owning the window's context, because the hidden shared context is
+ * created here (by the main thread, on behalf of a render thread); the context is
+ * then made current on the watcher thread.
+ *
+ * @param library A library created from files. Libraries built from strings
+ *                have nothing to watch and are ignored.
+ */
+ShaderWatcher::ShaderWatcher(ShaderLibrary *library) : library(library) {
+#ifdef __linux__
+    if (library->VertexFile().empty()) return;
+
+    fs::path directory = library->VertexFile().parent_path();
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0 || inotify_add_watch(inotifyFd, directory.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << "Cannot watch " << directory << ", shader hot reload is disabled" << std::endl;
+        return;
+    }
+
+    context = createSharedContext();
+    if (context == nullptr) {
+        std::cerr << "Cannot create a shared context, shader hot reload is disabled" << std::endl;
+        return;
+    }
+
+    running = true;
+    worker = std::thread(&ShaderWatcher::watch, this);
+#else
+    std::cerr << "Shader hot reload needs inotify and is disabled on this platform" << std::endl;
+#endif
+}
+
+
+/**
+ * Body of the watcher thread. Waits for inotify events naming one of the shader
+ * files and recompiles the library once the files have been quiet for a short
+ * while, so an editor writing a file in several steps triggers a single rebuild.
+ */
+void ShaderWatcher::watch() {
+#ifdef __linux__
+    makeContextCurrent(context);
+
+    const std::string vertexName = library->VertexFile().filename().string();
+    const std::string fragmentName = library->FragmentFile().filename().string();
+    const auto settleTime = std::chrono::milliseconds(100);
+    bool changed = false;
+    auto lastChange = std::chrono::steady_clock::now();
+    alignas(inotify_event) char buffer[4096];
+
+    while (running) {
+        pollfd descriptor = {inotifyFd, POLLIN, 0};
+        if (poll(&descriptor, 1, changed ? 20 : 200) > 0) {
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (char *p = buffer; p < buffer + length;) {
+                    auto *event = reinterpret_cast<inotify_event *>(p);
+                    if (event->len > 0 && (vertexName == event->name || fragmentName == event->name)) {
+                        changed = true;
+                        lastChange = std::chrono::steady_clock::now();
+                    }
+                    p += sizeof(inotify_event) + event->len;
+                }
+            }
+        }
+
+        if (changed && std::chrono::steady_clock::now() - lastChange >= settleTime) {
+            changed = false;
+            library->recompile();
+        }
+    }
+
+    makeContextCurrent(nullptr);
+#endif
+}
+
+
+/**
+ * Destructor for the `ShaderWatcher` class. Stops the watcher thread, has the
+ * main thread destroy the shared context, and closes the inotify instance. Call
+ * it on the render thread before the window is destroyed.
+ */
+ShaderWatcher::~ShaderWatcher() {
+    running = false;
+    if (worker.joinable()) worker.join();
+    destroySharedContext(context);
+#ifdef __linux__
+    if (inotifyFd >= 0) close(inotifyFd);
+#endif
+}
@@ -0,0 +1,37 @@
+#ifndef SHADERWATCHER_H
+#define SHADERWATCHER_H
+
+#include "ShaderLibrary.h"
+#include <atomic>
+#include <thread>
+
+
+/**
+ * @class ShaderWatcher
+ * @brief Recompiles a file-based ShaderLibrary in the background when its sources change.
+ *
+ * The watcher observes the directory of the shader files with inotify and, after
+ * a write or an atomic rename of one of them, calls `ShaderLibrary::recompile` on
+ * its own thread. That thread owns a hidden context sharing objects with the
+ * window, so compiling and linking never stalls the frame loop. The render thread
+ * picks the result up with `ShaderLibrary::applyReload`.
+ *
+ * On platforms without inotify the watcher does nothing.
+ */
+class ShaderWatcher final {
+    ShaderLibrary *library;
+    void *context = nullptr;
+    int inotifyFd = -1;
+    std::atomic<bool> running{false};
+    std::thread worker;
+
+    void watch();
+
+public:
+    ShaderWatcher(ShaderLibrary *library);
+
+    ~ShaderWatcher();
+};
+
+
+#endif //SHADERWATCHER_H
@@ -0,0 +1,107 @@
+#ifndef SHAREDCOLUMN_H
+#define SHAREDCOLUMN_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+/**
+ * @class SharedColumn
+ * @brief A growable array whose copies share its elements in `ChunkSize` chunks, copied on write.
+ *
+ * Copying a column copies its table of chunk pointers, not the elements, so
+ * handing a large column to another thread costs one pointer per chunk. The
+ * owner keeps changing its column meanwhile: `push_back` and `mutate` first
+ * copy the one chunk they write to if any copy still shares it, so a copy
+ * never sees a change, and a change costs at most one chunk however large the
+ * column is. The chunks of a copy are immutable, so any number of threads may
+ * read it.
+ *
+ * Every change also increments a revision shared by the copies made since, so
+ * `copyTo` skips copies that are already up to date: republishing a scene in
+ * which only the camera or the timeline time changed copies no column at all.
+ *
+ * A column and its copies may live on different threads. Only the column the
+ * copies were made from is changed, by the thread that owns it; the copies are
+ * read-only.
+ *
+ * @tparam T The element type; must be copyable.
+ */
+template<typename T>
+class SharedColumn final {
+public:
+    static constexpr size_t ChunkSize = 4096;
+
+private:
+    using Chunk = std::vector<T>;
+
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    size_t count = 0;
+    uint64_t revision = 0;
+
+    /**
+     * Returns a chunk for writing, first copying it if another column shares it.
+     * Seeing itself as the only owner, the writer synchronizes with the reader
+     * that released the chunk last, so none of its reads overlaps the write.
+     */
+    Chunk &unshare(size_t chunk) {
+        std::shared_ptr<Chunk> &pointer = chunks[chunk];
+        if (pointer.use_count() == 1)
+            std::atomic_thread_fence(std::memory_order_acquire);
+        else
+            pointer = std::make_shared<Chunk>(*pointer);
+        return *pointer;
+    }
+
+public:
+    size_t size() const { return count; }
+
+    bool empty() const { return count == 0; }
+
+    const T &operator[](size_t index) const { return (*chunks[index / ChunkSize])[index % ChunkSize]; }
+
+    const T &back() const { return (*this)[count - 1]; }
+
+    /**
+     * Appends an element, copying the last chunk first if it is shared.
+     *
+     * @param value The element.
+     */
+    void push_back(const T &value) {
+        if (count % ChunkSize == 0) {
+            chunks.push_back(std::make_shared<Chunk>());
+            chunks.back()->reserve(ChunkSize);
+        }
+        unshare(count / ChunkSize).push_back(value);
+        ++count;
+        ++revision;
+    }
+
+    /**
+     * Returns an element for writing, copying its chunk first if it is shared.
+     * Copies made before this call keep the old value; the reference is valid
+     * until the next change or copy of the column.
+     *
+     * @param index Index of the element.
+     */
+    T &mutate(size_t index) {
+        ++revision;
+        return unshare(index / ChunkSize)[index % ChunkSize];
+    }
+
+    /**
+     * Makes another column a copy of this one, unless it is one already.
+     *
+     * @param copy The column to overwrite.
+     */
+    void copyTo(SharedColumn &copy) const {
+        if (copy.revision == revision) return;
+        copy = *this;
+    }
+};
+
+
+#endif //SHAREDCOLUMN_H
@@ -0,0 +1,68 @@
+#ifndef SNAPSHOTEXCHANGE_H
+#define SNAPSHOTEXCHANGE_H
+
+#include <atomic>
+
+
+/**
+ * @class SnapshotExchange
+ * @brief Lock-free handoff of immutable snapshots from one producer thread to one consumer thread.
+ *
+ * The consumer draws from its front snapshot while the producer fills its back
+ * snapshot; neither is ever touched by the other thread. `publish` trades the
+ * back snapshot for a third, spare one through a single atomic exchange, and
+ * `acquire` trades the front snapshot for the published one the same way, so
+ * neither side ever waits for the other. If the producer publishes faster than
+ * the consumer acquires, the consumer skips to the newest snapshot.
+ *
+ * Snapshots are stored by value and recycled: `Back()` returns a slot holding
+ * an older snapshot, which the producer must overwrite completely before
+ * publishing. Assigning into it reuses the capacity of its containers, so a
+ * steady stream of snapshots does not allocate.
+ *
+ * @tparam T The snapshot type; must be default constructible and assignable.
+ */
+template<typename T>
+class SnapshotExchange final {
+    static constexpr unsigned int Fresh = 4;   // set on the spare index while it holds an unread snapshot
+
+    T slots[3];
+    unsigned int backIndex = 0;               // producer only
+    std::atomic<unsigned int> spareIndex{1};
+    unsigned int frontIndex = 2;              // consumer only
+
+    static_assert(std::atomic<unsigned int>::is_always_lock_free, "the handoff must be lock-free");
+
+public:
+    /**
+     * Returns the snapshot being built by the producer.
+     */
+    T &Back() { return slots[backIndex]; }
+
+    /**
+     * Hands the back snapshot over to the consumer. Producer thread only.
+     */
+    void publish() {
+        backIndex = spareIndex.exchange(backIndex | Fresh, std::memory_order_acq_rel) & ~Fresh;
+    }
+
+    /**
+     * Makes the newest published snapshot the front one, if there is one the
+     * consumer has not seen yet. Consumer thread only.
+     *
+     * @return True if the front snapshot changed.
+     */
+    bool acquire() {
+        if ((spareIndex.load(std::memory_order_relaxed) & Fresh) == 0) return false;
+        frontIndex = spareIndex.exchange(frontIndex, std::memory_order_acq_rel) & ~Fresh;
+        return true;
+    }
+
+    /**
+     * Returns the snapshot the consumer currently draws from.
+     */
+    const T &Front() const { return slots[frontIndex]; }
+};
+
+
+#endif //SNAPSHOTEXCHANGE_H
@@ -0,0 +1,490 @@
+#include "SoftwareRasterizer.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SOFTWARE_RASTERIZER_SSE
+#endif
+
+
+/**
+ * Packs a color into an RGBA8 pixel, rounding like the conversion of a
+ * fragment color into an 8-bit framebuffer.
+ */
+static uint32_t packColor(const vec3 &color) {
+    auto channel = [](float value) {
+        return static_cast<uint32_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+    };
+    return channel(color.x) | channel(color.y) << 8 | channel(color.z) << 16 | 0xff000000u;
+}
+
+
+/**
+ * Creates the color buffer and the tile grid covering it.
+ *
+ * @param width  Width of the image in pixels.
+ * @param height Height of the image in pixels.
+ */
+SoftwareRasterizer::SoftwareRasterizer(int width, int height)
+    : width(width), height(height), tilesX((width + TileSize - 1) / TileSize),
+      tilesY((height + TileSize - 1) / TileSize), pixels(static_cast<size_t>(width) * height),
+      bins(static_cast<size_t>(tilesX) * tilesY) {
+}
+
+
+/**
+ * Starts a new frame that `render` fills with a color before drawing anything,
+ * and drops the primitives of the previous frame.
+ *
+ * @param color The background color.
+ */
+void SoftwareRasterizer::clear(const vec3 &color) {
+    clearColor = packColor(color);
+    styles.clear();
+    maps.clear();
+    primitives.clear();
+    for (auto &tileBin: bins) tileBin.clear();
+}
+
+
+/**
+ * Transforms a map position into window coordinates, like the vertex shader does
+ * for one world copy.
+ *
+ * @param mapPosition Position on the normalized map.
+ * @param camera      The view.
+ * @param copy        Index of the world copy; copy k is shifted by 2k.
+ * @return The position in pixels from the bottom left corner.
+ */
+dvec2 SoftwareRasterizer::toWindow(const dvec2 &mapPosition, const Camera &camera, int copy) const {
+    dvec2 ndc = (mapPosition - camera.Center() + dvec2(2.0 * copy, 0.0)) * camera.Zoom();
+    return dvec2((ndc.x + 1.0) * 0.5 * width, (ndc.y + 1.0) * 0.5 * height);
+}
+
+
+/**
+ * Adds a primitive to the frame and to the bins of the tiles its bounding box
+ * overlaps. Primitives entirely outside the window are dropped.
+ *
+ * @param primitive The primitive, in window coordinates.
+ * @param low       Lower left corner of its bounding box in pixels.
+ * @param high      Upper right corner of its bounding box in pixels.
+ */
+void SoftwareRasterizer::bin(const Primitive &primitive, const dvec2 &low, const dvec2 &high) {
+    if (high.x < 0.0 || high.y < 0.0 || low.x > width || low.y > height) return;
+    int tx0 = static_cast<int>(std::max(low.x, 0.0)) / TileSize;
+    int ty0 = static_cast<int>(std::max(low.y, 0.0)) / TileSize;
+    int tx1 = std::min(tilesX - 1, static_cast<int>(std::min(high.x, static_cast<double>(width))) / TileSize);
+    int ty1 = std::min(tilesY - 1, static_cast<int>(std::min(high.y, static_cast<double>(height))) / TileSize);
+    uint32_t index = static_cast<uint32_t>(primitives.size());
+    primitives.push_back(primitive);
+    for (int ty = ty0; ty <= ty1; ++ty)
+        for (int tx = tx0; tx <= tx1; ++tx)
+            bins[ty * tilesX + tx].push_back(index);
+}
+
+
+/**
+ * Draws the textured map, lit by the sun, over every copy in view. The texture
+ * is sampled at the nearest texel, like the GL map texture.
+ *
+ * @param camera        The view; only the flat map is supported.
+ * @param texels        Colors of the map texture, rows from the bottom.
+ * @param textureWidth  Width of the texture in texels.
+ * @param textureHeight Height of the texture in texels.
+ * @param hourOffset    The hour offset of the day-night shading.
+ */
+void SoftwareRasterizer::drawMap(const Camera &camera, const std::vector<vec3> &texels, int textureWidth,
+                                 int textureHeight, float hourOffset) {
+    MapLayer map;
+    map.textureWidth = textureWidth;
+    map.textureHeight = textureHeight;
+    for (const vec3 &texel: texels) {
+        map.lit.push_back(packColor(texel));
+        map.dimmed.push_back(packColor(texel * 0.5f));
+    }
+    map.center = camera.Center();
+    map.zoom = camera.Zoom();
+    map.sunLongitude = 180.0f - hourOffset * 15.0f;
+
+    Primitive primitive{Shape::Map, static_cast<uint32_t>(maps.size())};
+    maps.push_back(std::move(map));
+    bin(primitive, dvec2(0.0, toWindow(dvec2(0.0, -1.0), camera, 0).y),
+        dvec2(width, toWindow(dvec2(0.0, 1.0), camera, 0).y));
+}
+
+
+/**
+ * Draws triangles blended over the image with a constant opacity, like the land
+ * layer, in every copy of the map in view.
+ *
+ * @param camera   The view.
+ * @param vertices Map positions of the vertices.
+ * @param indices  Three vertex indices per triangle.
+ * @param color    The color of the triangles.
+ * @param opacity  Weight of the color against the image below.
+ */
+void SoftwareRasterizer::drawTriangles(const Camera &camera, const std::vector<dvec2> &vertices,
+                                       const std::vector<uint32_t> &indices, const vec3 &color, float opacity) {
+    uint32_t style = static_cast<uint32_t>(styles.size());
+    styles.push_back({color, opacity, 0.0f});
+    int first, count;
+    camera.worldCopies(0.0f, first, count);
+    for (int copy = first; copy < first + count; ++copy) {
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            Primitive primitive{Shape::Triangle, style};
+            for (int corner = 0; corner < 3; ++corner)
+                primitive.vertices[corner] = toWindow(vertices[indices[i + corner]], camera, copy);
+            const dvec2 *v = primitive.vertices;
+            bin(primitive, dvec2(std::min({v[0].x, v[1].x, v[2].x}), std::min({v[0].y, v[1].y, v[2].y})),
+                dvec2(std::max({v[0].x, v[1].x, v[2].x}), std::max({v[0].y, v[1].y, v[2].y})));
+        }
+    }
+}
+
+
+/**
+ * Draws line strips of equal length, like the great-circle arcs of the paths.
+ * Strips may reach half a map beyond their copy, so the copies within that
+ * margin are drawn too. Segments are clipped to the window before they are
+ * binned, so arcs far outside it at deep zoom cost nothing.
+ *
+ * @param camera      The view.
+ * @param vertices    Map positions of the points of all strips, one strip after the other.
+ * @param stripLength Number of points per strip.
+ * @param color       The color of the lines.
+ * @param lineWidth   Width of the lines in pixels.
+ */
+void SoftwareRasterizer::drawLineStrips(const Camera &camera, const std::vector<dvec2> &vertices, int stripLength,
+                                        const vec3 &color, float lineWidth) {
+    uint32_t style = static_cast<uint32_t>(styles.size());
+    styles.push_back({color, 1.0f, lineWidth});
+    double margin = lineWidth;
+    int first, count;
+    camera.worldCopies(Camera::HalfWorld, first, count);
+    for (int copy = first; copy < first + count; ++copy) {
+        for (size_t strip = 0; strip + stripLength <= vertices.size(); strip += stripLength) {
+            dvec2 previous = toWindow(vertices[strip], camera, copy);
+            for (int i = 1; i < stripLength; ++i) {
+                dvec2 next = toWindow(vertices[strip + i], camera, copy);
+                // Liang-Barsky clipping to the window grown by the line width
+                dvec2 delta = next - previous;
+                double enter = 0.0, leave = 1.0;
+                double p[4] = {-delta.x, delta.x, -delta.y, delta.y};
+                double q[4] = {previous.x + margin, width + margin - previous.x,
+                               previous.y + margin, height + margin - previous.y};
+                bool visible = true;
+                for (int side = 0; side < 4 && visible; ++side) {
+                    if (p[side] == 0.0) {
+                        visible = q[side] >= 0.0;
+                    } else {
+                        double t = q[side] / p[side];
+                        if (p[side] < 0.0) enter = std::max(enter, t);
+                        else leave = std::min(leave, t);
+                        visible = enter <= leave;
+                    }
+                }
+                if (visible) {
+                    Primitive primitive{Shape::Segment, style, {previous + delta * enter, previous + delta * leave}};
+                    const dvec2 *v = primitive.vertices;
+                    dvec2 reach(lineWidth * 0.5 + 1.0, lineWidth * 0.5 + 1.0);
+                    bin(primitive, glm::min(v[0], v[1]) - reach, glm::max(v[0], v[1]) + reach);
+                }
+                previous = next;
+            }
+        }
+    }
+}
+
+
+/**
+ * Draws square points, like the stations, in every copy of the map in view.
+ *
+ * @param camera    The view.
+ * @param positions Map positions of the points.
+ * @param color     The color of the points.
+ * @param pointSize Side of the squares in pixels.
+ */
+void SoftwareRasterizer::drawPoints(const Camera &camera, const std::vector<dvec2> &positions, const vec3 &color,
+                                    float pointSize) {
+    uint32_t style = static_cast<uint32_t>(styles.size());
+    styles.push_back({color, 1.0f, pointSize});
+    dvec2 half(pointSize * 0.5, pointSize * 0.5);
+    int first, count;
+    camera.worldCopies(0.0f, first, count);
+    for (int copy = first; copy < first + count; ++copy) {
+        for (const dvec2 &position: positions) {
+            Primitive primitive{Shape::Point, style, {toWindow(position, camera, copy)}};
+            bin(primitive, primitive.vertices[0] - half, primitive.vertices[0] + half);
+        }
+    }
+}
+
+
+/**
+ * Draws the frame: every tile is cleared and its primitives are drawn in order,
+ * the tiles in parallel on the workers and the calling thread. Can be called
+ * again to draw the same frame.
+ *
+ * @param workers The pool to draw on.
+ */
+void SoftwareRasterizer::render(WorkerPool &workers) {
+    workers.parallelFor(bins.size(), 1, [this](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; ++tile) renderTile(static_cast<int>(tile));
+    });
+}
+
+
+/**
+ * Clears one tile and draws the primitives binned to it.
+ *
+ * @param tile Index of the tile, row by row from the bottom left.
+ */
+void SoftwareRasterizer::renderTile(int tile) {
+    int x0 = tile % tilesX * TileSize, y0 = tile / tilesX * TileSize;
+    int x1 = std::min(x0 + TileSize, width), y1 = std::min(y0 + TileSize, height);
+    for (int y = y0; y < y1; ++y)
+        std::fill_n(pixels.begin() + static_cast<size_t>(y) * width + x0, x1 - x0, clearColor);
+
+    for (uint32_t index: bins[tile]) {
+        const Primitive &primitive = primitives[index];
+        switch (primitive.shape) {
+            case Shape::Map: shadeMap(maps[primitive.style], x0, y0, x1, y1); break;
+            case Shape::Triangle: fillTriangle(primitive, styles[primitive.style], x0, y0, x1, y1); break;
+            case Shape::Point: fillPoint(primitive, styles[primitive.style], x0, y0, x1, y1); break;
+            case Shape::Segment: fillSegment(primitive, styles[primitive.style], x0, y0, x1, y1); break;
+        }
+    }
+}
+
+
+/**
+ * Shades the map in an area of the image, like the `MAP_LIGHTING` fragment
+ * shader at the pixel centers.
+ *
+ * The light of a pixel is the dot product of its surface normal and the sun
+ * direction, cos(lat) cos(sunLat) cos(lon - sunLon) + sin(lat) sin(sunLat).
+ * The latitude is the same along a row and cos(lat) cos(sunLat) is positive
+ * on the map, so the pixel is lit when cos(lon - sunLon) reaches a threshold
+ * of its row; the cosines and texel columns of the tile's columns are computed
+ * once per tile.
+ *
+ * @param map The map and the view it is drawn in.
+ * @param x0  Left edge of the area.
+ * @param y0  Bottom edge of the area.
+ * @param x1  Right edge of the area, exclusive.
+ * @param y1  Top edge of the area, exclusive.
+ */
+void SoftwareRasterizer::shadeMap(const MapLayer &map, int x0, int y0, int x1, int y1) {
+    const double maxY = std::log(std::tan(glm::radians(85.0)) + 1.0 / std::cos(glm::radians(85.0)));
+    const float sunLatitude = glm::radians(23.0f);
+
+    alignas(16) std::array<float, TileSize> cosines{};
+    std::array<int, TileSize> columns{};
+    int count = x1 - x0;
+    for (int i = 0; i < count; ++i) {
+        double mapX = map.center.x + ((x0 + i + 0.5) * 2.0 / width - 1.0) / map.zoom;
+        double u = (mapX + 1.0) * 0.5;
+        u -= std::floor(u);
+        columns[i] = std::min(static_cast<int>(u * map.textureWidth), map.textureWidth - 1);
+        float longitude = static_cast<float>(u) * 360.0f - 180.0f;
+        cosines[i] = std::cos(glm::radians(longitude - map.sunLongitude));
+    }
+
+    for (int y = y0; y < y1; ++y) {
+        double mapY = map.center.y + ((y + 0.5) * 2.0 / height - 1.0) / map.zoom;
+        if (mapY < -1.0 || mapY > 1.0) continue;
+        int row = std::min(static_cast<int>((mapY + 1.0) * 0.5 * map.textureHeight), map.textureHeight - 1);
+        float latitude = static_cast<float>(std::atan(std::sinh(mapY * maxY)));
+        float threshold = -std::sin(latitude) * std::sin(sunLatitude) / (std::cos(latitude) * std::cos(sunLatitude));
+        const uint32_t *lit = map.lit.data() + static_cast<size_t>(row) * map.textureWidth;
+        const uint32_t *dimmed = map.dimmed.data() + static_cast<size_t>(row) * map.textureWidth;
+        uint32_t *out = pixels.data() + static_cast<size_t>(y) * width + x0;
+
+        int i = 0;
+#ifdef SOFTWARE_RASTERIZER_SSE
+        __m128 limit = _mm_set1_ps(threshold);
+        for (; i + 4 <= count; i += 4) {
+            int mask = _mm_movemask_ps(_mm_cmpge_ps(_mm_load_ps(cosines.data() + i), limit));
+            for (int lane = 0; lane < 4; ++lane)
+                out[i + lane] = (mask >> lane & 1) ? lit[columns[i + lane]] : dimmed[columns[i + lane]];
+        }
+#endif
+        for (; i < count; ++i)
+            out[i] = cosines[i] >= threshold ? lit[columns[i]] : dimmed[columns[i]];
+    }
+}
+
+
+/**
+ * Fills the pixels of an area whose centers are inside a triangle. Centers on
+ * an edge belong to the triangle only if the edge is a top or a left edge, so
+ * triangles sharing an edge never blend a pixel twice.
+ *
+ * Each edge bounds a row from one side, so the covered span of a row is found
+ * from the three edge equations and only its ends are tested pixel by pixel;
+ * long thin triangles, as ear clipping makes them, cost no more than their area.
+ *
+ * @param primitive The triangle.
+ * @param style     Its color and opacity.
+ * @param x0        Left edge of the area.
+ * @param y0        Bottom edge of the area.
+ * @param x1        Right edge of the area, exclusive.
+ * @param y1        Top edge of the area, exclusive.
+ */
+void SoftwareRasterizer::fillTriangle(const Primitive &primitive, const Style &style, int x0, int y0, int x1, int y1) {
+    dvec2 a = primitive.vertices[0], b = primitive.vertices[1], c = primitive.vertices[2];
+    double area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (area == 0.0) return;
+    if (area < 0.0) std::swap(b, c);
+
+    const dvec2 corners[3] = {a, b, c};
+    double startValue[3], stepX[3], stepY[3];
+    bool inclusive[3];
+    double centerX = x0 + 0.5, centerY = y0 + 0.5;
+    for (int edge = 0; edge < 3; ++edge) {
+        dvec2 from = corners[edge], to = corners[(edge + 1) % 3];
+        dvec2 delta = to - from;
+        startValue[edge] = delta.x * (centerY - from.y) - delta.y * (centerX - from.x);
+        stepX[edge] = -delta.y;
+        stepY[edge] = delta.x;
+        inclusive[edge] = (delta.y == 0.0 && delta.x < 0.0) || delta.y < 0.0;   // top or left edge
+    }
+
+    int minY = static_cast<int>(std::clamp(std::floor(std::min({a.y, b.y, c.y})), double(y0), double(y1)));
+    int maxY = static_cast<int>(std::clamp(std::ceil(std::max({a.y, b.y, c.y})), double(y0), double(y1)));
+    for (int y = minY; y < maxY; ++y) {
+        double rowValue[3];
+        for (int edge = 0; edge < 3; ++edge) rowValue[edge] = startValue[edge] + stepY[edge] * (y - y0);
+        auto inside = [&](int x) {
+            for (int edge = 0; edge < 3; ++edge) {
+                double value = rowValue[edge] + stepX[edge] * (x - x0);
+                if (value < 0.0 || (value == 0.0 && !inclusive[edge])) return false;
+            }
+            return true;
+        };
+
+        double low = x0, high = x1;   // the span, from the edges bounding it on the left and the right
+        for (int edge = 0; edge < 3; ++edge) {
+            if (stepX[edge] == 0.0) {
+                if (rowValue[edge] < 0.0) high = low;
+            } else if (stepX[edge] > 0.0) {
+                low = std::max(low, x0 - rowValue[edge] / stepX[edge]);
+            } else {
+                high = std::min(high, x0 - rowValue[edge] / stepX[edge] + 1.0);
+            }
+        }
+        if (high <= low) continue;
+        int first = std::max(x0, static_cast<int>(std::floor(low)) - 1);
+        int last = std::min(x1, static_cast<int>(std::ceil(high)) + 1);
+        while (first < last && !inside(first)) ++first;
+        while (last > first && !inside(last - 1)) --last;
+        uint32_t *row = pixels.data() + static_cast<size_t>(y) * width;
+        for (int x = first; x < last; ++x) blend(row[x], style);
+    }
+}
+
+
+/**
+ * Fills the pixels of an area whose centers are inside the square of a point,
+ * like a non-antialiased GL point.
+ *
+ * @param primitive The point.
+ * @param style     Its color and size.
+ * @param x0        Left edge of the area.
+ * @param y0        Bottom edge of the area.
+ * @param x1        Right edge of the area, exclusive.
+ * @param y1        Top edge of the area, exclusive.
+ */
+void SoftwareRasterizer::fillPoint(const Primitive &primitive, const Style &style, int x0, int y0, int x1, int y1) {
+    dvec2 center = primitive.vertices[0];
+    double half = style.size * 0.5;
+    int minX = std::max(x0, static_cast<int>(std::ceil(center.x - half - 0.5)));
+    int maxX = std::min(x1, static_cast<int>(std::ceil(center.x + half - 0.5)));
+    int minY = std::max(y0, static_cast<int>(std::ceil(center.y - half - 0.5)));
+    int maxY = std::min(y1, static_cast<int>(std::ceil(center.y + half - 0.5)));
+    for (int y = minY; y < maxY; ++y)
+        for (int x = minX; x < maxX; ++x)
+            blend(pixels[static_cast<size_t>(y) * width + x], style);
+}
+
+
+/**
+ * Fills the pixels of an area covered by a wide line segment, like a
+ * non-antialiased GL line: along its major axis every pixel center from the
+ * start up to the end, and across it the pixels whose centers are within half
+ * the width of the line.
+ *
+ * @param primitive The segment.
+ * @param style     Its color and width.
+ * @param x0        Left edge of the area.
+ * @param y0        Bottom edge of the area.
+ * @param x1        Right edge of the area, exclusive.
+ * @param y1        Top edge of the area, exclusive.
+ */
+void SoftwareRasterizer::fillSegment(const Primitive &primitive, const Style &style, int x0, int y0, int x1, int y1) {
+    dvec2 from = primitive.vertices[0], to = primitive.vertices[1];
+    bool xMajor = std::abs(to.x - from.x) >= std::abs(to.y - from.y);
+    if (!xMajor) {   // walk along y, with the roles of the axes swapped
+        std::swap(from.x, from.y);
+        std::swap(to.x, to.y);
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+    if (from.x == to.x) return;
+    if (from.x > to.x) std::swap(from, to);
+    double slope = (to.y - from.y) / (to.x - from.x);
+    double half = style.size * 0.5;
+
+    int first = std::max(x0, static_cast<int>(std::ceil(from.x - 0.5)));
+    int last = std::min(x1, static_cast<int>(std::ceil(to.x - 0.5)));
+    for (int along = first; along < last; ++along) {
+        double middle = from.y + (along + 0.5 - from.x) * slope;
+        int low = std::max(y0, static_cast<int>(std::floor(middle - half - 0.5)) + 1);
+        int high = std::min(y1, static_cast<int>(std::ceil(middle + half - 0.5)));
+        for (int across = low; across < high; ++across) {
+            int x = xMajor ? along : across, y = xMajor ? across : along;
+            blend(pixels[static_cast<size_t>(y) * width + x], style);
+        }
+    }
+}
+
+
+/**
+ * Writes a color over a pixel, blended with its previous color by the opacity
+ * of the style like `GL_CONSTANT_ALPHA` blending.
+ *
+ * @param pixel The pixel to write.
+ * @param style The color and opacity to write.
+ */
+void SoftwareRasterizer::blend(uint32_t &pixel, const Style &style) const {
+    if (style.opacity >= 1.0f) {
+        pixel = packColor(style.color);
+        return;
+    }
+    uint32_t result = 0xff000000u;
+    for (int channel = 0; channel < 3; ++channel) {
+        float below = static_cast<float>(pixel >> (8 * channel) & 0xff);
+        float value = style.color[channel] * style.opacity * 255.0f + below * (1.0f - style.opacity);
+        result |= static_cast<uint32_t>(value + 0.5f) << (8 * channel);
+    }
+    pixel = result;
+}
+
+
+/**
+ * Returns the image as RGBA bytes with the rows from the top, as image files
+ * store them.
+ */
+std::vector<unsigned char> SoftwareRasterizer::image() const {
+    std::vector<unsigned char> bytes(pixels.size() * 4);
+    for (int y = 0; y < height; ++y) {
+        const uint32_t *row = pixels.data() + static_cast<size_t>(height - 1 - y) * width;
+        unsigned char *out = bytes.data() + static_cast<size_t>(y) * width * 4;
+        for (int x = 0; x < width; ++x)
+            for (int channel = 0; channel < 4; ++channel) out[x * 4 + channel] = row[x] >> (8 * channel) & 0xff;
+    }
+    return bytes;
+}
@@ -0,0 +1,119 @@
+#ifndef SOFTWARERASTERIZER_H
+#define SOFTWARERASTERIZER_H
+
+#include "framework.h"
+#include "Camera.h"
+#include "WorkerPool.h"
+#include <cstdint>
+
+
+/**
+ * @class SoftwareRasterizer
+ * @brief Draws the flat map, land, paths and stations into an RGBA8 buffer on the CPU.
+ *
+ * A replacement for the GL passes on hosts without a GPU. It implements what
+ * those passes use on the map: the textured map with the day-night lighting of
+ * the `MAP_LIGHTING` shader, blended triangles, square points and wide line
+ * strips, with the pixel-center sampling and coverage rules of OpenGL, so its
+ * images match the GL ones up to rounding at the edges of primitives and of
+ * the night side. Labels and the globe are not drawn.
+ *
+ * Drawing is deferred: `clear` starts a frame, the draw calls transform their
+ * vertices through the camera into window coordinates and sort the primitives
+ * into the 64x64 pixel tiles they overlap, and `render` then draws every tile
+ * on the `WorkerPool`, each tile on one thread in draw order. Tiles share
+ * nothing but the read-only primitives, so no locking is needed, and a tile of
+ * RGBA8 pixels stays in the cache of its core.
+ *
+ * The map is shaded a row of four pixels at a time with SSE where available.
+ * The lighting term of a pixel separates into a factor of its latitude, i.e.
+ * its row, and one of its longitude, i.e. its column: a pixel is lit when the
+ * cosine of its longitude distance to the sun exceeds a threshold of its row.
+ * The texture is converted once into a lit and a dimmed RGBA8 copy, so a pixel
+ * costs a comparison and a table lookup.
+ */
+class SoftwareRasterizer final {
+public:
+    static constexpr int TileSize = 64;
+
+private:
+    enum class Shape : uint8_t { Map, Triangle, Point, Segment };
+
+    struct Style {
+        vec3 color;
+        float opacity;
+        float size;             // point size or line width in pixels
+    };
+
+    struct MapLayer {
+        std::vector<uint32_t> lit;       // RGBA8 texels in daylight
+        std::vector<uint32_t> dimmed;    // and at night
+        int textureWidth;
+        int textureHeight;
+        dvec2 center;
+        double zoom;
+        float sunLongitude;              // degrees
+    };
+
+    struct Primitive {
+        Shape shape;
+        uint32_t style;         // index into `styles`, or into `maps` for the map
+        dvec2 vertices[3];      // window coordinates in pixels
+    };
+
+    int width;
+    int height;
+    int tilesX;
+    int tilesY;
+    std::vector<uint32_t> pixels;               // rows from the bottom, like glReadPixels
+    uint32_t clearColor = 0;
+    std::vector<Style> styles;
+    std::vector<MapLayer> maps;
+    std::vector<Primitive> primitives;
+    std::vector<std::vector<uint32_t>> bins;    // primitives overlapping each tile, in draw order
+
+    dvec2 toWindow(const dvec2 &mapPosition, const Camera &camera, int copy) const;
+
+    void bin(const Primitive &primitive, const dvec2 &low, const dvec2 &high);
+
+    void renderTile(int tile);
+
+    void shadeMap(const MapLayer &map, int x0, int y0, int x1, int y1);
+
+    void fillTriangle(const Primitive &primitive, const Style &style, int x0, int y0, int x1, int y1);
+
+    void fillPoint(const Primitive &primitive, const Style &style, int x0, int y0, int x1, int y1);
+
+    void fillSegment(const Primitive &primitive, const Style &style, int x0, int y0, int x1, int y1);
+
+    void blend(uint32_t &pixel, const Style &style) const;
+
+public:
+    SoftwareRasterizer(int width, int height);
+
+    void clear(const vec3 &color);
+
+    void drawMap(const Camera &camera, const std::vector<vec3> &texels, int textureWidth, int textureHeight,
+                 float hourOffset);
+
+    void drawTriangles(const Camera &camera, const std::vector<dvec2> &vertices, const std::vector<uint32_t> &indices,
+                       const vec3 &color, float opacity);
+
+    void drawLineStrips(const Camera &camera, const std::vector<dvec2> &vertices, int stripLength,
+                        const vec3 &color, float lineWidth);
+
+    void drawPoints(const Camera &camera, const std::vector<dvec2> &positions, const vec3 &color, float pointSize);
+
+    void render(WorkerPool &workers);
+
+    std::vector<unsigned char> image() const;
+
+    int Width() const { return width; }
+
+    int Height() const { return height; }
+
+    int TileCount() const { return tilesX * tilesY; }
+};
+
+
+#endif //SOFTWARERASTERIZER_H
@@ -0,0 +1,58 @@
+#include "StationPicker.h"
+#include <algorithm>
+#include <cmath>
+
+
+/**
+ * Creates an empty picker.
+ */
+StationPicker::StationPicker() : cells(static_cast<size_t>(Cells) * Cells) {}
+
+
+/**
+ * Returns the grid column or row of a normalized map coordinate in [-1, 1],
+ * unclamped, so that coordinates past the edge of the map fall into cells
+ * beyond the grid.
+ */
+int StationPicker::cellOf(double coordinate) {
+    return static_cast<int>(std::floor((coordinate + 1.0) * 0.5 * Cells));
+}
+
+
+/**
+ * Adds a station; its index is the number of stations added before it.
+ *
+ * @param map The position of the station in normalized map coordinates.
+ */
+void StationPicker::add(const dvec2 &map) {
+    int column = std::clamp(cellOf(map.x), 0, Cells - 1), row = std::clamp(cellOf(map.y), 0, Cells - 1);
+    cells[static_cast<size_t>(row) * Cells + column].push_back(static_cast<uint32_t>(positions.size()));
+    positions.push_back(map);
+}
+
+
+/**
+ * Collects the stations in the cells overlapping a square around a point. The
+ * square may reach past the left or right edge of the map and continue on the
+ * other side; each station is collected once however wide the square is.
+ *
+ * @param map      The center of the square in normalized map coordinates.
+ * @param radius   Half the side of the square, in the same units.
+ * @param stations Receives the indices of the stations, in no particular order; cleared first.
+ */
+void StationPicker::near(const dvec2 &map, double radius, std::vector<int> &stations) const {
+    stations.clear();
+    int firstColumn = cellOf(map.x - radius), lastColumn = cellOf(map.x + radius);
+    if (lastColumn - firstColumn >= Cells) {
+        firstColumn = 0;
+        lastColumn = Cells - 1;
+    }
+    int firstRow = std::max(cellOf(map.y - radius), 0), lastRow = std::min(cellOf(map.y + radius), Cells - 1);
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            int wrapped = (column % Cells + Cells) % Cells;
+            for (uint32_t station: cells[static_cast<size_t>(row) * Cells + wrapped])
+                stations.push_back(static_cast<int>(station));
+        }
+    }
+}
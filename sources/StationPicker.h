@@ -0,0 +1,46 @@
+#ifndef STATIONPICKER_H
+#define STATIONPICKER_H
+
+#include "framework.h"
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * @class StationPicker
+ * @brief Finds the stations near a point of the map, to tell which one is under the cursor.
+ *
+ * Stations are sorted into a grid of `Cells` by `Cells` cells over the
+ * normalized map as they are added; a station is never moved or removed, so
+ * adding one is a single append. A query visits only the cells overlapping a
+ * square around the point, wrapping around the antimeridian like the map does,
+ * so hovering over a network of a million stations looks at a few thousand of
+ * them at most, and usually at a handful.
+ *
+ * The picker only finds candidates by map position. Deciding which of them is
+ * under the cursor, in pixels and at the current time, is up to the caller.
+ */
+class StationPicker final {
+public:
+    static constexpr int Cells = 256;   // per side
+
+private:
+    std::vector<std::vector<uint32_t>> cells;
+    std::vector<dvec2> positions;       // normalized map position of each station
+
+    static int cellOf(double coordinate);
+
+public:
+    StationPicker();
+
+    void add(const dvec2 &map);
+
+    size_t Count() const { return positions.size(); }
+
+    const dvec2 &Position(int station) const { return positions[station]; }
+
+    void near(const dvec2 &map, double radius, std::vector<int> &stations) const;
+};
+
+
+#endif //STATIONPICKER_H
@@ -0,0 +1,282 @@
+#include "TextRenderer.h"
+#include <algorithm>
+
+
+/**
+ * Constructs the text renderer with a single view.
+ *
+ * @param viewportWidth  Width of the target in pixels.
+ * @param viewportHeight Height of the target in pixels.
+ */
+TextRenderer::TextRenderer(int viewportWidth, int viewportHeight) {
+    setViews(1, viewportWidth, viewportHeight);
+}
+
+
+/**
+ * Sets the number of views the labels are laid out for, and their size. Each
+ * view gets a vertex array whose attributes are all per instance (one instance
+ * per glyph), over its own instance buffer. Views that remain keep their
+ * camera, but all of them are laid out again.
+ *
+ * @param count          Number of views.
+ * @param viewportWidth  Width of each view in pixels.
+ * @param viewportHeight Height of each view in pixels.
+ */
+void TextRenderer::setViews(int count, int viewportWidth, int viewportHeight) {
+    for (size_t i = count; i < layouts.size(); ++i) {
+        glDeleteBuffers(1, &layouts[i].instanceVbo);
+        glDeleteVertexArrays(1, &layouts[i].vao);
+    }
+    size_t existing = std::min(layouts.size(), static_cast<size_t>(count));
+    layouts.resize(count);
+    for (size_t i = existing; i < layouts.size(); ++i) {
+        Layout &target = layouts[i];
+        glGenVertexArrays(1, &target.vao);
+        glBindVertexArray(target.vao);
+        glGenBuffers(1, &target.instanceVbo);
+        glBindBuffer(GL_ARRAY_BUFFER, target.instanceVbo);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance),
+                              reinterpret_cast<void *>(offsetof(GlyphInstance, anchor)));
+        glVertexAttribDivisor(0, 1);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance),
+                              reinterpret_cast<void *>(offsetof(GlyphInstance, glyph)));
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance),
+                              reinterpret_cast<void *>(offsetof(GlyphInstance, color)));
+        glVertexAttribDivisor(3, 1);
+        glBindVertexArray(0);
+    }
+
+    this->viewportWidth = viewportWidth;
+    this->viewportHeight = viewportHeight;
+    occupied.resize(static_cast<size_t>((viewportWidth + GridCellPixels - 1) / GridCellPixels) *
+                    ((viewportHeight + GridCellPixels - 1) / GridCellPixels));
+    invalidate();
+}
+
+
+/**
+ * Uploads the glyph atlas into a single-channel texture. The atlas itself can be
+ * built or loaded on any thread; this call must be made on the GL thread.
+ *
+ * @param atlas The generated or cached glyph atlas.
+ */
+void TextRenderer::setAtlas(const GlyphAtlas &atlas) {
+    if (atlasTexture == 0) glGenTextures(1, &atlasTexture);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, GlyphAtlas::Width, GlyphAtlas::Height, 0, GL_RED, GL_UNSIGNED_BYTE,
+                 atlas.Texels().data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+/**
+ * Adds a label. Labels with a higher priority win when labels would overlap.
+ *
+ * @param anchor      Position of the label in normalized map coordinates.
+ * @param text        The text; lowercase letters are drawn in uppercase.
+ * @param color       RGB color of the glyphs.
+ * @param priority    Decluttering priority, higher values are placed first.
+ * @param pixelOffset Screen space offset of the bottom center of the text from
+ *                    the anchor, e.g. to keep it clear of a station marker.
+ * @param lifetime    Appear and disappear time of the label on the timeline.
+ * @return The index of the label, for `setLifetime`.
+ */
+size_t TextRenderer::addLabel(const dvec2 &anchor, const std::string &text, const vec3 &color, int priority,
+                              const vec2 &pixelOffset, const vec2 &lifetime) {
+    labels.push_back({anchor, pixelOffset, text, color, priority, lifetime});
+    drawOrder.push_back(static_cast<int>(labels.size() - 1));
+    orderDirty = true;
+    invalidate();
+    return labels.size() - 1;
+}
+
+
+/**
+ * Changes when a label is shown, e.g. when its station is retired.
+ *
+ * @param label    Index returned by `addLabel`.
+ * @param lifetime Appear and disappear time on the timeline.
+ */
+void TextRenderer::setLifetime(size_t label, const vec2 &lifetime) {
+    labels[label].lifetime = lifetime;
+    invalidate();
+}
+
+
+/**
+ * Sets the point of the timeline the labels are shown at. Labels are shown if
+ * they appeared at or before it and disappear after it.
+ *
+ * @param timelineTime Time in hours.
+ */
+void TextRenderer::setTime(float timelineTime) {
+    if (timelineTime == time) return;
+    time = timelineTime;
+    invalidate();
+}
+
+
+/**
+ * Removes every label.
+ */
+void TextRenderer::clear() {
+    labels.clear();
+    drawOrder.clear();
+    invalidate();
+}
+
+
+/**
+ * Marks the layouts of every view as outdated.
+ */
+void TextRenderer::invalidate() {
+    for (Layout &target: layouts) target.dirty = true;
+}
+
+
+/**
+ * Sets the camera of a view the labels are laid out for. Labels are projected
+ * onto the screen with `Camera::mapToNdc`, on the map or on the globe.
+ *
+ * @param view   Index of the view.
+ * @param camera The camera of the view.
+ */
+void TextRenderer::setView(int view, const Camera &camera) {
+    Layout &target = layouts[view];
+    if (camera == target.view) return;
+    target.view = camera;
+    target.dirty = true;
+}
+
+
+/**
+ * Culls, declutters and places the labels for one view and rebuilds its glyph
+ * instances.
+ *
+ * Labels are visited in priority order (kept sorted across calls, with ties in
+ * insertion order). The screen rectangle of a label is rasterized into a grid of
+ * `GridCellPixels` sized cells; the label is kept only if all of those cells are
+ * still free, and then claims them.
+ *
+ * @param target The layout of the view.
+ */
+void TextRenderer::layout(Layout &target) {
+    if (orderDirty) {
+        std::stable_sort(drawOrder.begin(), drawOrder.end(),
+                         [this](int a, int b) { return labels[a].priority > labels[b].priority; });
+        orderDirty = false;
+    }
+
+    std::fill(occupied.begin(), occupied.end(), 0);
+    instances.clear();
+    target.visibleLabels = 0;
+
+    const int gridWidth = (viewportWidth + GridCellPixels - 1) / GridCellPixels;
+    const int gridHeight = (viewportHeight + GridCellPixels - 1) / GridCellPixels;
+    const float padding = static_cast<float>(GlyphAtlas::Padding) / GlyphAtlas::UnitTexels * UnitPixels;
+    const float textHeight = GlyphAtlas::GlyphRows * UnitPixels;
+
+    for (int index: drawOrder) {
+        const Label &label = labels[index];
+        vec2 anchorNdc;
+        if (label.text.empty() || label.lifetime.x > time || label.lifetime.y <= time ||
+            !target.view.mapToNdc(label.anchor, anchorNdc))
+            continue;
+
+        vec2 screen((anchorNdc.x + 1.0f) * 0.5f * viewportWidth, (anchorNdc.y + 1.0f) * 0.5f * viewportHeight);
+        float textWidth = (label.text.size() * Advance - (Advance - GlyphAtlas::GlyphColumns)) * UnitPixels;
+        float left = screen.x + label.pixelOffset.x - 0.5f * textWidth;
+        float bottom = screen.y + label.pixelOffset.y;
+
+        int cellX0 = max(0, static_cast<int>(left) / GridCellPixels);
+        int cellY0 = max(0, static_cast<int>(bottom) / GridCellPixels);
+        int cellX1 = min(gridWidth - 1, static_cast<int>(left + textWidth) / GridCellPixels);
+        int cellY1 = min(gridHeight - 1, static_cast<int>(bottom + textHeight) / GridCellPixels);
+
+        bool free = true;
+        for (int y = cellY0; y <= cellY1 && free; ++y)
+            for (int x = cellX0; x <= cellX1 && free; ++x)
+                free = !occupied[y * gridWidth + x];
+        if (!free) continue;
+        for (int y = cellY0; y <= cellY1; ++y)
+            for (int x = cellX0; x <= cellX1; ++x)
+                occupied[y * gridWidth + x] = 1;
+
+        vec2 ndc(screen.x / viewportWidth * 2.0f - 1.0f, screen.y / viewportHeight * 2.0f - 1.0f);
+        float penX = left - screen.x;
+        float penY = bottom - screen.y;
+        for (char character: label.text) {
+            if (character != ' ')
+                instances.push_back({ndc, vec3(penX - padding, penY - padding,
+                                               static_cast<float>(GlyphAtlas::cellOf(character))), label.color});
+            penX += Advance * UnitPixels;
+        }
+        target.visibleLabels++;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, target.instanceVbo);
+    if (instances.size() > target.instanceCapacity) {
+        target.instanceCapacity = max(instances.size(), 2 * target.instanceCapacity);
+        glBufferData(GL_ARRAY_BUFFER, target.instanceCapacity * sizeof(GlyphInstance), nullptr, GL_DYNAMIC_DRAW);
+    }
+    if (!instances.empty())
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(GlyphInstance), instances.data());
+    target.glyphCount = instances.size();
+    target.dirty = false;
+}
+
+
+/**
+ * Draws the labels visible in a view with one instanced draw call of
+ * four-vertex quads, re-running the layout of the view first if labels or its
+ * camera changed. Draws nothing while the atlas has not been uploaded yet.
+ * Expects the `SHADER_SDF_TEXT` variant, with the uniform block of the view
+ * bound; the glyphs are alpha blended over the target.
+ *
+ * @param prog The SDF text program, already in use.
+ * @param view Index of the view.
+ */
+void TextRenderer::DrawLabels(GPUProgram *prog, int view) {
+    if (atlasTexture == 0) return;
+    Layout &target = layouts[view];
+    if (target.dirty) layout(target);
+    if (target.glyphCount == 0) return;
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    prog->setUniform(0, "tex");
+    prog->setUniform(vec2(GlyphAtlas::CellWidth, GlyphAtlas::CellHeight) * (UnitPixels / GlyphAtlas::UnitTexels),
+                     "glyphQuadSize");
+    prog->setUniform(vec2(GlyphAtlas::AtlasColumns, GlyphAtlas::AtlasRows), "atlasGrid");
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindVertexArray(target.vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<int>(target.glyphCount));
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+}
+
+
+/**
+ * Destructor for the `TextRenderer` class. Releases the atlas texture, and the
+ * instance buffer and the vertex array object of every view.
+ */
+TextRenderer::~TextRenderer() {
+    if (atlasTexture > 0) glDeleteTextures(1, &atlasTexture);
+    for (Layout &target: layouts) {
+        glDeleteBuffers(1, &target.instanceVbo);
+        glDeleteVertexArrays(1, &target.vao);
+    }
+}
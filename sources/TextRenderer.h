@@ -0,0 +1,109 @@
+#ifndef TEXTRENDERER_H
+#define TEXTRENDERER_H
+
+#include "framework.h"
+#include "GlyphAtlas.h"
+#include "Camera.h"
+#include <string>
+
+
+/**
+ * @class TextRenderer
+ * @brief Draws map labels with the SDF glyph atlas in one instanced draw call.
+ *
+ * Labels are anchored at normalized map positions, in double precision so that
+ * they stay next to their stations at any zoom. Before drawing, the labels are
+ * laid out on the screen in priority order: labels whose anchor is outside the
+ * visible map area or on the far side of the globe are culled (the map repeats
+ * horizontally, so each label is placed in the copy of the map that is in view),
+ * and a label is dropped when its screen rectangle
+ * touches a cell of a coarse screen grid already claimed by a higher priority
+ * label. Every glyph of the remaining labels becomes one instance of a quad.
+ *
+ * The labels are shared by every view on the screen, while each view has its
+ * own layout and instance buffer, set up by `setViews`. A layout is only rebuilt
+ * when labels are added or its view changes, so drawing an unchanged set of
+ * labels costs a single draw call regardless of how many labels exist; the
+ * layout itself is linear in the number of labels and only emits glyphs for the
+ * few that fit on the screen.
+ *
+ * Labels can be added before the atlas is available; nothing is drawn until
+ * `setAtlas` has uploaded it.
+ *
+ * A label may have a lifetime on the network timeline; it is only laid out
+ * while the time set by `setTime` lies within it.
+ */
+class TextRenderer final {
+    struct Label {
+        dvec2 anchor;
+        vec2 pixelOffset;
+        std::string text;
+        vec3 color;
+        int priority;
+        vec2 lifetime;   // appear and disappear time
+    };
+
+    struct GlyphInstance {
+        vec2 anchor;
+        vec3 glyph;   // pixel offset of the quad from the anchor, atlas cell
+        vec3 color;
+    };
+
+    static constexpr float UnitPixels = 2.0f;   // screen pixels per font unit
+    static constexpr float Advance = 6.0f;      // font units from one glyph to the next
+    static constexpr int GridCellPixels = 8;
+
+    struct Layout {   // the labels as placed in one view
+        Camera view;
+        bool dirty = true;
+        size_t glyphCount = 0;
+        size_t visibleLabels = 0;
+        unsigned int vao = 0;
+        unsigned int instanceVbo = 0;
+        size_t instanceCapacity = 0;
+    };
+
+    std::vector<Label> labels;
+    std::vector<int> drawOrder;
+    std::vector<GlyphInstance> instances;
+    std::vector<unsigned char> occupied;
+    bool orderDirty = false;
+    std::vector<Layout> layouts;
+
+    int viewportWidth = 0;
+    int viewportHeight = 0;
+    float time = 0.0f;
+
+    unsigned int atlasTexture = 0;
+
+    void invalidate();
+
+    void layout(Layout &target);
+
+public:
+    TextRenderer(int viewportWidth, int viewportHeight);
+
+    void setViews(int count, int viewportWidth, int viewportHeight);
+
+    void setAtlas(const GlyphAtlas &atlas);
+
+    size_t addLabel(const dvec2 &anchor, const std::string &text, const vec3 &color, int priority,
+                    const vec2 &pixelOffset = vec2(0.0f, 0.0f), const vec2 &lifetime = vec2(-1e30f, 1e30f));
+
+    void setLifetime(size_t label, const vec2 &lifetime);
+
+    void setTime(float time);
+
+    void clear();
+
+    void setView(int view, const Camera &camera);
+
+    size_t VisibleLabels(int view) const { return layouts[view].visibleLabels; }
+
+    void DrawLabels(GPUProgram *prog, int view);
+
+    ~TextRenderer();
+};
+
+
+#endif //TEXTRENDERER_H
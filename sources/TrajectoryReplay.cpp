@@ -0,0 +1,263 @@
+#include "TrajectoryReplay.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+
+/**
+ * Number of objects one job of the worker pool interpolates at least.
+ */
+static const size_t ReplayGrain = 4096;
+
+
+/**
+ * Longest real time in seconds one frame may advance the playback by, so that a
+ * stall, e.g. while the window is dragged, does not skip a large part of the
+ * recording.
+ */
+static const float MaxFrameInterval = 0.25f;
+
+
+/**
+ * Opens a trajectory file and starts the loader thread. The replay stays closed
+ * if the file cannot be read or holds no chunks.
+ *
+ * @param path  File to replay.
+ * @param speed Playback speed relative to real time, clamped to [MinSpeed, MaxSpeed].
+ */
+TrajectoryReplay::TrajectoryReplay(const std::string &path, float speed) : reader(path) {
+    setSpeed(speed);
+    if (!IsOpen()) return;
+    startTime = reader.StartTime();
+    endTime = reader.EndTime();
+    playbackTime = startTime;
+    loader = std::thread(&TrajectoryReplay::load, this);
+}
+
+
+/**
+ * Changes the playback speed.
+ *
+ * @param factor Playback speed relative to real time, clamped to [MinSpeed, MaxSpeed].
+ */
+void TrajectoryReplay::setSpeed(float factor) {
+    speed = std::clamp(factor, MinSpeed, MaxSpeed);
+}
+
+
+/**
+ * Body of the loader thread: decodes the first requested chunk that is not
+ * cached yet, without holding the lock, and stores it in place of a chunk that
+ * is no longer requested. Chunks that cannot be read are stored empty, so they
+ * are not retried on every frame.
+ */
+void TrajectoryReplay::load() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        auto missing = std::find_if(requested.begin(), requested.end(), [this](size_t index) {
+            return std::none_of(cache.begin(), cache.end(), [index](const CachedChunk &entry) {
+                return entry.index == index;
+            });
+        });
+        if (missing == requested.end()) {
+            wakeUp.wait(lock);
+            continue;
+        }
+        size_t index = *missing;
+
+        lock.unlock();
+        auto chunk = std::make_shared<TrajectoryChunk>();
+        if (!reader.readChunk(index, *chunk)) {
+            *chunk = TrajectoryChunk();
+            chunk->firstSample.push_back(0);
+        }
+        lock.lock();
+
+        if (cache.size() >= CachedChunks) {
+            auto stale = std::find_if(cache.begin(), cache.end(), [this](const CachedChunk &entry) {
+                return std::find(requested.begin(), requested.end(), entry.index) == requested.end();
+            });
+            cache.erase(stale == cache.end() ? cache.begin() : stale);
+        }
+        cache.push_back({index, std::move(chunk)});
+    }
+}
+
+
+/**
+ * Returns a chunk if the loader has decoded it, nullptr otherwise.
+ */
+std::shared_ptr<const TrajectoryChunk> TrajectoryReplay::cached(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const CachedChunk &entry: cache)
+        if (entry.index == index) return entry.chunk;
+    return nullptr;
+}
+
+
+/**
+ * Adds a chunk to the ones requested this frame, unless it already is.
+ */
+void TrajectoryReplay::request(size_t index) {
+    if (index < reader.ChunkCount() && std::find(wanted.begin(), wanted.end(), index) == wanted.end())
+        wanted.push_back(index);
+}
+
+
+/**
+ * Finds where each object of the current chunk continues in the next chunk. Both
+ * lists of objects are sorted by id, so this is a single merge pass.
+ */
+void TrajectoryReplay::findSuccessors() {
+    successors.assign(current->objectIds.size(), UINT32_MAX);
+    if (next == nullptr) return;
+    size_t other = 0;
+    for (size_t object = 0; object < current->objectIds.size(); ++object) {
+        uint32_t id = current->objectIds[object];
+        while (other < next->objectIds.size() && next->objectIds[other] < id) ++other;
+        if (other < next->objectIds.size() && next->objectIds[other] == id)
+            successors[object] = next->firstSample[other];
+    }
+}
+
+
+/**
+ * Advances the cursors of the objects in [begin, end) to a time and writes the
+ * interpolated positions as unit vectors, four floats per object. Objects whose
+ * first sample in the chunk is later stay there; objects without a sample in
+ * the next chunk stay at their last one.
+ *
+ * @param begin       First object.
+ * @param end         One past the last object.
+ * @param time        Playback time in seconds since the start of the current chunk.
+ * @param destination The region of the instance buffer.
+ */
+void TrajectoryReplay::interpolate(size_t begin, size_t end, float time, float *destination) {
+    const TrajectoryChunk &chunk = *current;
+    auto offset = static_cast<float>(next != nullptr ? next->startTime - chunk.startTime : 0.0);
+    for (size_t object = begin; object < end; ++object) {
+        uint32_t sample = cursors[object];
+        uint32_t last = chunk.firstSample[object + 1] - 1;
+        while (sample < last && chunk.times[sample + 1] <= time) ++sample;
+        cursors[object] = sample;
+
+        float latitude = chunk.latitudes[sample];
+        float longitude = chunk.longitudes[sample];
+        float sampleTime = chunk.times[sample];
+        float nextTime = 0.0f, nextLatitude = 0.0f, nextLongitude = 0.0f;
+        bool between = false;
+        if (sample < last) {
+            nextTime = chunk.times[sample + 1];
+            nextLatitude = chunk.latitudes[sample + 1];
+            nextLongitude = chunk.longitudes[sample + 1];
+            between = true;
+        } else if (successors[object] != UINT32_MAX) {
+            uint32_t following = successors[object];
+            nextTime = next->times[following] + offset;
+            nextLatitude = next->latitudes[following];
+            nextLongitude = next->longitudes[following];
+            between = true;
+        }
+        if (between && time > sampleTime && nextTime > sampleTime) {
+            float weight = std::min((time - sampleTime) / (nextTime - sampleTime), 1.0f);
+            float step = nextLongitude - longitude;
+            step -= 360.0f * std::round(step / 360.0f);   // across the antimeridian
+            latitude += weight * (nextLatitude - latitude);
+            longitude += weight * step;
+        }
+
+        float phi = latitude * static_cast<float>(M_PI) / 180.0f;
+        float lambda = longitude * static_cast<float>(M_PI) / 180.0f;
+        float *out = destination + object * 4;
+        out[0] = cosf(phi) * cosf(lambda);
+        out[1] = cosf(phi) * sinf(lambda);
+        out[2] = sinf(phi);
+        out[3] = 0.0f;
+    }
+}
+
+
+/**
+ * Advances the playback by the real time since the previous frame times the
+ * speed, requests the chunks needed now and in the next frames, and writes the
+ * positions at the new playback time into the next region of the layer's
+ * instance buffer. Called on the render thread once per frame.
+ *
+ * @param time    Current time in seconds.
+ * @param layer   The layer that draws the positions.
+ * @param workers The pool the interpolation is split across.
+ * @return True if new positions were written.
+ */
+bool TrajectoryReplay::update(float time, VehicleLayer &layer, WorkerPool &workers) {
+    if (!IsOpen()) return false;
+    if (lastFrame >= 0.0f) {
+        float interval = std::min(time - lastFrame, MaxFrameInterval);
+        frameInterval += 0.1f * (interval - frameInterval);
+        playbackTime += static_cast<double>(interval) * speed;
+    }
+    lastFrame = time;
+    double duration = endTime - startTime;
+    if (playbackTime >= endTime) playbackTime = startTime + std::fmod(playbackTime - startTime, duration);
+
+    size_t index = reader.findChunk(playbackTime);
+    wanted.clear();
+    request(index);
+    request(index + 1);
+    for (int frame = 1; frame <= LookaheadFrames; ++frame) {
+        double ahead = playbackTime - startTime + static_cast<double>(frame) * frameInterval * speed;
+        size_t later = reader.findChunk(startTime + std::fmod(ahead, duration));
+        request(later);
+        request(later + 1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (requested != wanted) {
+            requested = wanted;
+            wakeUp.notify_one();
+        }
+    }
+
+    if (index != currentIndex) {
+        auto chunk = cached(index);
+        if (chunk == nullptr) return false;
+        current = std::move(chunk);
+        next = cached(index + 1);
+        currentIndex = index;
+        cursorTime = -1.0;
+        findSuccessors();
+    } else if (next == nullptr && index + 1 < reader.ChunkCount()) {
+        next = cached(index + 1);
+        if (next != nullptr) findSuccessors();
+    }
+    if (playbackTime < cursorTime) cursorTime = -1.0;
+    if (cursorTime < 0.0) {
+        cursors.assign(current->firstSample.begin(), current->firstSample.end() - 1);
+    }
+    cursorTime = playbackTime;
+
+    size_t count = current->objectIds.size();
+    float *destination = count > 0 ? layer.beginPositions(count) : nullptr;
+    if (destination != nullptr) {
+        auto chunkTime = static_cast<float>(playbackTime - current->startTime);
+        workers.parallelFor(count, ReplayGrain, [this, chunkTime, destination](size_t begin, size_t end) {
+            interpolate(begin, end, chunkTime, destination);
+        });
+    }
+    written = destination != nullptr ? count : 0;
+    layer.endPositions(written);
+    return true;
+}
+
+
+/**
+ * Destructor for the `TrajectoryReplay` class. Stops the loader thread and frees
+ * the cached chunks.
+ */
+TrajectoryReplay::~TrajectoryReplay() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_one();
+    if (loader.joinable()) loader.join();
+}
@@ -0,0 +1,105 @@
+#ifndef TRAJECTORYREPLAY_H
+#define TRAJECTORYREPLAY_H
+
+#include "TrajectoryStore.h"
+#include "VehicleLayer.h"
+#include "WorkerPool.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+
+/**
+ * @class TrajectoryReplay
+ * @brief Replays a recorded trajectory file on the map at 1x to 10000x speed.
+ *
+ * A loader thread owns the file and decodes chunks into a cache of at most
+ * `CachedChunks` chunks, so memory use depends on the chunk size but not on the
+ * length of the recording. Every frame, the render thread asks for the chunk of
+ * the playback time, the one after it, and the chunks that the next
+ * `LookaheadFrames` frames will need at the current speed and frame rate. At high
+ * speeds these are far apart, and the chunks in between are never decoded. The
+ * loader decodes the requested chunks in order and evicts chunks that are no
+ * longer requested.
+ *
+ * Each object of the current chunk has a cursor: the index of its last sample at
+ * or before the playback time. Playback only moves forward, so the cursors only
+ * advance, which costs about one comparison per object and frame. Positions are
+ * interpolated between the samples around the playback time, using the first
+ * sample in the next chunk after an object's last one in the current chunk, and
+ * written as unit vectors into the instance buffer of a `VehicleLayer`.
+ *
+ * If the chunk of the playback time has not been decoded yet, the positions of
+ * the previous frame stay on the screen. The replay starts over at the end of
+ * the recording.
+ */
+class TrajectoryReplay final {
+public:
+    static constexpr float MinSpeed = 1.0f;
+    static constexpr float MaxSpeed = 10000.0f;
+    static constexpr int LookaheadFrames = 8;
+    static constexpr size_t CachedChunks = 2 * LookaheadFrames + 4;
+
+private:
+    struct CachedChunk {
+        size_t index;
+        std::shared_ptr<const TrajectoryChunk> chunk;
+    };
+
+    // Owned by the loader thread after construction; the index of the file is
+    // only read, so the render thread may search it too.
+    TrajectoryReader reader;
+    double startTime = 0.0;
+    double endTime = 0.0;
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::vector<size_t> requested;      // chunks to load, most urgent first
+    std::vector<CachedChunk> cache;
+    bool stopping = false;
+    std::thread loader;
+
+    float speed = MinSpeed;
+    double playbackTime = 0.0;
+    float lastFrame = -1.0f;
+    float frameInterval = 1.0f / 60.0f;
+    size_t currentIndex = SIZE_MAX;
+    std::shared_ptr<const TrajectoryChunk> current;
+    std::shared_ptr<const TrajectoryChunk> next;
+    std::vector<size_t> wanted;         // chunks requested this frame
+    double cursorTime = 0.0;            // playback time the cursors were moved to
+    std::vector<uint32_t> cursors;      // per object of `current`
+    std::vector<uint32_t> successors;   // first sample of the object in `next`, or UINT32_MAX
+    size_t written = 0;
+
+    void load();
+
+    std::shared_ptr<const TrajectoryChunk> cached(size_t index);
+
+    void request(size_t index);
+
+    void findSuccessors();
+
+    void interpolate(size_t begin, size_t end, float time, float *destination);
+
+public:
+    TrajectoryReplay(const std::string &path, float speed);
+
+    bool IsOpen() const { return reader.IsOpen() && reader.ChunkCount() > 0; }
+
+    float Speed() const { return speed; }
+
+    void setSpeed(float factor);
+
+    double PlaybackTime() const { return playbackTime; }
+
+    size_t ObjectCount() const { return written; }
+
+    bool update(float time, VehicleLayer &layer, WorkerPool &workers);
+
+    ~TrajectoryReplay();
+};
+
+
+#endif //TRAJECTORYREPLAY_H
@@ -0,0 +1,403 @@
+#include "TrajectoryStore.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+
+/**
+ * Maps signed values to unsigned ones so that small magnitudes of either sign
+ * become small numbers: 0, -1, 1, -2, 2, ... become 0, 1, 2, 3, 4, ...
+ */
+static inline uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+
+/**
+ * Appends a value as a varint: 7 bits per byte, least significant first, with
+ * the high bit set on every byte but the last.
+ */
+static void putVarint(std::vector<uint8_t> &out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+
+/**
+ * Reads a varint written by `putVarint`.
+ *
+ * @param in  Read position, advanced past the varint.
+ * @param end End of the readable bytes.
+ * @return False if the bytes end inside the varint or it is longer than 32 bits.
+ */
+static bool getVarint(const uint8_t *&in, const uint8_t *end, uint32_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && in < end; shift += 7) {
+        uint8_t byte = *in++;
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+
+/**
+ * Appends a column of values in blocks of `TrajectoryBlockSize`. Each block is
+ * one byte holding the bit width of its largest value, followed by all values
+ * packed with that width, least significant bit first. The last block is padded
+ * with zeros.
+ */
+static void putColumn(std::vector<uint8_t> &out, const std::vector<uint32_t> &values) {
+    for (size_t block = 0; block < values.size(); block += TrajectoryBlockSize) {
+        size_t count = std::min<size_t>(TrajectoryBlockSize, values.size() - block);
+        uint32_t all = 0;
+        for (size_t i = 0; i < count; ++i) all |= values[block + i];
+        int width = 0;
+        while (width < 32 && (all >> width) != 0) ++width;
+
+        out.push_back(static_cast<uint8_t>(width));
+        size_t start = out.size();
+        out.resize(start + TrajectoryBlockSize * width / 8, 0);
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t bits = static_cast<uint64_t>(values[block + i]) << (i * width % 8);
+            for (size_t byte = start + i * width / 8; bits != 0; ++byte, bits >>= 8)
+                out[byte] |= static_cast<uint8_t>(bits);
+        }
+    }
+}
+
+
+/**
+ * Unpacks one block of a column. The loop has no data-dependent branches: each
+ * value is an unaligned 64-bit load, a shift and a mask, which the compiler can
+ * vectorize. The caller guarantees 8 readable bytes past the block.
+ *
+ * @param in    The packed values, after the width byte.
+ * @param width Bit width of the values.
+ * @param out   Receives `TrajectoryBlockSize` values.
+ */
+static void unpackBlock(const uint8_t *in, int width, uint32_t *out) {
+    uint64_t mask = (uint64_t(1) << width) - 1;
+    for (int i = 0; i < TrajectoryBlockSize; ++i) {
+        size_t bit = static_cast<size_t>(i) * width;
+        uint64_t word;
+        std::memcpy(&word, in + bit / 8, sizeof(word));
+        out[i] = static_cast<uint32_t>((word >> (bit % 8)) & mask);
+    }
+}
+
+
+/**
+ * Reads a column written by `putColumn`.
+ *
+ * @param in     Read position, advanced past the column.
+ * @param end    End of the readable bytes; 8 more bytes must be addressable.
+ * @param count  Number of values in the column.
+ * @param values Receives the values, rounded up to whole blocks.
+ * @return False if the bytes end inside the column.
+ */
+static bool getColumn(const uint8_t *&in, const uint8_t *end, size_t count, std::vector<uint32_t> &values) {
+    size_t blocks = (count + TrajectoryBlockSize - 1) / TrajectoryBlockSize;
+    values.resize(blocks * TrajectoryBlockSize);
+    for (size_t block = 0; block < blocks; ++block) {
+        if (in >= end || *in > 32) return false;
+        int width = *in++;
+        if (in + TrajectoryBlockSize * width / 8 > end) return false;
+        unpackBlock(in, width, values.data() + block * TrajectoryBlockSize);
+        in += TrajectoryBlockSize * width / 8;
+    }
+    return true;
+}
+
+
+/**
+ * Creates a trajectory file, replacing an existing one. Check `IsOpen` for
+ * success.
+ *
+ * @param path         File to write.
+ * @param chunkSeconds Time span of one chunk: the granularity of seeking, and
+ *                     the amount of samples buffered while recording.
+ */
+TrajectoryWriter::TrajectoryWriter(const std::string &path, float chunkSeconds)
+    : file(path, std::ios::binary | std::ios::trunc),
+      chunkMilliseconds(std::max<uint32_t>(1, static_cast<uint32_t>(chunkSeconds * 1000.0f))) {
+    if (!file) {
+        std::cerr << "Cannot create trajectory file " << path << std::endl;
+        return;
+    }
+    TrajectoryFileHeader header{TrajectoryMagic, TrajectoryVersion, chunkMilliseconds, 0};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+
+/**
+ * Adds one sample.
+ *
+ * @param objectId  Identifies the track.
+ * @param time      Time of the sample in seconds.
+ * @param latitude  Latitude in degrees.
+ * @param longitude Longitude in degrees.
+ * @return False if the sample belongs to a chunk that was already written.
+ */
+bool TrajectoryWriter::add(uint32_t objectId, double time, float latitude, float longitude) {
+    if (!IsOpen()) return false;
+    auto milliseconds = static_cast<int64_t>(std::llround(time * 1000.0));
+    int64_t start = milliseconds - ((milliseconds % chunkMilliseconds) + chunkMilliseconds) % chunkMilliseconds;
+    if (chunkOpen && start < chunkStart) return false;
+    if (chunkOpen && start > chunkStart) flushChunk();
+    if (!chunkOpen) {
+        chunkStart = start;
+        chunkOpen = true;
+    }
+    tracks[objectId].push_back({static_cast<int32_t>(milliseconds - chunkStart),
+                                static_cast<int32_t>(std::lround(latitude / TrajectoryQuantum)),
+                                static_cast<int32_t>(std::lround(longitude / TrajectoryQuantum))});
+    ++sampleCount;
+    return true;
+}
+
+
+/**
+ * Encodes the buffered chunk, writes it and records it in the index. Track
+ * vectors are cleared rather than erased, so that steady recording reuses
+ * their capacity.
+ */
+void TrajectoryWriter::flushChunk() {
+    std::vector<uint32_t> ids;
+    for (const auto &track: tracks)
+        if (!track.second.empty()) ids.push_back(track.first);
+    std::sort(ids.begin(), ids.end());
+
+    std::vector<uint8_t> out;
+    std::vector<uint32_t> columns[3];
+    uint32_t samples = 0;
+    putVarint(out, static_cast<uint32_t>(ids.size()));
+    uint32_t previousId = 0;
+    for (uint32_t id: ids) {
+        const std::vector<Sample> &track = tracks[id];
+        samples += static_cast<uint32_t>(track.size());
+        putVarint(out, id - previousId);
+        previousId = id;
+        putVarint(out, static_cast<uint32_t>(track.size()));
+        putVarint(out, zigzag(track[0].time));
+        putVarint(out, zigzag(track[0].latitude));
+        putVarint(out, zigzag(track[0].longitude));
+        if (track.size() < 2) continue;
+        putVarint(out, zigzag(track[1].time - track[0].time));
+        putVarint(out, zigzag(track[1].latitude - track[0].latitude));
+        putVarint(out, zigzag(track[1].longitude - track[0].longitude));
+        for (size_t k = 2; k < track.size(); ++k) {
+            const Sample &a = track[k - 2], &b = track[k - 1], &c = track[k];
+            columns[0].push_back(zigzag((c.time - b.time) - (b.time - a.time)));
+            columns[1].push_back(zigzag((c.latitude - b.latitude) - (b.latitude - a.latitude)));
+            columns[2].push_back(zigzag((c.longitude - b.longitude) - (b.longitude - a.longitude)));
+        }
+    }
+    for (const auto &column: columns) putColumn(out, column);
+
+    index.push_back({chunkStart, static_cast<uint64_t>(file.tellp()), static_cast<uint32_t>(out.size()), samples,
+                     static_cast<uint32_t>(ids.size()), 0});
+    file.write(reinterpret_cast<const char *>(out.data()), static_cast<std::streamsize>(out.size()));
+    for (auto &track: tracks) track.second.clear();
+    chunkOpen = false;
+}
+
+
+/**
+ * Writes the buffered chunk, the index and the footer, and closes the file.
+ * Called by the destructor if it has not been called before.
+ *
+ * @return The size of the file in bytes, or 0 if writing failed.
+ */
+uint64_t TrajectoryWriter::close() {
+    if (!IsOpen()) return 0;
+    if (chunkOpen) flushChunk();
+    TrajectoryFileFooter footer{static_cast<uint64_t>(file.tellp()), static_cast<uint32_t>(index.size()),
+                                TrajectoryMagic};
+    file.write(reinterpret_cast<const char *>(index.data()),
+               static_cast<std::streamsize>(index.size() * sizeof(TrajectoryChunkInfo)));
+    file.write(reinterpret_cast<const char *>(&footer), sizeof(footer));
+    uint64_t size = file.good() ? static_cast<uint64_t>(file.tellp()) : 0;
+    file.close();
+    if (size == 0) std::cerr << "Writing the trajectory file failed" << std::endl;
+    return size;
+}
+
+
+/**
+ * Destructor for the `TrajectoryWriter` class. Completes the file.
+ */
+TrajectoryWriter::~TrajectoryWriter() {
+    close();
+}
+
+
+/**
+ * Opens a trajectory file and reads its index. The reader stays closed if the
+ * file is missing, truncated or of another version.
+ *
+ * @param path File to read.
+ */
+TrajectoryReader::TrajectoryReader(const std::string &path) : file(path, std::ios::binary) {
+    if (!file) return;
+    TrajectoryFileHeader header{};
+    TrajectoryFileFooter footer{};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    file.seekg(-static_cast<std::streamoff>(sizeof(footer)), std::ios::end);
+    std::streamoff footerOffset = file.tellg();
+    file.read(reinterpret_cast<char *>(&footer), sizeof(footer));
+    if (!file || header.magic != TrajectoryMagic || header.version != TrajectoryVersion ||
+        footer.magic != TrajectoryMagic || header.chunkMilliseconds == 0 ||
+        footer.indexOffset + footer.chunkCount * sizeof(TrajectoryChunkInfo) != static_cast<uint64_t>(footerOffset)) {
+        std::cerr << "Not a complete trajectory file: " << path << std::endl;
+        file.close();
+        return;
+    }
+    chunkMilliseconds = header.chunkMilliseconds;
+    index.resize(footer.chunkCount);
+    file.seekg(static_cast<std::streamoff>(footer.indexOffset));
+    file.read(reinterpret_cast<char *>(index.data()),
+              static_cast<std::streamsize>(index.size() * sizeof(TrajectoryChunkInfo)));
+    if (!file) {
+        std::cerr << "Cannot read the index of " << path << std::endl;
+        index.clear();
+        file.close();
+    }
+}
+
+
+/**
+ * Returns the start of the recording in seconds.
+ */
+double TrajectoryReader::StartTime() const {
+    return index.empty() ? 0.0 : index.front().startMilliseconds / 1000.0;
+}
+
+
+/**
+ * Returns the end of the time span of the last chunk in seconds.
+ */
+double TrajectoryReader::EndTime() const {
+    return index.empty() ? 0.0 : (index.back().startMilliseconds + chunkMilliseconds) / 1000.0;
+}
+
+
+/**
+ * Finds the chunk holding a point in time by a binary search over the index.
+ *
+ * @param time Time in seconds.
+ * @return The last chunk starting at or before `time`, 0 if `time` precedes the
+ *         recording, or `ChunkCount()` if there are no chunks.
+ */
+size_t TrajectoryReader::findChunk(double time) const {
+    if (index.empty()) return 0;
+    auto milliseconds = static_cast<int64_t>(std::floor(time * 1000.0));
+    auto next = std::upper_bound(index.begin(), index.end(), milliseconds,
+                                 [](int64_t value, const TrajectoryChunkInfo &info) {
+                                     return value < info.startMilliseconds;
+                                 });
+    return next == index.begin() ? 0 : static_cast<size_t>(next - index.begin() - 1);
+}
+
+
+/**
+ * Reads and decodes one chunk.
+ *
+ * Decoding runs in passes over whole columns: the header varints, the block
+ * unpacking, the zigzag decoding and finally two running sums per track, which
+ * turn the second differences back into times and positions.
+ *
+ * @param i     Index of the chunk.
+ * @param chunk Receives the samples; its vectors are reused.
+ * @return False if the chunk could not be read or is corrupt.
+ */
+bool TrajectoryReader::readChunk(size_t i, TrajectoryChunk &chunk) {
+    if (!IsOpen() || i >= index.size()) return false;
+    const TrajectoryChunkInfo &info = index[i];
+    encoded.assign(info.size + sizeof(uint64_t), 0);
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(info.offset));
+    file.read(reinterpret_cast<char *>(encoded.data()), info.size);
+    if (!file) {
+        std::cerr << "Cannot read trajectory chunk " << i << std::endl;
+        return false;
+    }
+
+    const uint8_t *in = encoded.data();
+    const uint8_t *end = in + info.size;
+    uint32_t objectCount = 0;
+    if (!getVarint(in, end, objectCount) || objectCount != info.objectCount) return false;
+
+    struct TrackStart {
+        uint32_t count;
+        int32_t first[3];
+        int32_t step[3];
+    };
+    std::vector<TrackStart> starts(objectCount);
+    chunk.objectIds.resize(objectCount);
+    chunk.firstSample.resize(objectCount + 1);
+    size_t samples = 0, differences = 0;
+    uint32_t id = 0;
+    for (uint32_t object = 0; object < objectCount; ++object) {
+        TrackStart &start = starts[object];
+        uint32_t idDelta, value;
+        if (!getVarint(in, end, idDelta) || !getVarint(in, end, start.count) || start.count == 0) return false;
+        id += idDelta;
+        chunk.objectIds[object] = id;
+        chunk.firstSample[object] = static_cast<uint32_t>(samples);
+        for (int32_t &first: start.first) {
+            if (!getVarint(in, end, value)) return false;
+            first = unzigzag(value);
+        }
+        for (int32_t &step: start.step) {
+            step = 0;
+            if (start.count >= 2) {
+                if (!getVarint(in, end, value)) return false;
+                step = unzigzag(value);
+            }
+        }
+        samples += start.count;
+        differences += start.count > 2 ? start.count - 2 : 0;
+    }
+    chunk.firstSample[objectCount] = static_cast<uint32_t>(samples);
+    if (samples != info.sampleCount) return false;
+
+    std::vector<uint32_t> columns[3];
+    for (auto &column: columns) {
+        if (!getColumn(in, end, differences, column)) return false;
+        for (uint32_t &value: column) value = static_cast<uint32_t>(unzigzag(value));
+    }
+
+    chunk.startTime = info.startMilliseconds / 1000.0;
+    chunk.endTime = (info.startMilliseconds + chunkMilliseconds) / 1000.0;
+    chunk.times.resize(samples);
+    chunk.latitudes.resize(samples);
+    chunk.longitudes.resize(samples);
+    float *outputs[3] = {chunk.times.data(), chunk.latitudes.data(), chunk.longitudes.data()};
+    const double scales[3] = {0.001, TrajectoryQuantum, TrajectoryQuantum};
+    for (int c = 0; c < 3; ++c) {
+        const auto *secondDifferences = reinterpret_cast<const int32_t *>(columns[c].data());
+        size_t difference = 0;
+        for (uint32_t object = 0; object < objectCount; ++object) {
+            const TrackStart &start = starts[object];
+            float *out = outputs[c] + chunk.firstSample[object];
+            int32_t value = start.first[c];
+            int32_t step = start.step[c];
+            out[0] = static_cast<float>(value * scales[c]);
+            for (uint32_t k = 1; k < start.count; ++k) {
+                if (k >= 2) step += secondDifferences[difference++];
+                value += step;
+                out[k] = static_cast<float>(value * scales[c]);
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,156 @@
+#ifndef TRAJECTORYSTORE_H
+#define TRAJECTORYSTORE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * Compressed file format for recorded tracks. Like `PositionFeed.h`, it does not
+ * depend on OpenGL, so recorders can use it on their own.
+ *
+ * Samples are (object id, time, latitude, longitude). Times are quantized to
+ * milliseconds and positions to `TrajectoryQuantum` degrees (about 1 m), and the
+ * samples are grouped into chunks covering a fixed span of time each.
+ *
+ * Within a chunk, the samples of one object are delta-encoded twice: the first
+ * sample and the first difference are stored as zigzag varints, every further
+ * sample as the zigzag-encoded difference of successive differences. Smoothly
+ * moving objects sampled at a steady rate thus produce second differences of
+ * almost only 0 and ±1. These are stored column by column (times, latitudes,
+ * longitudes) in blocks of `TrajectoryBlockSize` values packed with the bit width
+ * of the block's largest value, which decode with shifts and masks alone.
+ *
+ * File layout: a `TrajectoryFileHeader`, the chunks, an index of
+ * `TrajectoryChunkInfo` entries sorted by time, and a `TrajectoryFileFooter`
+ * pointing at the index. The index allows seeking to any time without reading
+ * the chunks before it.
+ */
+constexpr uint32_t TrajectoryMagic = 0x314b5254;   // "TRK1"
+constexpr uint32_t TrajectoryVersion = 1;
+constexpr double TrajectoryQuantum = 1e-5;
+constexpr int TrajectoryBlockSize = 32;
+
+
+#pragma pack(push, 1)
+struct TrajectoryFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t chunkMilliseconds;   // time span of one chunk
+    uint32_t reserved;
+};
+
+struct TrajectoryChunkInfo {
+    int64_t startMilliseconds;    // start of the chunk's time span
+    uint64_t offset;              // position of the chunk in the file
+    uint32_t size;                // encoded size in bytes
+    uint32_t sampleCount;
+    uint32_t objectCount;
+    uint32_t reserved;
+};
+
+struct TrajectoryFileFooter {
+    uint64_t indexOffset;
+    uint32_t chunkCount;
+    uint32_t magic;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(TrajectoryChunkInfo) == 32, "index entries are 32 bytes");
+
+
+/**
+ * The decoded samples of one chunk, as a structure of arrays grouped by object.
+ * The samples of object `objectIds[i]` are [firstSample[i], firstSample[i + 1]),
+ * ordered by time.
+ */
+struct TrajectoryChunk {
+    double startTime = 0.0;             // seconds
+    double endTime = 0.0;               // seconds, start of the next chunk
+    std::vector<uint32_t> objectIds;    // ascending
+    std::vector<uint32_t> firstSample;  // one entry per object, plus the total count
+    std::vector<float> times;           // seconds since startTime
+    std::vector<float> latitudes;       // degrees
+    std::vector<float> longitudes;      // degrees
+
+    size_t SampleCount() const { return times.size(); }
+};
+
+
+/**
+ * @class TrajectoryWriter
+ * @brief Appends samples to a trajectory file, one chunk at a time.
+ *
+ * Samples are buffered until one arrives for a later chunk, then the buffered
+ * chunk is encoded and written. Samples must therefore arrive in chunk order;
+ * within a chunk, the samples of each object must arrive in time order.
+ */
+class TrajectoryWriter final {
+    struct Sample {
+        int32_t time;   // milliseconds since the chunk start
+        int32_t latitude;
+        int32_t longitude;
+    };
+
+    std::ofstream file;
+    uint32_t chunkMilliseconds;
+    int64_t chunkStart = 0;
+    bool chunkOpen = false;
+    std::unordered_map<uint32_t, std::vector<Sample>> tracks;
+    std::vector<TrajectoryChunkInfo> index;
+    uint64_t sampleCount = 0;
+
+    void flushChunk();
+
+public:
+    TrajectoryWriter(const std::string &path, float chunkSeconds = 5.0f);
+
+    bool IsOpen() const { return file.is_open(); }
+
+    bool add(uint32_t objectId, double time, float latitude, float longitude);
+
+    uint64_t SampleCount() const { return sampleCount; }
+
+    uint64_t close();
+
+    ~TrajectoryWriter();
+};
+
+
+/**
+ * @class TrajectoryReader
+ * @brief Random access to the chunks of a trajectory file through its index.
+ *
+ * Only the header and the index are read when the file is opened; `readChunk`
+ * reads and decodes one chunk at a time, so memory use does not depend on the
+ * length of the recording.
+ */
+class TrajectoryReader final {
+    std::ifstream file;
+    uint32_t chunkMilliseconds = 0;
+    std::vector<TrajectoryChunkInfo> index;
+    std::vector<uint8_t> encoded;   // reused between reads
+
+public:
+    explicit TrajectoryReader(const std::string &path);
+
+    bool IsOpen() const { return file.is_open(); }
+
+    size_t ChunkCount() const { return index.size(); }
+
+    const TrajectoryChunkInfo &Chunk(size_t i) const { return index[i]; }
+
+    double StartTime() const;
+
+    double EndTime() const;
+
+    size_t findChunk(double time) const;
+
+    bool readChunk(size_t i, TrajectoryChunk &chunk);
+};
+
+
+#endif //TRAJECTORYSTORE_H
@@ -0,0 +1,503 @@
+#include "VectorExporter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+
+/**
+ * Creates the file and writes its header.
+ *
+ * @param path      The file to write.
+ * @param format    SVG or PDF, see `formatOf`.
+ * @param camera    The view to export; the flat map is exported even if it shows the globe.
+ * @param tolerance Largest distance of a simplified curve from the exact one, in points.
+ */
+VectorExporter::VectorExporter(const std::string &path, Format format, const Camera &camera, double tolerance)
+    : file(path, std::ios::binary | std::ios::trunc), format(format), camera(camera), tolerance(tolerance) {
+    if (!file) {
+        std::cerr << "Cannot create vector file " << path << std::endl;
+        return;
+    }
+    buffer.reserve(BufferSize);
+    std::string size = std::to_string(static_cast<int>(PageSize));
+    if (format == Format::Svg) {
+        write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" + size +
+              "pt\" height=\"" + size + "pt\" viewBox=\"0 0 " + size + " " + size + "\">\n");
+    } else {
+        // The content stream comes first as object 1; its length and the page
+        // follow it, since neither is known before the drawing is complete.
+        write("%PDF-1.4\n%\xe2\xe3\xcf\xd3\n");
+        contentObject = written;
+        write("1 0 obj\n<< /Length 2 0 R >>\nstream\n");
+        contentStart = written;
+    }
+}
+
+
+/**
+ * Picks the format of a file from its extension, `.svg` or `.pdf`.
+ *
+ * @param path   The file name.
+ * @param format Receives the format.
+ * @return False for any other extension.
+ */
+bool VectorExporter::formatOf(const std::string &path, Format &format) {
+    std::string extension = fs::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == ".svg") format = Format::Svg;
+    else if (extension == ".pdf") format = Format::Pdf;
+    else return false;
+    return true;
+}
+
+
+/**
+ * Appends text to the output buffer, and writes the buffer out once it is full.
+ */
+void VectorExporter::write(const std::string &text) {
+    buffer += text;
+    written += text.size();
+    if (buffer.size() >= BufferSize) flushBuffer();
+}
+
+
+/**
+ * Writes the buffered output to the file.
+ */
+void VectorExporter::flushBuffer() {
+    if (!file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()))) failed = true;
+    buffer.clear();
+}
+
+
+/**
+ * Appends a number rounded to 1/100, without trailing zeros, e.g. `-12.5`.
+ */
+void VectorExporter::writeNumber(double value) {
+    auto hundredths = static_cast<long long>(std::llround(value * 100.0));
+    char digits[32];
+    int length = std::snprintf(digits, sizeof(digits), "%s%lld", hundredths < 0 ? "-" : "", std::llabs(hundredths) / 100);
+    long long fraction = std::llabs(hundredths) % 100;
+    if (fraction != 0) {
+        digits[length++] = '.';
+        digits[length++] = static_cast<char>('0' + fraction / 10);
+        if (fraction % 10 != 0) digits[length++] = static_cast<char>('0' + fraction % 10);
+    }
+    buffer.append(digits, length);
+    written += length;
+}
+
+
+/**
+ * Appends a point of the current subpath. Starting a subpath opens the path
+ * element of the layer in SVG, and first closes it if it holds `MaxSubpaths`.
+ *
+ * @param point Page position in points, y pointing down.
+ * @param first Whether the point starts a new subpath.
+ */
+void VectorExporter::writePoint(const dvec2 &point, bool first) {
+    if (first) {
+        if (subpaths == MaxSubpaths) endSubpaths();
+        if (subpaths == 0 && format == Format::Svg) write(layerStart);
+        ++subpaths;
+    }
+    if (format == Format::Svg) {
+        write(first ? "M" : "L");
+        writeNumber(point.x);
+        write(" ");
+        writeNumber(point.y);
+    } else {
+        writeNumber(point.x);
+        write(" ");
+        writeNumber(PageSize - point.y);
+        write(first ? " m\n" : " l\n");
+    }
+}
+
+
+/**
+ * Paints the subpaths written since the layer or the last call: closes the
+ * SVG path element, or strokes or fills the PDF path.
+ */
+void VectorExporter::endSubpaths() {
+    if (subpaths == 0) return;
+    if (format == Format::Svg) write("\"/>\n");
+    else write(layer == Layer::Stroke ? "S\n" : "f\n");
+    subpaths = 0;
+}
+
+
+/**
+ * Formats a color as the SVG `#rrggbb` or as the three PDF color components.
+ */
+static std::string colorText(const vec3 &color, VectorExporter::Format format) {
+    char text[32];
+    if (format == VectorExporter::Format::Svg) {
+        auto byte = [](float channel) { return static_cast<int>(std::lround(std::clamp(channel, 0.0f, 1.0f) * 255.0f)); };
+        std::snprintf(text, sizeof(text), "#%02x%02x%02x", byte(color.x), byte(color.y), byte(color.z));
+    } else {
+        std::snprintf(text, sizeof(text), "%.3f %.3f %.3f", color.x, color.y, color.z);
+    }
+    return text;
+}
+
+
+/**
+ * Starts a layer of stroked curves, e.g. paths.
+ *
+ * @param color The color of the lines.
+ * @param width The width of the lines in points; lines are clipped this far outside the page.
+ */
+void VectorExporter::beginStroke(const vec3 &color, float width) {
+    endLayer();
+    layer = Layer::Stroke;
+    margin = width;
+    std::string widthText = std::to_string(width);
+    if (format == Format::Svg) {
+        layerStart = "<path fill=\"none\" stroke=\"" + colorText(color, format) + "\" stroke-width=\"" + widthText +
+                     "\" stroke-linecap=\"round\" stroke-linejoin=\"round\" d=\"";
+    } else {
+        write("q\n" + colorText(color, format) + " RG\n" + widthText + " w\n1 J\n1 j\n");
+    }
+}
+
+
+/**
+ * Starts a layer of filled areas, e.g. stations or the night side.
+ *
+ * @param color   The fill color.
+ * @param opacity The opacity of the fill, 1 for opaque.
+ */
+void VectorExporter::beginFill(const vec3 &color, float opacity) {
+    endLayer();
+    layer = Layer::Fill;
+    if (format == Format::Svg) {
+        layerStart = "<path fill=\"" + colorText(color, format) + "\"" +
+                     (opacity < 1.0f ? " fill-opacity=\"" + std::to_string(opacity) + "\"" : std::string()) + " d=\"";
+        return;
+    }
+    write("q\n");
+    if (opacity < 1.0f) {
+        size_t state = std::find(opacities.begin(), opacities.end(), opacity) - opacities.begin();
+        if (state == opacities.size()) opacities.push_back(opacity);
+        write("/G" + std::to_string(state) + " gs\n");
+    }
+    write(colorText(color, format) + " rg\n");
+}
+
+
+/**
+ * Ends the current layer.
+ */
+void VectorExporter::endLayer() {
+    endSubpaths();
+    if (format == Format::Pdf && layer != Layer::None) write("Q\n");
+    layer = Layer::None;
+}
+
+
+/**
+ * Projects points of one world copy of the map onto the page into `page`.
+ *
+ * @param map  Normalized map positions.
+ * @param copy The world copy; copy `k` is shifted by 2k.
+ */
+void VectorExporter::projectCopy(const std::vector<dvec2> &map, int copy) {
+    dvec2 center = camera.Center() - dvec2(2.0 * copy, 0.0);
+    double scale = camera.Zoom() * PageSize / 2.0;
+    page.clear();
+    for (const dvec2 &point: map)
+        page.emplace_back(PageSize / 2.0 + (point.x - center.x) * scale, PageSize / 2.0 - (point.y - center.y) * scale);
+}
+
+
+/**
+ * Simplifies the polyline in `page` with the Douglas-Peucker algorithm: the
+ * point farthest from the chord of a range is kept if it is farther than the
+ * tolerance, and the range is split there. The first and last points are kept.
+ */
+void VectorExporter::simplify() {
+    if (page.size() <= 2) return;
+    keep.assign(page.size(), 0);
+    keep.front() = keep.back() = 1;
+    ranges.assign(1, {0, page.size() - 1});
+    while (!ranges.empty()) {
+        auto [first, last] = ranges.back();
+        ranges.pop_back();
+        dvec2 chord = page[last] - page[first];
+        double length = glm::length(chord);
+        double farthest = tolerance;
+        size_t split = 0;
+        for (size_t i = first + 1; i < last; ++i) {
+            dvec2 offset = page[i] - page[first];
+            double distance = length > 0.0 ? std::abs(chord.x * offset.y - chord.y * offset.x) / length
+                                            : glm::length(offset);
+            if (distance > farthest) {
+                farthest = distance;
+                split = i;
+            }
+        }
+        if (split == 0) continue;
+        keep[split] = 1;
+        ranges.push_back({first, split});
+        ranges.push_back({split, last});
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < page.size(); ++i)
+        if (keep[i]) page[kept++] = page[i];
+    page.resize(kept);
+}
+
+
+/**
+ * Writes the polyline in `page`, clipped to the page grown by the line width.
+ * Each segment is clipped with the Liang-Barsky algorithm; a new subpath starts
+ * wherever the polyline enters the page.
+ */
+void VectorExporter::strokePolyline() {
+    const dvec2 low(-margin, -margin), high(PageSize + margin, PageSize + margin);
+    bool drawing = false;
+    for (size_t i = 1; i < page.size(); ++i) {
+        dvec2 from = page[i - 1], delta = page[i] - from;
+        double enter = 0.0, leave = 1.0;
+        for (int axis = 0; axis < 2 && enter <= leave; ++axis) {
+            if (delta[axis] == 0.0) {
+                if (from[axis] < low[axis] || from[axis] > high[axis]) leave = -1.0;
+                continue;
+            }
+            double t0 = (low[axis] - from[axis]) / delta[axis], t1 = (high[axis] - from[axis]) / delta[axis];
+            if (t0 > t1) std::swap(t0, t1);
+            enter = std::max(enter, t0);
+            leave = std::min(leave, t1);
+        }
+        if (enter > leave) {
+            drawing = false;
+            continue;
+        }
+        if (!drawing || enter > 0.0) writePoint(from + enter * delta, true);
+        writePoint(from + leave * delta, false);
+        drawing = leave == 1.0;
+    }
+}
+
+
+/**
+ * Writes the polygon in `page` as a closed subpath, clipped to the page with
+ * the Sutherland-Hodgman algorithm, one page edge at a time.
+ */
+void VectorExporter::fillPolygon() {
+    for (int edge = 0; edge < 4 && page.size() >= 3; ++edge) {
+        int axis = edge % 2;
+        double limit = edge < 2 ? 0.0 : PageSize;
+        auto inside = [&](const dvec2 &point) { return edge < 2 ? point[axis] >= limit : point[axis] <= limit; };
+        clipped.clear();
+        for (size_t i = 0; i < page.size(); ++i) {
+            const dvec2 &from = page[(i + page.size() - 1) % page.size()], &to = page[i];
+            if (inside(from) != inside(to))
+                clipped.push_back(from + (to - from) * ((limit - from[axis]) / (to[axis] - from[axis])));
+            if (inside(to)) clipped.push_back(to);
+        }
+        page.swap(clipped);
+    }
+    if (page.size() < 3) return;
+    for (size_t i = 0; i < page.size(); ++i) writePoint(page[i], i == 0);
+    write(format == Format::Svg ? "Z" : "h\n");
+}
+
+
+/**
+ * Fills the area of the map, i.e. of every world copy on the page, in the
+ * color of the current fill layer.
+ */
+void VectorExporter::fillMapArea() {
+    int first, count;
+    camera.worldCopies(0.0f, first, count);
+    samples.assign({dvec2(-1.0, -1.0), dvec2(1.0, -1.0), dvec2(1.0, 1.0), dvec2(-1.0, 1.0)});
+    for (int copy = first; copy < first + count; ++copy) {
+        projectCopy(samples, copy);
+        fillPolygon();
+    }
+}
+
+
+/**
+ * Fills the night side of the map in the current fill layer. The sun is placed
+ * like in the `MAP_LIGHTING` shader; the terminator, where the light term
+ * cos(lat) cos(sunLat) cos(lon - sunLon) + sin(lat) sin(sunLat) is 0, has the
+ * latitude atan(-cos(lon - sunLon) / tan(sunLat)), and the night side lies
+ * between it and the pole away from the sun.
+ *
+ * @param hourOffset The hour offset of the view.
+ */
+void VectorExporter::fillNightSide(int hourOffset) {
+    const double sunLatitude = glm::radians(23.0), sunLongitude = 180.0 - hourOffset * 15.0;
+    samples.clear();
+    for (int i = 0; i <= TerminatorSamples; ++i) {
+        double longitude = -180.0 + 360.0 * i / TerminatorSamples;
+        double latitude = glm::degrees(std::atan(-std::cos(glm::radians(longitude - sunLongitude)) / std::tan(sunLatitude)));
+        samples.push_back(geoToNormalizedMap(dvec2(std::clamp(latitude, -85.0, 85.0), longitude)));
+    }
+    double pole = sunLatitude > 0.0 ? -1.0 : 1.0;
+    samples.emplace_back(1.0, pole);
+    samples.emplace_back(-1.0, pole);
+
+    int first, count;
+    camera.worldCopies(0.0f, first, count);
+    for (int copy = first; copy < first + count; ++copy) {
+        projectCopy(samples, copy);
+        simplify();
+        fillPolygon();
+    }
+}
+
+
+/**
+ * Projects a point of the globe onto the map. The Mercator y of a latitude is
+ * atanh(sin(latitude)), so the map position follows from the unit vector
+ * without the inverse sine.
+ *
+ * @param point A vector, normalized here.
+ * @return The normalized map position, x in [-1, 1].
+ */
+static dvec2 unitToMap(const dvec3 &point) {
+    static const double maxSine = std::sin(glm::radians(85.0)), maxMercator = std::atanh(maxSine);
+    double z = std::clamp(point.z / glm::length(point), -maxSine, maxSine);
+    return dvec2(std::atan2(point.y, point.x) / M_PI, std::atanh(z) / maxMercator);
+}
+
+
+/**
+ * Strokes the great-circle arc between two stations in the current stroke
+ * layer, like the `GREAT_CIRCLE` vertex shader draws it (see
+ * `sampleGreatCircle`). The arc is sampled `ArcSamples` times per half circle
+ * of its length before it is simplified.
+ *
+ * @param startGeo Position of the first station in degrees.
+ * @param endGeo   Position of the second station in degrees.
+ */
+void VectorExporter::drawGreatCircle(const dvec2 &startGeo, const dvec2 &endGeo) {
+    double cosine = glm::dot(dvec3(geoToCartesian(startGeo)), dvec3(geoToCartesian(endGeo)));
+    double omega = std::acos(std::clamp(cosine, -1.0, 1.0));
+    samples.clear();
+    sampleGreatCircle(startGeo, endGeo, std::max(1, static_cast<int>(std::ceil(ArcSamples * omega / M_PI))), samples);
+
+    int first, count;
+    camera.worldCopies(Camera::HalfWorld, first, count);
+    for (int copy = first; copy < first + count; ++copy) {
+        projectCopy(samples, copy);
+        simplify();
+        strokePolyline();
+    }
+}
+
+
+/**
+ * Strokes a range ring in the current stroke layer, with the points and the
+ * unwrapping the `RANGE_RING` vertex shader draws it with, sampled
+ * `RingSamples` times before it is simplified. A ring around a pole runs
+ * across the whole map and continues in the neighboring world copies.
+ *
+ * @param ring The ring.
+ */
+void VectorExporter::drawRing(const RangeRing &ring) {
+    samples.clear();
+    for (int i = 0; i <= RingSamples; ++i) {
+        double t = static_cast<double>(i) / RingSamples;
+        dvec2 map = unitToMap(ring.pointAt(t));
+        map.x -= 2.0 * std::round((map.x - ring.unwrapReference(t)) / 2.0);
+        samples.push_back(map);
+    }
+
+    int first, count;
+    camera.worldCopies(Camera::HalfWorld, first, count);
+    for (int copy = first; copy < first + count; ++copy) {
+        projectCopy(samples, copy);
+        simplify();
+        strokePolyline();
+    }
+}
+
+
+/**
+ * Fills the marker of a station in the current fill layer, in every world copy
+ * where it touches the page: the outline of its icon in the `IconAtlas`,
+ * centered on the station.
+ *
+ * @param geo  Position of the station in degrees.
+ * @param icon The `MarkerIcon`.
+ * @param size Width and height of the icon in points.
+ */
+void VectorExporter::drawMarker(const dvec2 &geo, int icon, float size) {
+    const std::vector<vec2> &outline = IconAtlas::outline(icon);
+    samples.assign(1, geoToNormalizedMap(geo));
+    double half = size / 2.0;
+    int first, count;
+    camera.worldCopies(0.0f, first, count);
+    for (int copy = first; copy < first + count; ++copy) {
+        projectCopy(samples, copy);
+        dvec2 center = page[0];
+        if (center.x < -half || center.y < -half || center.x > PageSize + half || center.y > PageSize + half)
+            continue;
+        for (size_t i = 0; i < outline.size(); ++i)
+            writePoint(center + half * dvec2(outline[i].x, -outline[i].y), i == 0);
+        write(format == Format::Svg ? "Z" : "h\n");
+    }
+}
+
+
+/**
+ * Completes the file: ends the drawing and, for a PDF, writes the objects
+ * describing the page and the cross-reference table.
+ *
+ * @return The size of the file in bytes, or 0 if writing failed.
+ */
+uint64_t VectorExporter::close() {
+    if (!IsOpen()) return 0;
+    endLayer();
+    if (format == Format::Svg) {
+        write("</svg>\n");
+    } else {
+        uint64_t length = written - contentStart;
+        write("\nendstream\nendobj\n");
+        uint64_t offsets[5];
+        offsets[0] = contentObject;
+        offsets[1] = written;
+        write("2 0 obj\n" + std::to_string(length) + "\nendobj\n");
+        offsets[2] = written;
+        std::string size = std::to_string(static_cast<int>(PageSize));
+        write("3 0 obj\n<< /Type /Page /Parent 4 0 R /MediaBox [0 0 " + size + " " + size +
+              "] /Contents 1 0 R /Resources << /ExtGState <<");
+        for (size_t i = 0; i < opacities.size(); ++i)
+            write(" /G" + std::to_string(i) + " << /ca " + std::to_string(opacities[i]) + " >>");
+        write(" >> >> >>\nendobj\n");
+        offsets[3] = written;
+        write("4 0 obj\n<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n");
+        offsets[4] = written;
+        write("5 0 obj\n<< /Type /Catalog /Pages 4 0 R >>\nendobj\n");
+
+        uint64_t table = written;
+        write("xref\n0 6\n0000000000 65535 f \n");
+        for (uint64_t offset: offsets) {
+            char entry[24];
+            std::snprintf(entry, sizeof(entry), "%010llu 00000 n \n", static_cast<unsigned long long>(offset));
+            write(entry);
+        }
+        write("trailer\n<< /Size 6 /Root 5 0 R >>\nstartxref\n" + std::to_string(table) + "\n%%EOF\n");
+    }
+    flushBuffer();
+    file.close();
+    if (failed || file.fail()) {
+        std::cerr << "Writing the vector file failed" << std::endl;
+        return 0;
+    }
+    return written;
+}
+
+
+/**
+ * Destructor for the `VectorExporter` class. Completes the file.
+ */
+VectorExporter::~VectorExporter() {
+    close();
+}
@@ -0,0 +1,117 @@
+#ifndef VECTOREXPORTER_H
+#define VECTOREXPORTER_H
+
+#include "framework.h"
+#include "Camera.h"
+#include "IconAtlas.h"
+#include "RangeRingLayer.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+/**
+ * @class VectorExporter
+ * @brief Writes a view of the flat map as an SVG or a single-page PDF file, for printing.
+ *
+ * The page shows what the camera shows, `PageSize` points wide and high. The
+ * drawing is streamed: features are written as they are added, into layers of
+ * one color, each one a path element (SVG) or a path painted once (PDF) that
+ * is restarted every `MaxSubpaths` features, so the memory the exporter uses
+ * does not grow with the number of features; callers stream the features into
+ * it rather than collecting them first. The output goes through a `BufferSize`
+ * buffer that counts the bytes written, which the PDF cross-reference table
+ * needs.
+ *
+ * Every feature is drawn in each world copy that the page overlaps. Curves are
+ * sampled densely in map coordinates, projected onto the page, simplified with
+ * the Douglas-Peucker algorithm to `tolerance` points, and clipped to the page,
+ * so a path that crosses the page in a straight line costs two points and a
+ * path off the page costs none. Coordinates are written with 1/100 point precision.
+ *
+ * Not thread-safe; one exporter writes one file.
+ */
+class VectorExporter final {
+public:
+    enum class Format { Svg, Pdf };
+
+    static constexpr double PageSize = 600.0;        // points
+    static constexpr size_t BufferSize = 1 << 20;
+    static constexpr int MaxSubpaths = 4096;         // features per path element
+    static constexpr int ArcSamples = 256;           // samples of a great-circle arc before simplification
+    static constexpr int TerminatorSamples = 720;    // samples of the day-night boundary per world copy
+    static constexpr int RingSamples = 256;          // samples of a range ring before simplification
+
+private:
+    enum class Layer { None, Stroke, Fill };
+
+    std::ofstream file;
+    std::string buffer;
+    uint64_t written = 0;                   // bytes written or buffered
+    bool failed = false;
+    Format format;
+    Camera camera;
+    double tolerance;
+    uint64_t contentObject = 0;             // PDF: offset of the content stream object
+    uint64_t contentStart = 0;              // and of its data
+    double margin = 0.0;                    // lines are clipped this far outside the page
+    Layer layer = Layer::None;
+    std::string layerStart;                 // opens the SVG path element of the layer
+    int subpaths = 0;
+    std::vector<float> opacities;           // PDF graphics states, one per fill opacity used
+    std::vector<dvec2> samples;             // reused between features
+    std::vector<dvec2> page;
+    std::vector<dvec2> clipped;
+    std::vector<char> keep;
+    std::vector<std::pair<size_t, size_t>> ranges;
+
+    void write(const std::string &text);
+
+    void writeNumber(double value);
+
+    void writePoint(const dvec2 &point, bool first);
+
+    void flushBuffer();
+
+    void endSubpaths();
+
+    void beginFeature();
+
+    void projectCopy(const std::vector<dvec2> &map, int copy);
+
+    void simplify();
+
+    void strokePolyline();
+
+    void fillPolygon();
+
+public:
+    VectorExporter(const std::string &path, Format format, const Camera &camera, double tolerance = 0.25);
+
+    static bool formatOf(const std::string &path, Format &format);
+
+    bool IsOpen() const { return file.is_open(); }
+
+    void beginStroke(const vec3 &color, float width);
+
+    void beginFill(const vec3 &color, float opacity);
+
+    void endLayer();
+
+    void fillMapArea();
+
+    void fillNightSide(int hourOffset);
+
+    void drawGreatCircle(const dvec2 &startGeo, const dvec2 &endGeo);
+
+    void drawRing(const RangeRing &ring);
+
+    void drawMarker(const dvec2 &geo, int icon, float size);
+
+    uint64_t close();
+
+    ~VectorExporter();
+};
+
+
+#endif //VECTOREXPORTER_H
@@ -0,0 +1,355 @@
+#include "VehicleLayer.h"
+#include <algorithm>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VEHICLE_LAYER_SSE 1
+#endif
+
+
+/**
+ * Radius of the Earth in kilometers, matching the distances shown on the paths.
+ */
+static const float EarthRadius = 40000.0f / (2.0f * static_cast<float>(M_PI));
+
+
+/**
+ * Number of vehicles one job of the worker pool interpolates at least. Chunks are
+ * multiples of it, so only the very last chunk has a tail that is not a multiple
+ * of the SIMD width.
+ */
+static const size_t VehicleGrain = 4096;
+
+
+/**
+ * Approximates sin(x) for x in [0, pi] with the Taylor polynomial of degree 11
+ * around 0, after folding x into [0, pi/2], where its error stays below 1e-7.
+ */
+static inline float sinHalfTurn(float x) {
+    float z = std::min(x, static_cast<float>(M_PI) - x);
+    float z2 = z * z;
+    return z * (1.0f + z2 * (-1.0f / 6.0f + z2 * (1.0f / 120.0f + z2 * (-1.0f / 5040.0f +
+                z2 * (1.0f / 362880.0f + z2 * (-1.0f / 39916800.0f))))));
+}
+
+
+#ifdef VEHICLE_LAYER_SSE
+/**
+ * `sinHalfTurn` for four values at once.
+ */
+static inline __m128 sinHalfTurn4(__m128 x) {
+    __m128 z = _mm_min_ps(x, _mm_sub_ps(_mm_set1_ps(static_cast<float>(M_PI)), x));
+    __m128 z2 = _mm_mul_ps(z, z);
+    __m128 p = _mm_set1_ps(-1.0f / 39916800.0f);
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(1.0f / 362880.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(-1.0f / 5040.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(1.0f / 120.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(-1.0f / 6.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(1.0f));
+    return _mm_mul_ps(p, z);
+}
+#endif
+
+
+/**
+ * Creates the vertex array. The instance buffer is allocated once vehicles exist.
+ */
+VehicleLayer::VehicleLayer() {
+    glGenVertexArrays(1, &vao);
+}
+
+
+/**
+ * Resizes every array of the vehicles to `count` entries.
+ */
+void VehicleLayer::resize(size_t count) {
+    for (std::vector<float> *column: {&startX, &startY, &startZ, &endX, &endY, &endZ, &angle, &inverseSinAngle,
+                                      &departure, &inverseDuration})
+        column->resize(count);
+}
+
+
+/**
+ * Writes a vehicle travelling back and forth between two points into a slot of
+ * the arrays.
+ *
+ * @param index         The slot.
+ * @param start         Unit vector of the first endpoint.
+ * @param end           Unit vector of the second endpoint.
+ * @param speed         Speed along the surface in kilometers per second.
+ * @param departureTime Time in seconds at which the vehicle leaves `start`.
+ * @return False if the endpoints coincide or are antipodal, which leaves the
+ *         great circle undefined; the slot is left unchanged then.
+ */
+bool VehicleLayer::setVehicle(size_t index, const vec3 &start, const vec3 &end, float speed, float departureTime) {
+    float omega = acosf(std::clamp(dot(start, end), -1.0f, 1.0f));
+    float sinOmega = sinf(omega);
+    if (omega < 1e-4f || sinOmega < 1e-4f || speed <= 0.0f) return false;
+
+    startX[index] = start.x;
+    startY[index] = start.y;
+    startZ[index] = start.z;
+    endX[index] = end.x;
+    endY[index] = end.y;
+    endZ[index] = end.z;
+    angle[index] = omega;
+    inverseSinAngle[index] = 1.0f / sinOmega;
+    departure[index] = departureTime;
+    inverseDuration[index] = speed / (omega * EarthRadius);
+    return true;
+}
+
+
+/**
+ * Adds a vehicle travelling back and forth between two points.
+ *
+ * @param start         Unit vector of the first endpoint.
+ * @param end           Unit vector of the second endpoint.
+ * @param speed         Speed along the surface in kilometers per second.
+ * @param departureTime Time in seconds at which the vehicle leaves `start`.
+ * @return False if the endpoints coincide or are antipodal, which leaves the
+ *         great circle undefined; no vehicle is added then.
+ */
+bool VehicleLayer::addVehicle(const vec3 &start, const vec3 &end, float speed, float departureTime) {
+    size_t index = Count();
+    resize(index + 1);
+    if (setVehicle(index, start, end, speed, departureTime)) return true;
+    resize(index);
+    return false;
+}
+
+
+/**
+ * Adds a batch of vehicles, split across the worker pool like `update`. The
+ * source describes each new vehicle on a worker thread, so it must not depend
+ * on the order of the calls. Vehicles the source describes with coinciding or
+ * antipodal endpoints are dropped, and the rest close ranks in order.
+ *
+ * @param count   Number of vehicles the source describes.
+ * @param workers The pool the batch is split across.
+ * @param source  Sets the endpoints, speed and departure time of the vehicle
+ *                with an index in [0, count).
+ * @return The number of vehicles added.
+ */
+size_t VehicleLayer::addVehicles(size_t count, WorkerPool &workers, const VehicleSource &source) {
+    size_t first = Count();
+    resize(first + count);
+    std::vector<unsigned char> added(count);
+    workers.parallelFor(count, VehicleGrain, [this, first, &source, &added](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            vec3 start, finish;
+            float speed, departureTime;
+            source(i, start, finish, speed, departureTime);
+            added[i] = setVehicle(first + i, start, finish, speed, departureTime);
+        }
+    });
+
+    size_t kept = first;
+    for (size_t i = 0; i < count; ++i) {
+        if (!added[i]) continue;
+        if (kept != first + i) {
+            for (std::vector<float> *column: {&startX, &startY, &startZ, &endX, &endY, &endZ, &angle,
+                                              &inverseSinAngle, &departure, &inverseDuration})
+                (*column)[kept] = (*column)[first + i];
+        }
+        ++kept;
+    }
+    resize(kept);
+    return kept - first;
+}
+
+
+/**
+ * Blocks until the GPU has finished drawing from a region of the buffer.
+ */
+void VehicleLayer::waitForRegion(int index) {
+    if (fences[index] == nullptr) return;
+    while (glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 100000000) == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(fences[index]);
+    fences[index] = nullptr;
+}
+
+
+/**
+ * Makes room for at least `count` vehicles per region. The buffer is immutable
+ * storage mapped once for its lifetime, so growing it allocates a new one, at
+ * least twice as large, after the GPU has finished with the old one.
+ *
+ * @param count Number of vehicles.
+ */
+void VehicleLayer::reserve(size_t count) {
+    if (count <= capacity) return;
+    for (int i = 0; i < Regions; ++i) waitForRegion(i);
+    if (vbo != 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glDeleteBuffers(1, &vbo);
+    }
+
+    capacity = std::max({count, capacity * 2, VehicleGrain});
+    GLsizeiptr size = static_cast<GLsizeiptr>(Regions * capacity * 4 * sizeof(float));
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+    mapped = static_cast<float *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+    if (mapped == nullptr) {
+        std::cerr << "Cannot map the vehicle buffer of " << capacity << " vehicles" << std::endl;
+        capacity = 0;
+    }
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 4 * sizeof(float), nullptr);
+    glVertexAttribDivisor(0, 1);
+    glBindVertexArray(0);
+    uploaded = 0;
+}
+
+
+/**
+ * Writes the positions of the vehicles in [begin, end) at a given time as
+ * (x, y, z, 1) unit vectors. Runs on the worker threads, four vehicles at a time
+ * where SSE2 is available.
+ *
+ * A vehicle's phase s = (time - departure) / duration counts the trips made; the
+ * interpolation factor t = 1 - |s mod 2 - 1| runs from 0 to 1 and back again.
+ *
+ * @param begin       First vehicle; a multiple of 4.
+ * @param end         One past the last vehicle.
+ * @param time        Current time in seconds.
+ * @param destination The region of the mapped buffer being written.
+ */
+void VehicleLayer::interpolate(size_t begin, size_t end, float time, float *destination) const {
+    size_t i = begin;
+#ifdef VEHICLE_LAYER_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 now = _mm_set1_ps(time);
+    for (; i + 4 <= end; i += 4) {
+        __m128 s = _mm_mul_ps(_mm_sub_ps(now, _mm_loadu_ps(&departure[i])), _mm_loadu_ps(&inverseDuration[i]));
+        s = _mm_max_ps(s, zero);
+        __m128 trips = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(s, half)));
+        __m128 phase = _mm_sub_ps(s, _mm_mul_ps(trips, two));
+        __m128 t = _mm_sub_ps(one, _mm_and_ps(_mm_sub_ps(phase, one), absMask));
+
+        __m128 omega = _mm_loadu_ps(&angle[i]);
+        __m128 inverseSin = _mm_loadu_ps(&inverseSinAngle[i]);
+        __m128 weightStart = _mm_mul_ps(sinHalfTurn4(_mm_mul_ps(_mm_sub_ps(one, t), omega)), inverseSin);
+        __m128 weightEnd = _mm_mul_ps(sinHalfTurn4(_mm_mul_ps(t, omega)), inverseSin);
+
+        __m128 x = _mm_add_ps(_mm_mul_ps(weightStart, _mm_loadu_ps(&startX[i])),
+                              _mm_mul_ps(weightEnd, _mm_loadu_ps(&endX[i])));
+        __m128 y = _mm_add_ps(_mm_mul_ps(weightStart, _mm_loadu_ps(&startY[i])),
+                              _mm_mul_ps(weightEnd, _mm_loadu_ps(&endY[i])));
+        __m128 z = _mm_add_ps(_mm_mul_ps(weightStart, _mm_loadu_ps(&startZ[i])),
+                              _mm_mul_ps(weightEnd, _mm_loadu_ps(&endZ[i])));
+        __m128 w = one;
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        _mm_storeu_ps(destination + 4 * i, x);
+        _mm_storeu_ps(destination + 4 * i + 4, y);
+        _mm_storeu_ps(destination + 4 * i + 8, z);
+        _mm_storeu_ps(destination + 4 * i + 12, w);
+    }
+#endif
+    for (; i < end; ++i) {
+        float s = std::max((time - departure[i]) * inverseDuration[i], 0.0f);
+        float phase = s - 2.0f * truncf(s * 0.5f);
+        float t = 1.0f - fabsf(phase - 1.0f);
+        float weightStart = sinHalfTurn((1.0f - t) * angle[i]) * inverseSinAngle[i];
+        float weightEnd = sinHalfTurn(t * angle[i]) * inverseSinAngle[i];
+        float *out = destination + 4 * i;
+        out[0] = weightStart * startX[i] + weightEnd * endX[i];
+        out[1] = weightStart * startY[i] + weightEnd * endY[i];
+        out[2] = weightStart * startZ[i] + weightEnd * endZ[i];
+        out[3] = 1.0f;
+    }
+}
+
+
+/**
+ * Moves every vehicle to its position at a given time, writing the next region
+ * of the instance buffer. Called on the render thread once per frame.
+ *
+ * @param time    Current time in seconds.
+ * @param workers The pool the interpolation is split across.
+ */
+void VehicleLayer::update(float time, WorkerPool &workers) {
+    if (Count() == 0) return;
+    float *destination = beginPositions(Count());
+    if (destination == nullptr) return;
+    workers.parallelFor(Count(), VehicleGrain, [this, time, destination](size_t begin, size_t end) {
+        interpolate(begin, end, time, destination);
+    });
+    endPositions(Count());
+}
+
+
+/**
+ * Moves on to the next region of the instance buffer and returns it for writing,
+ * once the GPU has finished drawing from it. Each position takes four floats:
+ * the unit vector and one float of padding.
+ *
+ * @param count Number of positions that will be written.
+ * @return The region, or nullptr if the buffer could not be allocated.
+ */
+float *VehicleLayer::beginPositions(size_t count) {
+    reserve(count);
+    if (mapped == nullptr) return nullptr;
+    region = (region + 1) % Regions;
+    waitForRegion(region);
+    return mapped + region * capacity * 4;
+}
+
+
+/**
+ * Makes the positions written since `beginPositions` the ones that are drawn.
+ *
+ * @param count Number of positions written; 0 hides all of them.
+ */
+void VehicleLayer::endPositions(size_t count) {
+    uploaded = count;
+}
+
+
+/**
+ * Draws the vehicles written by the latest `update` as points, with one instanced
+ * draw call starting at the current region, and fences the region. Each vehicle
+ * is as many instances as there are visible copies of the map, which the
+ * divisor of the position maps back to the same vehicle.
+ *
+ * @param prog   A `SPHERE_POSITION | FLAT_COLOR` program, already in use.
+ * @param camera The view to draw.
+ * @param color  The color of the points.
+ */
+void VehicleLayer::DrawVehicles(GPUProgram *prog, const Camera &camera, vec3 color) {
+    if (uploaded == 0) return;
+    prog->setUniform(color, "color");
+    int copies = camera.setUniforms(prog);
+    glPointSize(2.0f);
+    glBindVertexArray(vao);
+    glVertexAttribDivisor(0, copies);
+    glDrawArraysInstancedBaseInstance(GL_POINTS, 0, 1, static_cast<GLsizei>(uploaded) * copies,
+                                      static_cast<GLuint>(region * capacity));
+    glBindVertexArray(0);
+    if (fences[region] != nullptr) glDeleteSync(fences[region]);
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+
+/**
+ * Destructor for the `VehicleLayer` class. Waits for the GPU to finish with the
+ * buffer, then unmaps and releases it.
+ */
+VehicleLayer::~VehicleLayer() {
+    for (int i = 0; i < Regions; ++i) waitForRegion(i);
+    if (vbo != 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glDeleteBuffers(1, &vbo);
+    }
+    glDeleteVertexArrays(1, &vao);
+}
@@ -0,0 +1,88 @@
+#ifndef VEHICLELAYER_H
+#define VEHICLELAYER_H
+
+#include "framework.h"
+#include "WorkerPool.h"
+#include "Camera.h"
+#include <functional>
+#include <vector>
+
+
+/**
+ * @class VehicleLayer
+ * @brief Moves a large number of vehicles along great-circle paths and draws them as points.
+ *
+ * The vehicles are stored as a structure of arrays: the unit vectors of both
+ * endpoints, the angle between them and its inverse sine, the departure time and
+ * the inverse travel time. `update` interpolates every vehicle with a spherical
+ * linear interpolation, four vehicles per SSE instruction, with the vehicles
+ * split across the worker pool, and writes the unit vectors straight into a
+ * persistently mapped vertex buffer. The `SPHERE_POSITION` shader variant
+ * projects them on the map.
+ *
+ * The buffer holds `Regions` copies of the positions. Each frame writes the next
+ * region while the GPU may still draw from the previous ones, and a fence per
+ * region keeps the CPU from overwriting positions the GPU has not drawn yet, so
+ * neither side waits for the other in the steady state.
+ *
+ * Vehicles shuttle back and forth between the endpoints of their path. Large
+ * batches of them are added with `addVehicles`, which computes them on the
+ * worker pool as well.
+ *
+ * Other sources of positions, such as a replay of recorded tracks, can fill the
+ * same kind of buffer directly with `beginPositions` and `endPositions` instead
+ * of adding vehicles.
+ */
+class VehicleLayer final {
+    static constexpr int Regions = 3;
+
+    std::vector<float> startX, startY, startZ;
+    std::vector<float> endX, endY, endZ;
+    std::vector<float> angle;
+    std::vector<float> inverseSinAngle;
+    std::vector<float> departure;
+    std::vector<float> inverseDuration;
+
+    unsigned int vao = 0;
+    unsigned int vbo = 0;
+    float *mapped = nullptr;
+    size_t capacity = 0;   // vehicles per region
+    GLsync fences[Regions] = {};
+    int region = 0;
+    size_t uploaded = 0;   // vehicles written into the current region
+
+    void resize(size_t count);
+
+    bool setVehicle(size_t index, const vec3 &start, const vec3 &end, float speed, float departureTime);
+
+    void reserve(size_t count);
+
+    void waitForRegion(int index);
+
+    void interpolate(size_t begin, size_t end, float time, float *destination) const;
+
+public:
+    VehicleLayer();
+
+    using VehicleSource = std::function<void(size_t index, vec3 &start, vec3 &end, float &speed,
+                                             float &departureTime)>;
+
+    bool addVehicle(const vec3 &start, const vec3 &end, float speed, float departureTime);
+
+    size_t addVehicles(size_t count, WorkerPool &workers, const VehicleSource &source);
+
+    size_t Count() const { return angle.size(); }
+
+    void update(float time, WorkerPool &workers);
+
+    float *beginPositions(size_t count);
+
+    void endPositions(size_t count);
+
+    void DrawVehicles(GPUProgram *prog, const Camera &camera, vec3 color);
+
+    ~VehicleLayer();
+};
+
+
+#endif //VEHICLELAYER_H
@@ -0,0 +1,59 @@
+#include "ViewUniforms.h"
+
+
+/**
+ * Creates the uniform buffer of the view; it is filled by `update`.
+ */
+ViewUniforms::ViewUniforms() {
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+
+/**
+ * Uploads the state of the view. The center of the view, moved into each copy
+ * of the map, is split into high and low floats in double precision.
+ *
+ * @param camera     The camera of the view.
+ * @param hourOffset The hour offset of the day-night shading.
+ * @param width      Width of the view in pixels.
+ * @param height     Height of the view in pixels.
+ */
+void ViewUniforms::update(const Camera &camera, int hourOffset, int width, int height) {
+    Block block = {};
+    block.globeRotation = mat4(camera.GlobeRotation());
+    int first, count;
+    camera.worldCopies(Camera::HalfWorld, first, count);
+    for (int copy = 0; copy < count; ++copy) {
+        vec2 high, low;
+        splitPosition(camera.Center() - dvec2(2.0 * (first + copy), 0.0), high, low);
+        block.eyeHigh[copy] = vec4(high, 0.0f, 0.0f);
+        block.eyeLow[copy] = vec4(low, 0.0f, 0.0f);
+    }
+    block.viewportSize = vec2(static_cast<float>(width), static_cast<float>(height));
+    block.viewScale = static_cast<float>(camera.Zoom());
+    block.globeScale = camera.GlobeScale();
+    block.hourOffset = static_cast<float>(hourOffset);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+
+/**
+ * Makes this the view that the following draw calls use.
+ */
+void ViewUniforms::bind() const {
+    glBindBufferBase(GL_UNIFORM_BUFFER, Binding, ubo);
+}
+
+
+/**
+ * Destructor for the `ViewUniforms` class. Releases the uniform buffer.
+ */
+ViewUniforms::~ViewUniforms() {
+    glDeleteBuffers(1, &ubo);
+}
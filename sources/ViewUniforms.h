@@ -0,0 +1,57 @@
+#ifndef VIEWUNIFORMS_H
+#define VIEWUNIFORMS_H
+
+#include "framework.h"
+#include "Camera.h"
+
+
+/**
+ * @class ViewUniforms
+ * @brief The state of one view (camera, time of day, size) in a `View` uniform block.
+ *
+ * Every shader variant declares the same std140 `View` block, which the
+ * `ShaderLibrary` binds to `Binding` when it compiles a variant. Each view
+ * owns one small uniform buffer holding the camera transformation for the
+ * map and the globe, the hour offset of its day-night shading and its size in
+ * pixels. Drawing a view only binds its buffer, so the programs, vertex
+ * buffers and textures of the layers are shared by all views unchanged, and
+ * switching views costs one `glBindBufferBase` instead of a set of uniforms
+ * per program.
+ *
+ * The block holds the view center moved into each copy of the map that
+ * geometry reaching `Camera::HalfWorld` beyond its copy can overlap; draws of
+ * geometry within the map pick a subrange of these copies through the
+ * `copyOffset` and `worldCopies` uniforms, see `Camera::setUniforms`.
+ */
+class ViewUniforms final {
+public:
+    static constexpr GLuint Binding = 0;
+
+private:
+    struct Block {   // std140 layout of the `View` block in the shaders
+        mat4 globeRotation;
+        vec4 eyeHigh[Camera::MaxWorldCopies];
+        vec4 eyeLow[Camera::MaxWorldCopies];
+        vec2 viewportSize;
+        float viewScale;
+        float globeScale;
+        float hourOffset;
+        float padding[3];
+    };
+
+    static_assert(sizeof(Block) == 192, "the View block has the std140 layout of the shaders");
+
+    unsigned int ubo = 0;
+
+public:
+    ViewUniforms();
+
+    void update(const Camera &camera, int hourOffset, int width, int height);
+
+    void bind() const;
+
+    ~ViewUniforms();
+};
+
+
+#endif //VIEWUNIFORMS_H
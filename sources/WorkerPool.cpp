@@ -0,0 +1,122 @@
+#include "WorkerPool.h"
+#include <latch>
+
+
+/**
+ * Starts the worker threads.
+ *
+ * @param threadCount Number of threads; at least one thread is always started.
+ */
+WorkerPool::WorkerPool(unsigned int threadCount) {
+    if (threadCount == 0) threadCount = 1;
+    for (unsigned int i = 0; i < threadCount; ++i)
+        threads.emplace_back(&WorkerPool::run, this);
+}
+
+
+/**
+ * Body of a worker thread: takes jobs from the queues, urgent ones first, until
+ * the pool stops and both queues are empty.
+ */
+void WorkerPool::run() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [this] { return stopping || !urgentJobs.empty() || !jobs.empty(); });
+            std::deque<std::function<void()>> &queue = urgentJobs.empty() ? jobs : urgentJobs;
+            if (queue.empty()) return;
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        job();
+    }
+}
+
+
+/**
+ * Runs the oldest urgent job on the calling thread, if there is one.
+ *
+ * @return False if the urgent queue was empty.
+ */
+bool WorkerPool::runUrgentJob() {
+    std::function<void()> job;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (urgentJobs.empty()) return false;
+        job = std::move(urgentJobs.front());
+        urgentJobs.pop_front();
+    }
+    job();
+    return true;
+}
+
+
+/**
+ * Queues a job for execution on one of the workers.
+ *
+ * @param job The function to run.
+ */
+void WorkerPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    wakeUp.notify_one();
+}
+
+
+/**
+ * Splits the range [0, count) into one chunk per worker plus one for the calling
+ * thread, runs `body` on every chunk in parallel, and returns when all chunks are
+ * done. The chunks jump the queue of submitted jobs, and after its own chunk the
+ * calling thread runs the ones no worker has taken yet, so the call finishes
+ * even while every worker is busy with a long job. Must not be called from a
+ * worker, which could wait for itself.
+ *
+ * @param count Number of items.
+ * @param grain Chunk sizes are multiples of it, e.g. the SIMD width of `body`.
+ * @param body  Processes the items in [begin, end).
+ */
+void WorkerPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)> &body) {
+    if (grain == 0) grain = 1;
+    size_t grains = (count + grain - 1) / grain;
+    size_t chunks = std::min(threads.size() + 1, grains);
+    if (chunks <= 1) {
+        if (count > 0) body(0, count);
+        return;
+    }
+
+    size_t chunkSize = (grains + chunks - 1) / chunks * grain;
+    chunks = (count + chunkSize - 1) / chunkSize;
+    std::latch done(static_cast<std::ptrdiff_t>(chunks - 1));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t chunk = 1; chunk < chunks; ++chunk) {
+            size_t begin = chunk * chunkSize;
+            size_t end = std::min(count, begin + chunkSize);
+            urgentJobs.emplace_back([&body, &done, begin, end] {
+                body(begin, end);
+                done.count_down();
+            });
+        }
+    }
+    wakeUp.notify_all();
+    body(0, std::min(count, chunkSize));
+    while (!done.try_wait() && runUrgentJob());
+    done.wait();
+}
+
+
+/**
+ * Destructor for the `WorkerPool` class. Lets the workers finish the queued
+ * jobs of both queues and joins them.
+ */
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto &thread: threads) thread.join();
+}
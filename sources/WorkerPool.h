@@ -0,0 +1,50 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * @class WorkerPool
+ * @brief A fixed set of worker threads executing jobs from a shared FIFO queue.
+ *
+ * The chunks of `parallelFor` go into a second queue that the workers empty
+ * first, and the calling thread works through it too while it waits, so a
+ * per-frame `parallelFor` never waits behind long jobs such as an export.
+ *
+ * Jobs must not touch OpenGL: the workers have no context. Work that needs the
+ * GL thread is handed back to it, e.g. by resuming a coroutine through
+ * `AsyncLoader::onGLThread`. They may write into persistently mapped buffers,
+ * though, which is how `parallelFor` fills per-frame vertex data.
+ */
+class WorkerPool final {
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> jobs;
+    std::deque<std::function<void()>> urgentJobs;   // chunks of `parallelFor`, taken first
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+
+    void run();
+
+    bool runUrgentJob();
+
+public:
+    WorkerPool(unsigned int threadCount = std::thread::hardware_concurrency());
+
+    void submit(std::function<void()> job);
+
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)> &body);
+
+    size_t ThreadCount() const { return threads.size(); }
+
+    ~WorkerPool();
+};
+
+
+#endif //WORKERPOOL_H
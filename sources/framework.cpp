@@ -4,15 +4,27 @@
 #include "framework.h"
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
 
 // Keretrendszer �llapota
 static int minorNumber = 3, majorNumber = 3;
 static int windowWidth = 600, windowHeight = 600;
 static const char * windowCaption = "Grafika";
 static GLFWwindow* window;
-static bool screenRefresh = true;
+static std::atomic<bool> screenRefresh(true);
 static glApp * pApp = nullptr;
 
+// Render thread (see glApp::useRenderThread)
+static bool renderThread = false;
+static std::atomic<bool> renderStop(false), renderDone(false);
+static std::thread::id mainThread;
+static std::mutex contextRequestMutex;
+static std::deque<std::packaged_task<void *()>> contextRequests; // shared contexts created or destroyed for other threads
+
 // Esem�nykezel�k
 static void error_callback(int error, const char* description) {
 	fprintf(stderr, "Error: %s\n", description);
@@ -72,11 +84,88 @@ void glApp::refreshScreen() {
 	screenRefresh = true;
 }
 
+// GL context, onDisplay and the onRender* handlers on a dedicated thread
+void glApp::useRenderThread() {
+	renderThread = true;
+}
+
 // Lek�rdez�ses klaviat�ra kezel�s
 bool pollKey(int key) {
 	return (glfwGetKey(window, key) == GLFW_PRESS);
 }
 
+// Hidden context sharing the GL objects of the application window, for worker threads
+static void * createHiddenContext() {
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow * context = glfwCreateWindow(1, 1, "", NULL, window);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	return context;
+}
+
+// GLFW windows can only be created and destroyed on the main thread: other threads hand the request over and wait
+static void * onMainThread(std::packaged_task<void *()> request) {
+	std::future<void *> result = request.get_future();
+	if (std::this_thread::get_id() == mainThread) {
+		request();
+		return result.get();
+	}
+	{
+		std::lock_guard<std::mutex> lock(contextRequestMutex);
+		contextRequests.push_back(std::move(request));
+	}
+	glfwPostEmptyEvent();
+	return result.get();
+}
+
+void * createSharedContext() {
+	return onMainThread(std::packaged_task<void *()>(createHiddenContext));
+}
+
+static void serveContextRequests() {
+	std::deque<std::packaged_task<void *()>> requests;
+	{
+		std::lock_guard<std::mutex> lock(contextRequestMutex);
+		requests.swap(contextRequests);
+	}
+	for (auto & request : requests) request();
+}
+
+// Render thread: draws whenever the screen was invalidated, independently of event handling
+static void renderLoop() {
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(1);
+	pApp->onRenderInitialization();
+	float startTime = (float)glfwGetTime();
+
+	while (!renderStop) {
+		float endTime = (float)glfwGetTime();
+		pApp->onRenderTimeElapsed(startTime, endTime);
+		startTime = endTime;
+
+		if (screenRefresh.exchange(false)) {
+			pApp->onDisplay();
+			glfwSwapBuffers(window);
+		} else {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	pApp->onRenderShutdown();
+	glfwMakeContextCurrent(NULL);
+	renderDone = true;
+	glfwPostEmptyEvent();
+}
+
+void makeContextCurrent(void * context) {
+	glfwMakeContextCurrent((GLFWwindow *)context);
+}
+
+void destroySharedContext(void * context) {
+	if (!context) return;
+	onMainThread(std::packaged_task<void *()>([context]() -> void * {
+		glfwDestroyWindow((GLFWwindow *)context);
+		return nullptr;
+	}));
+}
 
 int main(void) {
 	// Alkalmaz�i ablak l�trehoz�sa
@@ -102,6 +191,35 @@ int main(void) {
 
 	glfwMakeContextCurrent(window);
 	gladLoadGL();
+	mainThread = std::this_thread::get_id();
+
+	if (renderThread) {
+		// The context moves to the render thread, the main thread only handles events and simulation
+		glfwMakeContextCurrent(NULL);
+		pApp->onInitialization();
+		std::thread renderer(renderLoop);
+		float startTime = 0;
+
+		while (!glfwWindowShouldClose(window)) {
+			glfwWaitEventsTimeout(1.0 / 60.0); // events, or at least 60 simulation steps per second
+			serveContextRequests();
+
+			float endTime = (float)glfwGetTime();
+			pApp->onTimeElapsed(startTime, endTime);
+			startTime = endTime;
+		}
+		renderStop = true;
+		while (!renderDone) { // the render thread may still wait for a shared context
+			glfwWaitEventsTimeout(0.01);
+			serveContextRequests();
+		}
+		renderer.join();
+		glfwMakeContextCurrent(window);
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		exit(EXIT_SUCCESS);
+	}
+
 	glfwSwapInterval(1);
 
 	// Applik�ci� inicializ�l�sa
@@ -122,6 +240,7 @@ int main(void) {
 			screenRefresh = false;
 		}
 	}
+	pApp->onRenderShutdown();
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	exit(EXIT_SUCCESS);
@@ -1,6 +1,8 @@
 //=============================================================================================
 // OpenGL keretrendszer
 //=============================================================================================
+#ifndef FRAMEWORK_H
+#define FRAMEWORK_H
 #define GLAD_GL_IMPLEMENTATION
 #include <glad/glad.h>
 #define _USE_MATH_DEFINES		// M_PI
@@ -108,7 +110,9 @@ public:
 		create(vertexShaderSource, fragmentShaderSource, geometryShaderSource);
 	}
 
-	void create(const char* const vertexShaderSource, const char * const fragmentShaderSource, const char * const geometryShaderSource = nullptr) {
+	void setWaitError(bool wait) { waitError = wait; }	// block on getchar() after a compile error
+
+	bool create(const char* const vertexShaderSource, const char * const fragmentShaderSource, const char * const geometryShaderSource = nullptr) {
 		// Program l�trehoz�sa a forr�s sztringb�l
 		GLuint  vertexShader = glCreateShader(GL_VERTEX_SHADER);
 		if (!vertexShader) {
@@ -117,7 +121,7 @@ public:
 		}
 		glShaderSource(vertexShader, 1, (const GLchar**)&vertexShaderSource, NULL);
 		glCompileShader(vertexShader);
-		if (!checkShader(vertexShader, "Vertex shader error")) return;
+		if (!checkShader(vertexShader, "Vertex shader error")) { glDeleteShader(vertexShader); return false; }
 
 		// Program l�trehoz�sa a forr�s sztringb�l, ha van geometria �rnyal�
 		GLuint geometryShader = 0;
@@ -129,7 +133,7 @@ public:
 			}
 			glShaderSource(geometryShader, 1, (const GLchar**)&geometryShaderSource, NULL);
 			glCompileShader(geometryShader);
-			if (!checkShader(geometryShader, "Geometry shader error")) return;
+			if (!checkShader(geometryShader, "Geometry shader error")) { glDeleteShader(vertexShader); glDeleteShader(geometryShader); return false; }
 		}
 
 		// Program l�trehoz�sa a forr�s sztringb�l
@@ -141,7 +145,11 @@ public:
 
 		glShaderSource(fragmentShader, 1, (const GLchar**)&fragmentShaderSource, NULL);
 		glCompileShader(fragmentShader);
-		if (!checkShader(fragmentShader, "Fragment shader error")) return;
+		if (!checkShader(fragmentShader, "Fragment shader error")) {
+			glDeleteShader(vertexShader); glDeleteShader(fragmentShader);
+			if (geometryShader > 0) glDeleteShader(geometryShader);
+			return false;
+		}
 
 		shaderProgramId = glCreateProgram();
 		if (!shaderProgramId) {
@@ -151,12 +159,17 @@ public:
 		glAttachShader(shaderProgramId, vertexShader);
 		glAttachShader(shaderProgramId, fragmentShader);
 		if (geometryShader > 0) glAttachShader(shaderProgramId, geometryShader);
+		// shader objects are only flagged here, they are freed together with the program
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		if (geometryShader > 0) glDeleteShader(geometryShader);
 
 		// Szerkeszt�s
-		if (!link()) return;
+		if (!link()) return false;
 
 		// Ez fusson
 		glUseProgram(shaderProgramId); 
+		return true;
 	}
 
 #ifdef FILE_OPERATIONS
@@ -228,6 +241,11 @@ public:
 		if (location >= 0) glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
 	}
 
+	void setUniformBlock(const std::string& name, unsigned int binding) { // uniform block to a binding point, if the program uses it
+		GLuint index = glGetUniformBlockIndex(shaderProgramId, name.c_str());
+		if (index != GL_INVALID_INDEX) glUniformBlockBinding(shaderProgramId, index, binding);
+	}
+
 	~GPUProgram() { if (shaderProgramId > 0) glDeleteProgram(shaderProgramId); }
 };
 
@@ -335,6 +353,10 @@ public:
 enum MouseButton { MOUSE_LEFT, MOUSE_MIDDLE, MOUSE_RIGHT};
 enum SpecialKeys { KEY_RIGHT = 262, KEY_LEFT = 263, KEY_DOWN = 264, KEY_UP = 265 };
 bool pollKey(int key);
+// Hidden contexts sharing GL objects with the application window
+void * createSharedContext();            // any thread; created by the main thread
+void makeContextCurrent(void * context); // nullptr releases the context of the calling thread
+void destroySharedContext(void * context); // any thread; destroyed by the main thread
 
 //---------------------------
 class glApp {
@@ -345,6 +367,10 @@ public:
 		  unsigned int winWidth, unsigned int winHeight, // Alkalmaz�i ablak felbont�sa
 		  const char * caption);       // Megfog�cs�k sz�vege
 	void refreshScreen(); // Ablak �rv�nytelen�t�se
+	// Moves the GL context, onDisplay and the onRender* handlers to a dedicated render thread;
+	// call from the constructor. Input handlers, onInitialization and onTimeElapsed stay on the
+	// main thread, which then has no current context.
+	void useRenderThread();
 	// Esem�nykezel�k
 	virtual void onInitialization() {}    // Inicializ�ci�
 	virtual void onDisplay() {}           // Ablak �rv�nytelen
@@ -357,5 +383,12 @@ public:
 	virtual void onMouseMotion(int pX, int pY) {}
 	// Telik az id�
 	virtual void onTimeElapsed(float startTime, float endTime) {}
+	// Render thread only (see useRenderThread): GL initialization and per-iteration work
+	virtual void onRenderInitialization() {}
+	virtual void onRenderTimeElapsed(float startTime, float endTime) {}
+	// Thread owning the context, once the loop has stopped: the last chance to free GL objects,
+	// before the window and its context are destroyed
+	virtual void onRenderShutdown() {}
 };
 
+#endif //FRAMEWORK_H
@@ -0,0 +1,110 @@
+#include "PositionFeed.h"
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Stand-in producer for the shared memory position feed, for testing the viewer
+ * without a real simulator. Moves a number of objects along great circles and
+ * publishes all of their positions as one frame per tick.
+ *
+ * Usage: FeedProducer [objects] [frames per second] [feed name]
+ * Defaults to 100000 objects at 60 frames per second on the viewer's feed name.
+ */
+
+static volatile std::sig_atomic_t running = 1;
+
+
+/**
+ * Stops the publishing loop, so that the destructor of the writer removes the
+ * shared memory segment.
+ */
+static void stop(int) {
+    running = 0;
+}
+
+
+/**
+ * An object travelling on a great circle: `origin` and `axis` are orthonormal
+ * unit vectors spanning the circle's plane, `angle` is the current position on it.
+ */
+struct Traveller {
+    float origin[3];
+    float axis[3];
+    float angle;
+    float speed;   // radians per second
+};
+
+
+/**
+ * Creates a traveller on a random great circle with a random speed.
+ *
+ * @param random Random number generator.
+ * @return The new traveller.
+ */
+static Traveller randomTraveller(std::mt19937 &random) {
+    std::normal_distribution<float> gaussian;
+    std::uniform_real_distribution<float> speed(0.002f, 0.02f);
+    float a[3] = {gaussian(random), gaussian(random), gaussian(random)};
+    float b[3] = {gaussian(random), gaussian(random), gaussian(random)};
+    float lengthA = std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+    for (float &value: a) value /= lengthA;
+    float projection = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    for (int i = 0; i < 3; ++i) b[i] -= projection * a[i];
+    float lengthB = std::sqrt(b[0] * b[0] + b[1] * b[1] + b[2] * b[2]);
+    for (float &value: b) value /= lengthB;
+    return {{a[0], a[1], a[2]}, {b[0], b[1], b[2]}, 0.0f, speed(random)};
+}
+
+
+int main(int argc, char **argv) {
+    uint32_t objects = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 100000;
+    double rate = argc > 2 ? std::strtod(argv[2], nullptr) : 60.0;
+    std::string name = argc > 3 ? argv[3] : DefaultPositionFeedName;
+    if (objects == 0 || rate <= 0.0) {
+        std::cerr << "Usage: " << argv[0] << " [objects] [frames per second] [feed name]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    PositionFeedWriter feed(name, 4, objects);
+    if (!feed.IsOpen()) return EXIT_FAILURE;
+    std::signal(SIGINT, stop);
+    std::signal(SIGTERM, stop);
+
+    std::mt19937 random(12345);
+    std::vector<Traveller> travellers;
+    travellers.reserve(objects);
+    for (uint32_t i = 0; i < objects; ++i) travellers.push_back(randomTraveller(random));
+
+    std::cout << "Publishing " << objects << " positions at " << rate << " Hz on " << name
+              << ", press Ctrl+C to stop" << std::endl;
+    const auto tick = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / rate));
+    const float radiansToDegrees = 180.0f / static_cast<float>(M_PI);
+    auto next = std::chrono::steady_clock::now();
+
+    while (running) {
+        PositionRecord *records = feed.beginFrame();
+        for (uint32_t i = 0; i < objects; ++i) {
+            Traveller &traveller = travellers[i];
+            traveller.angle += traveller.speed / static_cast<float>(rate);
+            float c = std::cos(traveller.angle), s = std::sin(traveller.angle);
+            float x = traveller.origin[0] * c + traveller.axis[0] * s;
+            float y = traveller.origin[1] * c + traveller.axis[1] * s;
+            float z = traveller.origin[2] * c + traveller.axis[2] * s;
+            records[i] = {std::asin(z) * radiansToDegrees, std::atan2(y, x) * radiansToDegrees, i, 0};
+        }
+        feed.publish(objects);
+
+        next += tick;
+        std::this_thread::sleep_until(next);
+    }
+    std::cout << "Stopped" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+#include "SoftwareRasterizer.h"
+#include "CoastlineMesh.h"
+#include "Map.h"
+#include "NetworkTimeline.h"
+#include "Path.h"
+#include "WorkerPool.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+
+/**
+ * Renders a scene on the CPU, for hosts without a GPU or a display, and
+ * optionally compares the image with a capture of the viewer.
+ *
+ * Usage: SoftwareRender <script> <output.png> [reference.png [max differing percent]]
+ *
+ * The script holds control socket commands, one per line. `station`, `path`,
+ * `marker`, `color` and `hour` build the scene; the other commands are
+ * ignored, so a script sent to the viewer with a `capture` at its end renders
+ * the same scene here. The map, the land, the paths and the stations are drawn
+ * like in the viewer's default 600x600 view by a `SoftwareRasterizer`; labels
+ * are not. Stations get the size and color of their marker, but the rasterizer
+ * only draws square points, so every icon is drawn as a square. The frame is
+ * drawn `TimedFrames` times to print the time per frame, then written as PNG.
+ *
+ * With a reference image, the pixels whose channels differ from it by more
+ * than `Tolerance` are counted, and the program fails if they are more than
+ * the given percentage of the image, 1% by default.
+ */
+
+/**
+ * Location of the data files, such as the land polygons.
+ */
+#ifndef DATA_DIR
+#define DATA_DIR "data"
+#endif
+
+static constexpr int ImageSize = 600;
+static constexpr int TimedFrames = 20;
+static constexpr int Tolerance = 16;
+
+
+/**
+ * Counts the pixels of two RGBA images whose channels differ by more than `Tolerance`.
+ *
+ * @param image     The rendered image.
+ * @param reference The reference image of the same size.
+ * @param largest   Receives the largest difference of a channel.
+ * @return The number of differing pixels.
+ */
+static size_t countDifferences(const std::vector<unsigned char> &image, const std::vector<unsigned char> &reference,
+                               int &largest) {
+    size_t differing = 0;
+    largest = 0;
+    for (size_t pixel = 0; pixel < image.size() / 4; ++pixel) {
+        int difference = 0;
+        for (int channel = 0; channel < 3; ++channel)
+            difference = std::max(difference, std::abs(image[pixel * 4 + channel] - reference[pixel * 4 + channel]));
+        largest = std::max(largest, difference);
+        if (difference > Tolerance) ++differing;
+    }
+    return differing;
+}
+
+
+int main(int argc, char **argv) {
+    double maxPercent = argc > 4 ? std::strtod(argv[4], nullptr) : 1.0;
+    if (argc < 3 || maxPercent < 0.0) {
+        std::cerr << "Usage: " << argv[0] << " <script> <output.png> [reference.png [max differing percent]]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::ifstream script(argv[1]);
+    if (!script) {
+        std::cerr << "Cannot read " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<dvec2> stationGeoCoords;
+    std::vector<dvec2> stations;
+    std::vector<MarkerStyle> markers;
+    std::vector<dvec2> arcs;
+    float hourOffset = 0.0f;
+    std::string line;
+    for (int lineNumber = 1; std::getline(script, line); ++lineNumber) {
+        std::istringstream words(line);
+        std::string name;
+        if (!(words >> name) || name[0] == '#') continue;
+        if (name == "station") {
+            dvec2 geo;
+            if (!(words >> geo.x >> geo.y) || std::abs(geo.x) > 85.0 || std::abs(geo.y) > 180.0) {
+                std::cerr << argv[1] << ":" << lineNumber << ": invalid station" << std::endl;
+                return EXIT_FAILURE;
+            }
+            stationGeoCoords.push_back(geo);
+            stations.push_back(geoToNormalizedMap(geo));
+            markers.emplace_back();
+        } else if (name == "marker") {
+            size_t station;
+            int icon;
+            float size;
+            if (!(words >> station >> icon >> size) || station >= markers.size() || icon < 0 ||
+                icon >= IconAtlas::IconCount || !(size >= 1.0f)) {
+                std::cerr << argv[1] << ":" << lineNumber << ": invalid marker" << std::endl;
+                return EXIT_FAILURE;
+            }
+            markers[station].icon = icon;
+            markers[station].size = size;
+        } else if (name == "color") {
+            size_t station;
+            std::string hex;
+            if (!(words >> station >> hex) || station >= markers.size() || hex.size() != 6 ||
+                hex.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+                std::cerr << argv[1] << ":" << lineNumber << ": invalid color" << std::endl;
+                return EXIT_FAILURE;
+            }
+            unsigned long rgb = std::stoul(hex, nullptr, 16);
+            markers[station].color = vec3(static_cast<float>(rgb >> 16), static_cast<float>(rgb >> 8 & 0xff),
+                                          static_cast<float>(rgb & 0xff)) / 255.0f;
+        } else if (name == "path") {
+            size_t from, to;
+            if (!(words >> from >> to) || from >= stationGeoCoords.size() || to >= stationGeoCoords.size() ||
+                from == to) {
+                std::cerr << argv[1] << ":" << lineNumber << ": invalid path" << std::endl;
+                return EXIT_FAILURE;
+            }
+            sampleGreatCircle(stationGeoCoords[from], stationGeoCoords[to], NetworkTimeline::ArcSegments, arcs);
+        } else if (name == "hour") {
+            words >> hourOffset;
+        }
+    }
+
+    CoastlineMesh land(fs::path(DATA_DIR) / "land.txt", fs::temp_directory_path() / "GFX_Lab3" / "land.mesh");
+    std::vector<dvec2> landVertices;
+    for (const vec2 &geo: land.Vertices())
+        landVertices.push_back(geoToNormalizedMap(dvec2(std::clamp(geo.x, -85.0f, 85.0f), geo.y)));
+
+    Camera camera;
+    WorkerPool workers;
+    SoftwareRasterizer rasterizer(ImageSize, ImageSize);
+    rasterizer.clear(vec3(0.0f, 0.0f, 0.0f));
+    rasterizer.drawMap(camera, Map::decodeImage(Map::EncodedImage), 64, 64, hourOffset);
+    rasterizer.drawTriangles(camera, landVertices, land.Indices(), vec3(0.3f, 0.6f, 0.25f), 0.5f);
+    rasterizer.drawLineStrips(camera, arcs, NetworkTimeline::ArcSegments + 1, vec3(1.0f, 1.0f, 0.0f), 3.0f);
+    for (size_t begin = 0, end; begin < stations.size(); begin = end) {   // one call per run of equal markers
+        const MarkerStyle &marker = markers[begin];
+        for (end = begin + 1; end < stations.size(); ++end)
+            if (markers[end].color != marker.color || markers[end].size != marker.size) break;
+        rasterizer.drawPoints(camera, std::vector<dvec2>(stations.begin() + static_cast<ptrdiff_t>(begin),
+                                                         stations.begin() + static_cast<ptrdiff_t>(end)),
+                              marker.color, marker.size);
+    }
+
+    rasterizer.render(workers);
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < TimedFrames; ++frame) rasterizer.render(workers);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / TimedFrames;
+    std::cout << ImageSize << "x" << ImageSize << " in " << rasterizer.TileCount() << " tiles on "
+              << workers.ThreadCount() + 1 << " threads: " << seconds * 1000.0 << " ms per frame, "
+              << rasterizer.TileCount() / seconds << " tiles per second" << std::endl;
+
+    std::vector<unsigned char> image = rasterizer.image();
+    if (unsigned error = lodepng::encode(argv[2], image, ImageSize, ImageSize)) {
+        std::cerr << "Cannot write " << argv[2] << ": " << lodepng_error_text(error) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (argc < 4) return EXIT_SUCCESS;
+    std::vector<unsigned char> reference;
+    unsigned referenceWidth, referenceHeight;
+    if (unsigned error = lodepng::decode(reference, referenceWidth, referenceHeight, argv[3])) {
+        std::cerr << "Cannot read " << argv[3] << ": " << lodepng_error_text(error) << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (referenceWidth != ImageSize || referenceHeight != ImageSize) {
+        std::cerr << argv[3] << " is not " << ImageSize << "x" << ImageSize << std::endl;
+        return EXIT_FAILURE;
+    }
+    int largest;
+    size_t differing = countDifferences(image, reference, largest);
+    double percent = 100.0 * static_cast<double>(differing) / (ImageSize * ImageSize);
+    std::cout << differing << " pixels (" << percent << "%) differ from " << argv[3] << " by more than " << Tolerance
+              << ", largest difference " << largest << std::endl;
+    return percent <= maxPercent ? EXIT_SUCCESS : EXIT_FAILURE;
+}
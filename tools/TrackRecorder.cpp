@@ -0,0 +1,87 @@
+#include "PositionFeed.h"
+#include "TrajectoryStore.h"
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Records the shared memory position feed into a compressed trajectory file,
+ * which the viewer can replay later.
+ *
+ * Usage: TrackRecorder <file> [samples per second] [feed name]
+ * Defaults to 10 samples per second of every object on the viewer's feed name.
+ * Recording stops with Ctrl+C, which completes the file and prints its size
+ * next to the size of the same samples stored as raw 16-byte records.
+ */
+
+static volatile std::sig_atomic_t running = 1;
+
+
+/**
+ * Stops the recording loop, so that the destructor of the writer completes the file.
+ */
+static void stop(int) {
+    running = 0;
+}
+
+
+int main(int argc, char **argv) {
+    double rate = argc > 2 ? std::strtod(argv[2], nullptr) : 10.0;
+    std::string name = argc > 3 ? argv[3] : DefaultPositionFeedName;
+    if (argc < 2 || rate <= 0.0) {
+        std::cerr << "Usage: " << argv[0] << " <file> [samples per second] [feed name]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    TrajectoryWriter writer(argv[1]);
+    if (!writer.IsOpen()) return EXIT_FAILURE;
+    std::signal(SIGINT, stop);
+    std::signal(SIGTERM, stop);
+
+    std::cout << "Recording " << name << " at " << rate << " Hz into " << argv[1] << ", press Ctrl+C to stop"
+              << std::endl;
+    const auto tick = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / rate));
+    const auto start = std::chrono::steady_clock::now();
+    auto next = start;
+    PositionFeedReader *reader = nullptr;
+    std::vector<PositionRecord> records;
+    uint64_t recordedFrame = 0;
+
+    while (running) {
+        if (reader == nullptr) {
+            reader = new PositionFeedReader(name);
+            if (!reader->IsOpen()) {
+                delete reader;
+                reader = nullptr;
+            } else {
+                records.resize(reader->SlotCapacity());
+            }
+        }
+        uint64_t frame = 0;
+        uint32_t count = 0;
+        if (reader != nullptr && reader->PublishedFrame() != recordedFrame &&
+            reader->readLatest(records.data(), frame, count)) {
+            recordedFrame = frame;
+            double time = std::chrono::duration<double>(next - start).count();   // the tick, free of jitter
+            for (uint32_t i = 0; i < count; ++i)
+                writer.add(records[i].objectId, time, records[i].latitude, records[i].longitude);
+        }
+
+        next += tick;
+        std::this_thread::sleep_until(next);
+    }
+    delete reader;
+
+    uint64_t samples = writer.SampleCount();
+    uint64_t size = writer.close();
+    uint64_t raw = samples * sizeof(PositionRecord);
+    std::cout << "Recorded " << samples << " samples in " << size << " bytes";
+    if (size > 0) std::cout << ", " << static_cast<double>(raw) / static_cast<double>(size) << "x smaller than raw records";
+    std::cout << std::endl;
+    return size > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}